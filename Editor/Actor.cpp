@@ -1,28 +1,40 @@
+#include <cfloat>
 #include "Actor.h"
 #include "FileIO.h"
 #include "Util.h"
-#include "Mesh.h"
 #include "BoxCollider.h"
 #include "SphereCollider.h"
+#include "MeshCollider.h"
 
 namespace UltraEd
 {
     Actor::Actor() :
-        m_vertexBuffer(std::make_shared<VertexBuffer>()),
         m_type(ActorType::Model),
         m_id(),
         m_name(),
-        m_vertices(),
+        m_mesh(std::make_shared<const MeshData>()),
         m_material(),
         m_position(0, 0, 0),
         m_scale(1, 1, 1),
         m_localRot(),
         m_worldRot(),
         m_script(),
-        m_collider()
+        m_transformVersion(1),
+        m_transformListener(),
+        m_cachedVersion(0),
+        m_worldMatrix(),
+        m_inverseMatrix(),
+        m_invertible(false),
+        m_mirrored(false),
+        m_hasBounds(false),
+        m_worldMin(0, 0, 0),
+        m_worldMax(0, 0, 0),
+        m_collider(),
+        m_poolSize(0),
+        m_level(0)
     {
         ResetId();
-        m_script = std::string("void $start()\n{\n\n}\n\nvoid $update()\n{\n\n}\n\nvoid $input(NUContData gamepads[4])\n{\n\n}");
+        m_script = std::string("void $start()\n{\n\n}\n\nvoid $update(float delta)\n{\n\n}\n\nvoid $input(NUContData gamepads[4])\n{\n\n}");
         m_script.append("\n\nvoid $collide(actor *other)\n{\n\n}");
         SetDirty(true);
 
@@ -37,10 +49,9 @@ namespace UltraEd
 
     void Actor::Release()
     {
-        if (m_vertexBuffer != NULL)
-        {
-            m_vertexBuffer->Release();
-        }
+        // Other actors sharing the mesh create the buffers again on their next render.
+        m_mesh->vertexBuffer->Release();
+        m_mesh->indexBuffer->Release();
 
         if (m_collider != NULL)
         {
@@ -56,14 +67,26 @@ namespace UltraEd
 
     void Actor::Import(const char *filePath)
     {
-        Mesh mesh(filePath);
-        m_vertices = mesh.GetVertices();
-        if (mesh.GetFileInfo().type == FileType::User)
+        FileInfo info = FileIO::Import(filePath);
+        m_mesh = MeshCache::Get(info.path);
+        Transformed(true);
+        if (info.type == FileType::User)
         {
-            AddResource("vertexDataPath", mesh.GetFileInfo().path);
+            AddResource("vertexDataPath", info.path);
         }
     }
 
+    IDirect3DVertexBuffer9 *Actor::GetVertexBuffer(IDirect3DDevice9 *device)
+    {
+        return m_mesh->vertexBuffer->GetBuffer(device, m_mesh->vertices);
+    }
+
+    IDirect3DIndexBuffer9 *Actor::GetIndexBuffer(IDirect3DDevice9 *device)
+    {
+        if (m_mesh->longIndices.empty()) return m_mesh->indexBuffer->GetBuffer(device, m_mesh->shortIndices);
+        return m_mesh->indexBuffer->GetBuffer(device, m_mesh->longIndices);
+    }
+
     GUID Actor::GetId(cJSON *item)
     {
         cJSON *id = cJSON_GetObjectItem(item, "id");
@@ -101,10 +124,10 @@ namespace UltraEd
 
     bool Actor::SetRotation(const D3DXVECTOR3 &rotation)
     {
-        return Dirty([&]() {
+        return Transformed(Dirty([&]() {
             D3DXMatrixRotationYawPitchRoll(&m_worldRot, D3DXToRadian(rotation.y),
                 D3DXToRadian(rotation.x), D3DXToRadian(rotation.z));
-        }, &m_worldRot);
+        }, &m_worldRot));
     }
 
     D3DXVECTOR3 Actor::GetRight()
@@ -139,76 +162,91 @@ namespace UltraEd
     {
         D3DXMATRIX newWorld;
         D3DXMatrixRotationAxis(&newWorld, &dir, angle);
-        return Dirty([&] { m_worldRot *= newWorld; }, &m_worldRot);
+        return Transformed(Dirty([&] { m_worldRot *= newWorld; }, &m_worldRot));
+    }
+
+    const D3DXMATRIX &Actor::GetMatrix()
+    {
+        UpdateTransformCache();
+        return m_worldMatrix;
+    }
+
+    const D3DXMATRIX &Actor::GetInverseMatrix()
+    {
+        UpdateTransformCache();
+        return m_inverseMatrix;
     }
 
-    D3DXMATRIX Actor::GetMatrix()
+    bool Actor::Transformed(bool changed)
     {
+        if (changed)
+        {
+            m_transformVersion++;
+            if (m_transformListener) m_transformListener();
+        }
+        return changed;
+    }
+
+    void Actor::UpdateTransformCache()
+    {
+        // Every transform change bumps the version so the cache only rebuilds after one.
+        if (m_cachedVersion == m_transformVersion) return;
+
         D3DXMATRIX translation;
         D3DXMatrixTranslation(&translation, m_position.x, m_position.y, m_position.z);
 
         D3DXMATRIX scale;
         D3DXMatrixScaling(&scale, m_scale.x, m_scale.y, m_scale.z);
 
-        return scale * m_worldRot * m_localRot * translation;
-    }
+        m_worldMatrix = scale * m_worldRot * m_localRot * translation;
 
-    bool Actor::Pick(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, float *dist)
-    {
-        // Test all faces in this actor.
-        for (unsigned int j = 0; j < m_vertices.size() / 3; j++)
+        // A zero scale collapses the actor so there's nothing to invert or pick.
+        float determinant = 0;
+        m_invertible = D3DXMatrixInverse(&m_inverseMatrix, &determinant, &m_worldMatrix) != NULL;
+        if (!m_invertible) D3DXMatrixIdentity(&m_inverseMatrix);
+        m_mirrored = determinant < 0;
+
+        // Box around the transformed corners of the mesh's box.
+        D3DXVECTOR3 localMin, localMax;
+        m_hasBounds = m_mesh->pickTree.GetBounds(&localMin, &localMax);
+        if (m_hasBounds)
         {
-            D3DXVECTOR3 v0 = m_vertices[3 * j + 0].position;
-            D3DXVECTOR3 v1 = m_vertices[3 * j + 1].position;
-            D3DXVECTOR3 v2 = m_vertices[3 * j + 2].position;
-
-            // Transform the local vert positions based of the actor's
-            // local matrix so when the actor is moved around we can still click it.
-            D3DXVec3TransformCoord(&v0, &v0, &GetMatrix());
-            D3DXVec3TransformCoord(&v1, &v1, &GetMatrix());
-            D3DXVec3TransformCoord(&v2, &v2, &GetMatrix());
-
-            // Check if the pick ray passes through this point.
-            if (IntersectTriangle(orig, dir, v0, v1, v2, dist))
+            m_worldMin = D3DXVECTOR3(FLT_MAX, FLT_MAX, FLT_MAX);
+            m_worldMax = D3DXVECTOR3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            for (int i = 0; i < 8; i++)
             {
-                return true;
+                D3DXVECTOR3 corner(i & 1 ? localMax.x : localMin.x, i & 2 ? localMax.y : localMin.y,
+                    i & 4 ? localMax.z : localMin.z);
+                D3DXVec3TransformCoord(&corner, &corner, &m_worldMatrix);
+                D3DXVec3Minimize(&m_worldMin, &m_worldMin, &corner);
+                D3DXVec3Maximize(&m_worldMax, &m_worldMax, &corner);
             }
         }
 
-        return false;
+        m_cachedVersion = m_transformVersion;
     }
 
-    bool Actor::IntersectTriangle(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, const D3DXVECTOR3 &v0,
-        const D3DXVECTOR3 &v1, const D3DXVECTOR3 &v2, float *dist)
+    bool Actor::Pick(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, float *dist)
     {
-        // Find vectors for two edges sharing vert0
-        D3DXVECTOR3 edge1 = v1 - v0;
-        D3DXVECTOR3 edge2 = v2 - v0;
-
-        // Begin calculating determinant - also used to calculate U parameter.
-        D3DXVECTOR3 pvec;
-        D3DXVec3Cross(&pvec, &dir, &edge2);
-
-        // If determinant is near zero, ray lies in plane of triangle.
-        float det = D3DXVec3Dot(&edge1, &pvec);
-
-        if (det < 0.0001f) return false;
+        UpdateTransformCache();
+        if (!m_invertible) return false;
 
-        // Calculate U parameter and test bounds.
-        D3DXVECTOR3 tvec = orig - v0;
-        float u = D3DXVec3Dot(&tvec, &pvec);
-        if (u < 0.0f || u > det) return false;
+        // Bring the ray into the mesh's space once instead of moving every triangle out to it.
+        // The direction isn't normalized so the distance comes back in world units.
+        D3DXVECTOR3 localOrig, localDir;
+        D3DXVec3TransformCoord(&localOrig, &orig, &m_inverseMatrix);
+        D3DXVec3TransformNormal(&localDir, &dir, &m_inverseMatrix);
 
-        // Prepare to test V parameter.
-        D3DXVECTOR3 qvec;
-        D3DXVec3Cross(&qvec, &tvec, &edge1);
-
-        // Calculate V parameter and test bounds.
-        float v = D3DXVec3Dot(&dir, &qvec);
-        if (v < 0.0f || u + v > det) return false;
+        return m_mesh->pickTree.Intersect(localOrig, localDir, m_mirrored, dist);
+    }
 
-        *dist = D3DXVec3Dot(&edge2, &qvec) * (1.0f / det);
+    bool Actor::GetWorldBounds(D3DXVECTOR3 *min, D3DXVECTOR3 *max)
+    {
+        UpdateTransformCache();
+        if (!m_hasBounds) return false;
 
+        *min = m_worldMin;
+        *max = m_worldMax;
         return true;
     }
 
@@ -237,6 +275,12 @@ namespace UltraEd
 
         cJSON_AddStringToObject(actor, "script", m_script.c_str());
 
+        sprintf(buffer, "%i", m_poolSize);
+        cJSON_AddStringToObject(actor, "pool_size", buffer);
+
+        sprintf(buffer, "%i", m_level);
+        cJSON_AddStringToObject(actor, "level", buffer);
+
         if (m_collider)
         {
             cJSON_AddItemToObject(actor, "collider", m_collider->Save());
@@ -283,8 +327,27 @@ namespace UltraEd
         cJSON *script = cJSON_GetObjectItem(root, "script");
         m_script = script->valuestring;
 
+        // Scenes saved before prefabs have no pool size.
+        cJSON *poolSize = cJSON_GetObjectItem(root, "pool_size");
+        m_poolSize = poolSize ? atoi(poolSize->valuestring) : 0;
+
+        // Scenes saved before levels put everything in the first one.
+        cJSON *level = cJSON_GetObjectItem(root, "level");
+        m_level = level ? atoi(level->valuestring) : 0;
+        Transformed(true);
+
+        cJSON_ArrayForEach(resource, resources)
+        {
+            const char *path = resource->child->valuestring;
+            if (strcmp(resource->child->string, "vertexDataPath") == 0)
+            {
+                Import(path);
+            }
+        }
+
         SetCollider(NULL);
 
+        // Loaded after the vertices since mesh colliders are built from them.
         cJSON *collider = cJSON_GetObjectItem(root, "collider");
         if (collider)
         {
@@ -298,15 +361,10 @@ namespace UltraEd
                     SetCollider(new SphereCollider());
                     m_collider->Load(collider);
                     break;
-            }
-        }
-
-        cJSON_ArrayForEach(resource, resources)
-        {
-            const char *path = resource->child->valuestring;
-            if (strcmp(resource->child->string, "vertexDataPath") == 0)
-            {
-                Import(path);
+                case ColliderType::Mesh:
+                    SetCollider(new MeshCollider(m_mesh->GetTriangles()));
+                    m_collider->Load(collider);
+                    break;
             }
         }
 
@@ -2,8 +2,9 @@
 #define _ACTOR_H_
 
 #include <cJSON/cJSON.h>
+#include <functional>
 #include <vector>
-#include "VertexBuffer.h"
+#include "MeshCache.h"
 #include "Savable.h"
 #include "Util.h"
 #include "Collider.h"
@@ -15,6 +16,12 @@ namespace UltraEd
         Model, Camera
     };
 
+    // Every pooled instance is preallocated when the level loads.
+    static const int ActorMaxPoolSize = 256;
+
+    // Each level is its own overlay in the ROM and the engine switches between them with LoadLevel.
+    static const int ActorMaxLevel = 15;
+
     class Actor : public Savable
     {
     public:
@@ -29,50 +36,74 @@ namespace UltraEd
         const ActorType &GetType() { return m_type; }
         static GUID GetId(cJSON *item);
         static ActorType GetType(cJSON *item);
-        D3DXMATRIX GetMatrix();
+        const D3DXMATRIX &GetMatrix();
+        const D3DXMATRIX &GetInverseMatrix();
         const D3DXMATRIX &GetRotationMatrix() { return m_worldRot; }
-        void SetLocalRotationMatrix(const D3DXMATRIX &mat) { m_localRot = mat; }
-        bool Move(const D3DXVECTOR3 &position) { return Dirty([&] { m_position += position; }, &m_position); }
-        bool Scale(const D3DXVECTOR3 &position) { return Dirty([&] { m_scale += position; }, &m_scale); }
+        void SetLocalRotationMatrix(const D3DXMATRIX &mat) { m_localRot = mat; Transformed(true); }
+        bool Move(const D3DXVECTOR3 &position) { return Transformed(Dirty([&] { m_position += position; }, &m_position)); }
+        bool Scale(const D3DXVECTOR3 &position) { return Transformed(Dirty([&] { m_scale += position; }, &m_scale)); }
         bool Rotate(const float &angle, const D3DXVECTOR3 &dir);
         const D3DXVECTOR3 &GetPosition() { return m_position; }
-        bool SetPosition(const D3DXVECTOR3 &position) { return Dirty([&] { m_position = position; }, &m_position); }
+        bool SetPosition(const D3DXVECTOR3 &position) { return Transformed(Dirty([&] { m_position = position; }, &m_position)); }
         D3DXVECTOR3 GetRotation();
         bool SetRotation(const D3DXVECTOR3 &rotation);
         const D3DXVECTOR3 &GetScale() { return m_scale; }
-        bool SetScale(const D3DXVECTOR3 &scale) { return Dirty([&] { m_scale = scale; }, &m_scale); }
+        bool SetScale(const D3DXVECTOR3 &scale) { return Transformed(Dirty([&] { m_scale = scale; }, &m_scale)); }
         D3DXVECTOR3 GetRight();
         D3DXVECTOR3 GetForward();
         D3DXVECTOR3 GetUp();
         void GetAxisAngle(D3DXVECTOR3 *axis, float *angle);
-        const std::vector<Vertex> &GetVertices() { return m_vertices; }
+        const std::vector<Vertex> &GetVertices() { return m_mesh->vertices; }
+        std::vector<Vertex> GetTriangles() { return m_mesh->GetTriangles(); }
+        size_t GetTriangleCount() { return m_mesh->GetIndexCount() / 3; }
         bool Pick(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, float *dist);
+        bool GetWorldBounds(D3DXVECTOR3 *min, D3DXVECTOR3 *max);
+        void SetTransformListener(std::function<void()> listener) { m_transformListener = listener; }
         const std::string &GetScript() { return m_script; }
         void SetScript(const std::string &script) { Dirty([&] { m_script = script; }, &m_script); }
         Collider *GetCollider() { return m_collider.get(); }
         void SetCollider(Collider *collider) { Dirty([&] { m_collider = std::shared_ptr<Collider>(collider); }, &m_collider); }
         bool HasCollider() { return GetCollider() != NULL; }
+        int GetPoolSize() { return m_poolSize; }
+        bool SetPoolSize(int size) { return Dirty([&] { m_poolSize = size; }, &m_poolSize); }
+        int GetLevel() { return m_level; }
+        bool SetLevel(int level) { return Dirty([&] { m_level = level; }, &m_level); }
         cJSON *Save();
         bool Load(cJSON *root);
 
     protected:
-        std::shared_ptr<VertexBuffer> m_vertexBuffer;
         ActorType m_type;
+        IDirect3DVertexBuffer9 *GetVertexBuffer(IDirect3DDevice9 *device);
+        IDirect3DIndexBuffer9 *GetIndexBuffer(IDirect3DDevice9 *device);
         void Import(const char *filePath);
 
+    private:
+        bool Transformed(bool changed);
+        void UpdateTransformCache();
+
     private:
         GUID m_id;
         std::string m_name;
-        std::vector<Vertex> m_vertices;
+        std::shared_ptr<const MeshData> m_mesh;
         D3DMATERIAL9 m_material;
         D3DXVECTOR3 m_position;
         D3DXVECTOR3 m_scale;
         D3DXMATRIX m_localRot;
         D3DXMATRIX m_worldRot;
         std::string m_script;
-        bool IntersectTriangle(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir,
-            const D3DXVECTOR3 &v0, const D3DXVECTOR3 &v1, const D3DXVECTOR3 &v2, float *dist);
+        unsigned int m_transformVersion;
+        std::function<void()> m_transformListener;
+        unsigned int m_cachedVersion;
+        D3DXMATRIX m_worldMatrix;
+        D3DXMATRIX m_inverseMatrix;
+        bool m_invertible;
+        bool m_mirrored;
+        bool m_hasBounds;
+        D3DXVECTOR3 m_worldMin;
+        D3DXVECTOR3 m_worldMax;
         std::shared_ptr<Collider> m_collider;
+        int m_poolSize;
+        int m_level;
     };
 }
 
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include "ActorLoader.h"
+#include "MeshCache.h"
+
+namespace UltraEd
+{
+    ActorLoader::ActorLoader() :
+        m_workers(),
+        m_items(),
+        m_nextItem(0),
+        m_cancelled(false),
+        m_mutex(),
+        m_ready(),
+        m_nextReady(0),
+        m_logs()
+    { }
+
+    ActorLoader::~ActorLoader()
+    {
+        Cancel();
+    }
+
+    void ActorLoader::Start(cJSON *actors)
+    {
+        Cancel();
+
+        // Copied since the scene's document is freed as soon as loading returns.
+        cJSON *actor = NULL;
+        cJSON_ArrayForEach(actor, actors)
+        {
+            m_items.push_back(cJSON_Duplicate(actor, true));
+        }
+
+        m_ready.assign(m_items.size(), false);
+        m_nextReady = 0;
+        m_nextItem = 0;
+        m_cancelled = false;
+
+        // Leave a core for the render thread so the editor stays responsive.
+        size_t workerCount = std::min<size_t>(m_items.size(), std::max(2u, std::thread::hardware_concurrency()) - 1);
+        for (size_t i = 0; i < workerCount; i++)
+        {
+            m_workers.push_back(std::thread(&ActorLoader::Work, this));
+        }
+    }
+
+    cJSON *ActorLoader::Next()
+    {
+        // A later actor that's ready waits for the ones saved before it.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_nextReady >= m_items.size() || !m_ready[m_nextReady]) return NULL;
+
+        return m_items[m_nextReady++];
+    }
+
+    std::vector<std::string> ActorLoader::TakeLogs()
+    {
+        // Import results are queued here for the render thread to write to the console.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<std::string> logs;
+        logs.swap(m_logs);
+        return logs;
+    }
+
+    void ActorLoader::Finish()
+    {
+        for (auto &worker : m_workers)
+        {
+            worker.join();
+        }
+
+        m_workers.clear();
+    }
+
+    void ActorLoader::Cancel()
+    {
+        m_cancelled = true;
+        Finish();
+
+        // Items are freed by whoever takes them, so only the ones nobody took are left here.
+        for (size_t i = m_nextReady; i < m_items.size(); i++)
+        {
+            cJSON_Delete(m_items[i]);
+        }
+
+        m_ready.clear();
+        m_nextReady = 0;
+        m_items.clear();
+        m_logs.clear();
+    }
+
+    void ActorLoader::Work()
+    {
+        while (!m_cancelled)
+        {
+            size_t index = m_nextItem++;
+            if (index >= m_items.size()) return;
+
+            // The actor restores from the cache once it's back on the render thread.
+            std::string log;
+            cJSON *resource = NULL;
+            cJSON *resources = cJSON_GetObjectItem(m_items[index], "resources");
+            cJSON_ArrayForEach(resource, resources)
+            {
+                if (strcmp(resource->child->string, "vertexDataPath") == 0)
+                {
+                    MeshCache::Get(resource->child->valuestring, &log);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!log.empty()) m_logs.push_back(log);
+            m_ready[index] = true;
+        }
+    }
+}
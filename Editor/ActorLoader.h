@@ -0,0 +1,42 @@
+#ifndef _ACTORLOADER_H_
+#define _ACTORLOADER_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cJSON/cJSON.h>
+
+namespace UltraEd
+{
+    // Imports the meshes of saved actors on worker threads and hands back each actor once its
+    // mesh is cached, so the render thread only creates the device resources. Actors come back
+    // in the order they were saved since that decides script slots and the ROM's actor table.
+    class ActorLoader
+    {
+    public:
+        ActorLoader();
+        ~ActorLoader();
+        void Start(cJSON *actors);
+        cJSON *Next();
+        std::vector<std::string> TakeLogs();
+        void Finish();
+        void Cancel();
+
+    private:
+        void Work();
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::vector<cJSON *> m_items;
+        std::atomic<size_t> m_nextItem;
+        std::atomic<bool> m_cancelled;
+        std::mutex m_mutex;
+        std::vector<bool> m_ready;
+        size_t m_nextReady;
+        std::vector<std::string> m_logs;
+    };
+}
+
+#endif
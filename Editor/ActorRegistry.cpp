@@ -0,0 +1,237 @@
+#include "ActorRegistry.h"
+
+namespace UltraEd
+{
+    ActorRegistry::ActorRegistry() :
+        m_actors(),
+        m_pointers(),
+        m_slotIndices(),
+        m_slots(),
+        m_freeSlots(),
+        m_selected(),
+        m_selection(),
+        m_nextSelection(1),
+        m_dirty(),
+        m_dirtySlots(),
+        m_ids()
+    { }
+
+    ActorRegistry::~ActorRegistry()
+    {
+        // Actors can outlive the registry in the undo history so they must stop calling back.
+        for (const auto &actor : m_actors) actor->SetTransformListener(nullptr);
+    }
+
+    ActorHandle ActorRegistry::Add(std::shared_ptr<Actor> actor)
+    {
+        // An actor taking the place of one with the same id keeps its slot and selection.
+        auto existing = m_ids.find(actor->GetId());
+        if (existing != m_ids.end())
+        {
+            Slot &slot = m_slots[existing->second];
+            slot.generation++;
+            m_actors[slot.index]->SetTransformListener(nullptr);
+            m_actors[slot.index] = actor;
+            m_pointers[slot.index] = actor.get();
+            Listen(existing->second);
+            return { existing->second, slot.generation };
+        }
+
+        unsigned int slotIndex;
+        if (m_freeSlots.empty())
+        {
+            slotIndex = static_cast<unsigned int>(m_slots.size());
+            m_slots.push_back({ 0, 0 });
+            m_selected.push_back(0);
+            m_dirty.push_back(false);
+        }
+        else
+        {
+            slotIndex = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+
+        m_slots[slotIndex].index = static_cast<unsigned int>(m_actors.size());
+        m_actors.push_back(actor);
+        m_pointers.push_back(actor.get());
+        m_slotIndices.push_back(slotIndex);
+        m_ids[actor->GetId()] = slotIndex;
+        Listen(slotIndex);
+
+        return { slotIndex, m_slots[slotIndex].generation };
+    }
+
+    bool ActorRegistry::Remove(GUID id)
+    {
+        auto found = m_ids.find(id);
+        if (found == m_ids.end()) return false;
+
+        unsigned int slotIndex = found->second;
+        unsigned int index = m_slots[slotIndex].index;
+        unsigned int last = static_cast<unsigned int>(m_actors.size()) - 1;
+
+        m_actors[index]->SetTransformListener(nullptr);
+        MarkDirty(slotIndex);
+
+        // Fill the gap with the last actor so the array stays packed.
+        if (index != last)
+        {
+            m_actors[index] = std::move(m_actors[last]);
+            m_pointers[index] = m_pointers[last];
+            m_slotIndices[index] = m_slotIndices[last];
+            m_slots[m_slotIndices[index]].index = index;
+        }
+
+        m_actors.pop_back();
+        m_pointers.pop_back();
+        m_slotIndices.pop_back();
+
+        m_slots[slotIndex].generation++;
+        m_selection.erase(m_selected[slotIndex]);
+        m_selected[slotIndex] = 0;
+        m_freeSlots.push_back(slotIndex);
+        m_ids.erase(found);
+
+        return true;
+    }
+
+    void ActorRegistry::Clear()
+    {
+        // Generations carry on so handles from before the clear stay stale.
+        for (unsigned int slotIndex : m_slotIndices)
+        {
+            m_slots[slotIndex].generation++;
+            MarkDirty(slotIndex);
+        }
+
+        for (const auto &actor : m_actors) actor->SetTransformListener(nullptr);
+
+        m_freeSlots.clear();
+        for (unsigned int i = static_cast<unsigned int>(m_slots.size()); i > 0; i--)
+        {
+            m_freeSlots.push_back(i - 1);
+        }
+
+        ClearSelection();
+        m_actors.clear();
+        m_pointers.clear();
+        m_slotIndices.clear();
+        m_ids.clear();
+    }
+
+    std::shared_ptr<Actor> ActorRegistry::Find(GUID id) const
+    {
+        auto found = m_ids.find(id);
+        if (found == m_ids.end()) return NULL;
+        return m_actors[m_slots[found->second].index];
+    }
+
+    Actor *ActorRegistry::Get(ActorHandle handle) const
+    {
+        if (handle.slot >= m_slots.size()) return NULL;
+
+        const Slot &slot = m_slots[handle.slot];
+        if (slot.generation != handle.generation || slot.index >= m_actors.size()
+            || m_slotIndices[slot.index] != handle.slot)
+        {
+            return NULL;
+        }
+
+        return m_pointers[slot.index];
+    }
+
+    Actor *ActorRegistry::GetInSlot(unsigned int slot) const
+    {
+        if (slot >= m_slots.size()) return NULL;
+        return Get({ slot, m_slots[slot].generation });
+    }
+
+    ActorHandle ActorRegistry::GetHandle(size_t index) const
+    {
+        unsigned int slotIndex = m_slotIndices[index];
+        return { slotIndex, m_slots[slotIndex].generation };
+    }
+
+    bool ActorRegistry::IsSelected(GUID id) const
+    {
+        auto found = m_ids.find(id);
+        return found != m_ids.end() && m_selected[found->second] != 0;
+    }
+
+    void ActorRegistry::SetSelected(GUID id, bool selected)
+    {
+        auto found = m_ids.find(id);
+        if (found == m_ids.end() || (m_selected[found->second] != 0) == selected) return;
+
+        // Each selection gets the next number so the map keeps them in the order they were made.
+        unsigned long long &order = m_selected[found->second];
+        if (selected)
+        {
+            order = m_nextSelection++;
+            m_selection[order] = found->second;
+        }
+        else
+        {
+            m_selection.erase(order);
+            order = 0;
+        }
+    }
+
+    void ActorRegistry::ClearSelection()
+    {
+        for (const auto &selected : m_selection) m_selected[selected.second] = 0;
+        m_selection.clear();
+    }
+
+    std::vector<GUID> ActorRegistry::GetSelection() const
+    {
+        std::vector<GUID> ids;
+        for (const auto &selected : m_selection)
+        {
+            ids.push_back(m_actors[m_slots[selected.second].index]->GetId());
+        }
+        return ids;
+    }
+
+    Actor *ActorRegistry::GetFirstSelected() const
+    {
+        if (m_selection.empty()) return NULL;
+        return m_pointers[m_slots[m_selection.begin()->second].index];
+    }
+
+    Actor *ActorRegistry::GetLastSelected() const
+    {
+        if (m_selection.empty()) return NULL;
+        return m_pointers[m_slots[m_selection.rbegin()->second].index];
+    }
+
+    std::vector<unsigned int> ActorRegistry::TakeDirtySlots()
+    {
+        std::vector<unsigned int> slots;
+        slots.swap(m_dirtySlots);
+        for (unsigned int slot : slots) m_dirty[slot] = false;
+        return slots;
+    }
+
+    void ActorRegistry::Listen(unsigned int slot)
+    {
+        m_actors[m_slots[slot].index]->SetTransformListener([this, slot]() { MarkDirty(slot); });
+        MarkDirty(slot);
+    }
+
+    void ActorRegistry::MarkDirty(unsigned int slot)
+    {
+        if (m_dirty[slot]) return;
+
+        m_dirty[slot] = true;
+        m_dirtySlots.push_back(slot);
+    }
+
+    size_t ActorRegistry::GuidHash::operator()(const GUID &id) const
+    {
+        // Ids are mostly random already so folding the two halves together spreads them well.
+        unsigned long long halves[2];
+        memcpy(halves, &id, sizeof(halves));
+        return std::hash<unsigned long long>()(halves[0] ^ (halves[1] * 0x9E3779B97F4A7C15ULL));
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef _ACTORREGISTRY_H_
+#define _ACTORREGISTRY_H_
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Actor.h"
+
+namespace UltraEd
+{
+    // Refers to an actor by the slot it was given. The slot's generation moves on whenever its
+    // actor leaves so an old handle never resolves to the actor that takes the slot next.
+    struct ActorHandle
+    {
+        unsigned int slot;
+        unsigned int generation;
+    };
+
+    // Scene actors packed into one array for iteration, with an id to slot index for lookups
+    // and the selection kept in the order it was made. Removing an actor moves the last one
+    // into its place.
+    // Slots whose actor was added, removed or transformed are queued until taken.
+    class ActorRegistry
+    {
+    public:
+        ActorRegistry();
+        ~ActorRegistry();
+        ActorRegistry(const ActorRegistry &) = delete;
+        ActorRegistry &operator=(const ActorRegistry &) = delete;
+        ActorHandle Add(std::shared_ptr<Actor> actor);
+        bool Remove(GUID id);
+        void Clear();
+        std::shared_ptr<Actor> Find(GUID id) const;
+        Actor *Get(ActorHandle handle) const;
+        Actor *GetInSlot(unsigned int slot) const;
+        ActorHandle GetHandle(size_t index) const;
+        const std::vector<Actor *> &GetActors() const { return m_pointers; }
+        size_t GetSize() const { return m_actors.size(); }
+        std::vector<std::shared_ptr<Actor>>::const_iterator begin() const { return m_actors.begin(); }
+        std::vector<std::shared_ptr<Actor>>::const_iterator end() const { return m_actors.end(); }
+        bool IsSelected(GUID id) const;
+        bool IsSelected(size_t index) const { return m_selected[m_slotIndices[index]] != 0; }
+        void SetSelected(GUID id, bool selected);
+        void ClearSelection();
+        bool HasSelection() const { return !m_selection.empty(); }
+        std::vector<GUID> GetSelection() const;
+        Actor *GetFirstSelected() const;
+        Actor *GetLastSelected() const;
+        std::vector<unsigned int> TakeDirtySlots();
+
+    private:
+        void Listen(unsigned int slot);
+        void MarkDirty(unsigned int slot);
+
+    private:
+        struct Slot
+        {
+            unsigned int index;
+            unsigned int generation;
+        };
+
+        struct GuidHash
+        {
+            size_t operator()(const GUID &id) const;
+        };
+
+    private:
+        std::vector<std::shared_ptr<Actor>> m_actors;
+        std::vector<Actor *> m_pointers;
+        std::vector<unsigned int> m_slotIndices;
+        std::vector<Slot> m_slots;
+        std::vector<unsigned int> m_freeSlots;
+        std::vector<unsigned long long> m_selected;
+        std::map<unsigned long long, unsigned int> m_selection;
+        unsigned long long m_nextSelection;
+        std::vector<bool> m_dirty;
+        std::vector<unsigned int> m_dirtySlots;
+        std::unordered_map<GUID, unsigned int, GuidHash> m_ids;
+    };
+}
+
+#endif
@@ -3,24 +3,27 @@
 
 namespace UltraEd
 {
+    // Undo history is trimmed from the oldest unit once it holds more than this.
+    static const size_t MaxUndoBytes = 8 * 1024 * 1024;
+
+    // Length given to a field the state didn't have so patching removes it.
+    static const unsigned int MissingField = 0xFFFFFFFF;
+
     Auditor::Auditor(Scene *scene) :
         m_undoUnits(),
         m_position(0),
+        m_size(0),
         m_scene(scene),
-        m_savedStates(),
         m_potentials(),
-        m_maxUnits(100),
+        m_potentialGroupId(GUID_NULL),
         m_locked(false)
     { }
 
-    Auditor::~Auditor()
-    {
-        CleanUp();
-    }
-
     void Auditor::Undo()
     {
         Lock([&]() {
+            Seal(GUID_NULL);
+
             // Don't adjust actor selections when nothing to undo.
             if (m_position > 0) m_scene->UnselectAll();
             RunUndo();
@@ -30,6 +33,8 @@ namespace UltraEd
     void Auditor::Redo()
     {
         Lock([&]() {
+            Seal(GUID_NULL);
+
             // Don't adjust actor selections when nothing to redo.
             if (m_position < m_undoUnits.size()) m_scene->UnselectAll();
             RunRedo();
@@ -41,8 +46,7 @@ namespace UltraEd
         if (m_position > 0)
         {
             m_position--;
-            auto state = m_undoUnits[m_position].undo();
-            m_undoUnits[m_position].state = state;
+            Run(m_undoUnits[m_position], true);
 
             // Keep undoing when this unit is a part of a group.
             int nextUndoPos = static_cast<int>(m_position - 1);
@@ -59,8 +63,7 @@ namespace UltraEd
     {
         if (m_position < m_undoUnits.size())
         {
-            auto state = m_undoUnits[m_position].state;
-            m_undoUnits[m_position].redo(state);
+            Run(m_undoUnits[m_position], false);
             m_position++;
 
             // Keep redoing when this unit is a part of a group.
@@ -73,6 +76,206 @@ namespace UltraEd
         }
     }
 
+    void Auditor::Run(UndoUnit &unit, bool undo)
+    {
+        switch (unit.type)
+        {
+            case UndoType::AddActor:
+            {
+                if (undo)
+                {
+                    // Saved as it is now since later units may have changed it since it was added.
+                    auto actor = m_scene->GetActor(unit.actorId);
+                    Resize(unit, [&]() { unit.state = Serialize(actor->Save()); });
+                    m_scene->Delete(actor);
+                }
+                else
+                {
+                    cJSON *state = cJSON_Parse(unit.state.c_str());
+                    m_scene->RestoreActor(state);
+                    m_scene->SelectActorById(unit.actorId);
+                    cJSON_Delete(state);
+                }
+                break;
+            }
+            case UndoType::DeleteActor:
+            {
+                if (undo)
+                {
+                    cJSON *state = cJSON_Parse(unit.state.c_str());
+                    m_scene->RestoreActor(state);
+                    m_scene->SelectActorById(unit.actorId);
+                    cJSON_Delete(state);
+                }
+                else
+                {
+                    m_scene->Delete(m_scene->GetActor(unit.actorId));
+                }
+                break;
+            }
+            case UndoType::ChangeActor:
+            {
+                cJSON *state = CurrentState(unit);
+                Patch(state, undo ? unit.undoDelta : unit.redoDelta);
+                m_scene->RestoreActor(state);
+                m_scene->SelectActorById(unit.actorId, false);
+                cJSON_Delete(state);
+                break;
+            }
+            case UndoType::ChangeScene:
+            {
+                cJSON *state = CurrentState(unit);
+                Patch(state, undo ? unit.undoDelta : unit.redoDelta);
+                m_scene->PartialLoad(state);
+                cJSON_Delete(state);
+                break;
+            }
+        }
+    }
+
+    void Auditor::Seal(GUID groupId)
+    {
+        // Units of a group still being recorded keep their full state since their changes may not have
+        // happened yet. Everything else has finished and is cut down to the fields that changed.
+        for (size_t i = m_position; i > 0 && !m_undoUnits[i - 1].pending.empty(); i--)
+        {
+            UndoUnit &unit = m_undoUnits[i - 1];
+            if (groupId != GUID_NULL && unit.groupId == groupId) continue;
+
+            cJSON *before = cJSON_Parse(unit.pending.c_str());
+            cJSON *after = CurrentState(unit);
+
+            Resize(unit, [&]() {
+                unit.pending.clear();
+                unit.pending.shrink_to_fit();
+                if (before == NULL || after == NULL) return;
+
+                unit.undoDelta = Diff(after, before);
+                unit.redoDelta = Diff(before, after);
+            });
+
+            // Saving the actor to compare clears its changes so the scene keeps track of them instead.
+            if (!unit.redoDelta.empty()) m_scene->SetDirty(true);
+
+            cJSON_Delete(before);
+            cJSON_Delete(after);
+        }
+    }
+
+    void Auditor::Trim()
+    {
+        // Oldest units go first and whole groups at a time so an undo never stops partway through one.
+        while (m_size > MaxUndoBytes)
+        {
+            GUID groupId = m_undoUnits.front().groupId;
+            size_t count = 1;
+            while (groupId != GUID_NULL && count < m_undoUnits.size() && m_undoUnits[count].groupId == groupId)
+                count++;
+
+            // The newest change stays undoable however large it is.
+            if (count >= m_position) break;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                m_size -= Size(m_undoUnits.front());
+                m_undoUnits.pop_front();
+            }
+
+            m_position -= count;
+        }
+    }
+
+    void Auditor::Resize(UndoUnit &unit, std::function<void()> change)
+    {
+        m_size -= Size(unit);
+        change();
+        m_size += Size(unit);
+    }
+
+    cJSON *Auditor::CurrentState(const UndoUnit &unit)
+    {
+        if (unit.type == UndoType::ChangeScene) return m_scene->PartialSave(NULL);
+
+        auto actor = m_scene->GetActor(unit.actorId);
+        return actor ? actor->Save() : NULL;
+    }
+
+    size_t Auditor::Size(const UndoUnit &unit)
+    {
+        return sizeof(UndoUnit) + unit.name.size() + unit.pending.size() + unit.undoDelta.size() +
+            unit.redoDelta.size() + unit.state.size();
+    }
+
+    std::string Auditor::Serialize(cJSON *state)
+    {
+        // Takes ownership of the state.
+        char *text = cJSON_PrintUnformatted(state);
+        std::string result(text != NULL ? text : "");
+        cJSON_free(text);
+        cJSON_Delete(state);
+        return result;
+    }
+
+    std::vector<unsigned char> Auditor::Diff(const cJSON *from, const cJSON *to)
+    {
+        // Each field of the target that differs is written as its name's length and name, then its value's
+        // length and value as JSON. Fields the target lacks are written with no value.
+        std::vector<unsigned char> delta;
+        auto write = [&](const char *name, const cJSON *value) {
+            unsigned short nameLength = static_cast<unsigned short>(strlen(name));
+            delta.insert(delta.end(), reinterpret_cast<unsigned char *>(&nameLength),
+                reinterpret_cast<unsigned char *>(&nameLength) + sizeof(nameLength));
+            delta.insert(delta.end(), name, name + nameLength);
+
+            char *text = value != NULL ? cJSON_PrintUnformatted(value) : NULL;
+            unsigned int valueLength = text != NULL ? static_cast<unsigned int>(strlen(text)) : MissingField;
+            delta.insert(delta.end(), reinterpret_cast<unsigned char *>(&valueLength),
+                reinterpret_cast<unsigned char *>(&valueLength) + sizeof(valueLength));
+            if (text != NULL) delta.insert(delta.end(), text, text + valueLength);
+            cJSON_free(text);
+        };
+
+        const cJSON *field = NULL;
+        cJSON_ArrayForEach(field, to)
+        {
+            const cJSON *other = cJSON_GetObjectItemCaseSensitive(from, field->string);
+            if (other == NULL || !cJSON_Compare(field, other, true)) write(field->string, field);
+        }
+
+        cJSON_ArrayForEach(field, from)
+        {
+            if (cJSON_GetObjectItemCaseSensitive(to, field->string) == NULL) write(field->string, NULL);
+        }
+
+        return delta;
+    }
+
+    void Auditor::Patch(cJSON *state, const std::vector<unsigned char> &delta)
+    {
+        if (state == NULL) return;
+
+        size_t offset = 0;
+        while (offset < delta.size())
+        {
+            unsigned short nameLength;
+            memcpy(&nameLength, &delta[offset], sizeof(nameLength));
+            offset += sizeof(nameLength);
+            std::string name(reinterpret_cast<const char *>(&delta[offset]), nameLength);
+            offset += nameLength;
+
+            unsigned int valueLength;
+            memcpy(&valueLength, &delta[offset], sizeof(valueLength));
+            offset += sizeof(valueLength);
+
+            cJSON_DeleteItemFromObjectCaseSensitive(state, name.c_str());
+            if (valueLength == MissingField) continue;
+
+            std::string value(reinterpret_cast<const char *>(&delta[offset]), valueLength);
+            offset += valueLength;
+            cJSON_AddItemToObject(state, name.c_str(), cJSON_Parse(value.c_str()));
+        }
+    }
+
     std::array<std::string, 2> Auditor::Titles()
     {
         std::string undo("Undo");
@@ -101,25 +304,6 @@ namespace UltraEd
         return { undo, redo };
     }
 
-    void Auditor::CleanUp()
-    {
-        for (auto state : m_savedStates)
-        {
-            cJSON_Delete(state.second);
-        }
-        m_savedStates.clear();
-    }
-
-    cJSON *Auditor::SaveState(GUID id, std::function<cJSON*()> save)
-    {
-        // Identifying states avoids storing duplicates.
-        if (m_savedStates.find(id) == m_savedStates.end())
-        {
-            m_savedStates[id] = save();
-        }
-        return m_savedStates[id];
-    }
-
     void Auditor::Lock(std::function<void()> block)
     {
         m_locked = true;
@@ -138,100 +322,66 @@ namespace UltraEd
         m_undoUnits.clear();
         m_potentials.clear();
         m_position = 0;
-        CleanUp();
+        m_size = 0;
     }
 
     void Auditor::Add(UndoUnit unit)
     {
+        // A unit from another group means the ones before it are done changing.
+        Seal(unit.groupId);
+
         // Clear redo history when adding new unit and not at head.
         while (m_undoUnits.size() != m_position)
         {
-            m_undoUnits.pop_back();
-        }
-
-        // Prevent recorded undo units from growing too large by 
-        // shifting all units left and replacing the last with newest unit.
-        if (m_undoUnits.size() == m_maxUnits)
-        {
-            rotate(m_undoUnits.begin(), m_undoUnits.begin() + 1, m_undoUnits.end());
+            m_size -= Size(m_undoUnits.back());
             m_undoUnits.pop_back();
         }
 
         // Add new unit and set current position to it.
-        m_undoUnits.push_back(unit);
+        m_size += Size(unit);
+        m_undoUnits.push_back(std::move(unit));
         m_position = m_undoUnits.size();
+
+        Trim();
     }
 
     void Auditor::AddActor(const std::string &name, GUID actorId, GUID groupId)
     {
         if (m_locked) return;
 
-        GUID redoStateId = Util::NewGuid();
-        Add({
-            std::string("Add ").append(name),
-            [=]() {
-                auto actor = m_scene->GetActor(actorId);
-                auto state = SaveState(redoStateId, [=]() { return actor->Save(); });
-                m_scene->Delete(actor);
-                return state;
-            },
-            [=](cJSON *oldState) {
-                m_scene->RestoreActor(oldState);
-                m_scene->SelectActorById(actorId);
-            },
-            groupId
-        });
+        UndoUnit unit = { std::string("Add ").append(name), UndoType::AddActor, actorId, groupId };
+        Add(unit);
     }
 
     void Auditor::DeleteActor(const std::string &name, GUID actorId, GUID groupId)
     {
         if (m_locked) return;
 
-        auto state = SaveState(Util::NewGuid(), [=]() { return m_scene->GetActor(actorId)->Save(); });
-        Add({
-            std::string("Delete ").append(name),
-            [=]() {
-                m_scene->RestoreActor(state);
-                m_scene->SelectActorById(actorId);
-                return state;
-            },
-            [=](cJSON *oldState) {
-                m_scene->Delete(m_scene->GetActor(actorId));
-            },
-            groupId
-        });
+        UndoUnit unit = { std::string("Delete ").append(name), UndoType::DeleteActor, actorId, groupId };
+        unit.state = Serialize(m_scene->GetActor(actorId)->Save());
+        Add(unit);
     }
 
     void Auditor::ChangeActor(const std::string &name, GUID actorId, GUID groupId)
     {
         if (m_locked) return;
 
-        auto state = SaveState(Util::NewGuid(), [=]() { return m_scene->GetActor(actorId)->Save(); });
-        GUID redoStateId = Util::NewGuid();
-        Add({
-            name,
-            [=]() {
-                auto actor = m_scene->GetActor(actorId);
-                auto oldState = SaveState(redoStateId, [=]() { return actor->Save(); });
-
-                m_scene->RestoreActor(state);
-                m_scene->SelectActorById(actorId, false);
-
-                // Return state saved before restore so system can "undo" to this point.
-                return oldState;
-            },
-            [=](cJSON *oldState) {
-                m_scene->RestoreActor(oldState);
-                m_scene->SelectActorById(actorId, false);
-            },
-            groupId
-        });
+        UndoUnit unit = { name, UndoType::ChangeActor, actorId, groupId };
+        unit.pending = Serialize(m_scene->GetActor(actorId)->Save());
+        Add(unit);
     }
 
     std::function<void()> Auditor::PotentialChangeActor(const std::string &name, GUID actorId, GUID groupId)
     {
         if (m_locked) return []() {};
 
+        // Only the current group's potentials can still be triggered.
+        if (groupId != m_potentialGroupId)
+        {
+            m_potentials.clear();
+            m_potentialGroupId = groupId;
+        }
+
         std::string uniqueId = Util::GuidToString(actorId).append(Util::GuidToString(groupId));
 
         if (m_potentials.find(uniqueId) != m_potentials.end())
@@ -248,21 +398,8 @@ namespace UltraEd
     {
         if (m_locked) return;
 
-        GUID redoStateId = Util::NewGuid();
-        auto sceneState = SaveState(Util::NewGuid(), [=]() { return m_scene->PartialSave(NULL); });
-        Add({
-            name,
-            [=]() {
-                auto oldState = SaveState(redoStateId, [=]() { return m_scene->PartialSave(NULL); });
-
-                m_scene->PartialLoad(sceneState);
-
-                // Return state saved before restore so system can "undo" to this point.
-                return oldState;
-            },
-            [=](cJSON *oldState) {
-                m_scene->PartialLoad(oldState);
-            }
-        });
+        UndoUnit unit = { name, UndoType::ChangeScene, GUID_NULL, GUID_NULL };
+        unit.pending = Serialize(m_scene->PartialSave(NULL));
+        Add(unit);
     }
 }
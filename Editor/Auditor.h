@@ -1,6 +1,7 @@
 #ifndef _AUDITOR_H_
 #define _AUDITOR_H_
 
+#include <deque>
 #include <functional>
 #include <vector>
 #include "Actor.h"
@@ -9,20 +10,31 @@ namespace UltraEd
 {
     class Scene;
 
+    enum class UndoType
+    {
+        AddActor, DeleteActor, ChangeActor, ChangeScene
+    };
+
     struct UndoUnit
     {
         std::string name;
-        std::function<cJSON*()> undo;
-        std::function<void(cJSON*)> redo;
+        UndoType type;
+        GUID actorId;
         GUID groupId;
-        cJSON *state;
+
+        // State from before a change, swapped for the fields that differ once the change is done.
+        std::string pending;
+        std::vector<unsigned char> undoDelta;
+        std::vector<unsigned char> redoDelta;
+
+        // The whole actor for units that bring one back.
+        std::string state;
     };
 
     class Auditor
     {
     public:
         Auditor(Scene *scene);
-        ~Auditor();
         void Undo();
         void Redo();
         void Reset();
@@ -32,22 +44,30 @@ namespace UltraEd
         void ChangeScene(const std::string &name);
         std::array<std::string, 2> Titles();
         std::function<void()> PotentialChangeActor(const std::string &name, GUID actorId, GUID groupId);
+        size_t GetSize() { return m_size; }
 
     private:
         void Add(UndoUnit unit);
         void RunUndo();
         void RunRedo();
-        void CleanUp();
-        cJSON *SaveState(GUID id, std::function<cJSON*()> save);
+        void Run(UndoUnit &unit, bool undo);
+        void Seal(GUID groupId);
+        void Trim();
+        void Resize(UndoUnit &unit, std::function<void()> change);
+        cJSON *CurrentState(const UndoUnit &unit);
+        static size_t Size(const UndoUnit &unit);
+        static std::string Serialize(cJSON *state);
+        static std::vector<unsigned char> Diff(const cJSON *from, const cJSON *to);
+        static void Patch(cJSON *state, const std::vector<unsigned char> &delta);
         void Lock(std::function<void()> block);
 
     private:
-        std::vector<UndoUnit> m_undoUnits;
+        std::deque<UndoUnit> m_undoUnits;
         size_t m_position;
+        size_t m_size;
         Scene *m_scene;
-        std::map<GUID, cJSON *> m_savedStates;
         std::map<std::string, std::tuple<bool, std::function<void()>>> m_potentials;
-        const int m_maxUnits;
+        GUID m_potentialGroupId;
         bool m_locked;
     };
 }
@@ -26,6 +26,8 @@ namespace UltraEd
 
     void BoxCollider::Build()
     {
+        m_vertexVersion++;
+
         // Top square
         BuildLine(D3DXVECTOR3(m_center.x - m_extents.x, m_center.y + m_extents.y, m_center.z + m_extents.z),
             D3DXVECTOR3(m_center.x + m_extents.x, m_center.y + m_extents.y, m_center.z + m_extents.z));
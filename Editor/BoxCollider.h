@@ -12,6 +12,7 @@ namespace UltraEd
         BoxCollider();
         BoxCollider(const std::vector<Vertex> &vertices);
         void Build();
+        Collider *Clone() { return new BoxCollider(*this); }
         const D3DXVECTOR3 &GetExtents() { return m_extents; }
         cJSON *Save();
         bool Load(cJSON *root);
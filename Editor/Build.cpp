@@ -3,7 +3,9 @@
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 
+#include <algorithm>
 #include <regex>
+#include <set>
 #include <STB/stb_image.h>
 #include <STB/stb_image_resize.h>
 #include <STB/stb_image_write.h>
@@ -11,6 +13,7 @@
 #include "util.h"
 #include "BoxCollider.h"
 #include "SphereCollider.h"
+#include "MeshCollider.h"
 #include "Settings.h"
 #include "shlwapi.h"
 #include "PubSub.h"
@@ -18,7 +21,20 @@
 
 namespace UltraEd
 {
-    bool Build::WriteSpecFile(const std::vector<Actor *> &actors)
+    // Size of the engine's actor_record and the index it uses for records without a segment.
+    static const unsigned short ActorRecordSize = 84;
+    static const short NoSegment = -1;
+
+    // Layout of the EEPROM the engine writes script costs to. The first block is a header
+    // naming the level and each of its actor slots after it gets one block.
+    static const char *ScriptCostFile = "scripts.eep";
+    static const int ScriptCostBlockSize = 8;
+    static const int ScriptCostMaxSlots = 255;
+
+    // Written into Engine\levels\<n> for every level.
+    static const char *LevelHeaders[] = { "scene.h", "segments.h", "actors.h", "mappings.h", "scripts.h", "collisions.h" };
+
+    bool Build::WriteSpecFile(const std::vector<std::vector<Actor *>> &levels)
     {
         std::string specSegments, specIncludes;
         const char *specHeader = "#include <nusys.h>\n\n"
@@ -43,74 +59,117 @@ namespace UltraEd
             "\n\tinclude \"code\"";
         const char *specIncludeEnd = "\nendwave";
 
-        std::vector<std::string> resourceCache;
+        // Every level overlay is placed right after the resident code so they all share one address.
+        for (size_t level = 0; level < levels.size(); level++)
+        {
+            std::string name = std::string("level").append(std::to_string(level));
+            specSegments.append("\nbeginseg\n\tname \"").append(name).append("\"\n\tflags OBJECT\n\tafter \"code\"");
+            specSegments.append("\n\tinclude \"").append(name).append("segment.o\"\nendseg\n");
+            specIncludes.append("\n\tinclude \"").append(name).append("\"");
+        }
+
+        // Resource names run on across levels so they stay unique, but each level only
+        // shares data between its own actors.
         int loopCount = 0;
-        for (const auto &actor : actors)
+        for (size_t level = 0; level < levels.size(); level++)
         {
-            std::string newResName = Util::NewResourceName(loopCount++);
+            std::vector<std::string> resourceCache;
+            for (const auto &actor : levels[level])
+            {
+                std::string newResName = Util::NewResourceName(loopCount++);
 
-            if (actor->GetType() != ActorType::Model) continue;
+                if (actor->GetType() != ActorType::Model) continue;
 
-            std::map<std::string, std::string> resources = actor->GetResources();
+                std::map<std::string, std::string> resources = actor->GetResources();
 
-            if (find(resourceCache.begin(), resourceCache.end(), resources["vertexDataPath"])
-                == resourceCache.end())
-            {
-                std::string id = Util::GuidToString(actor->GetId());
-                id.insert(0, Util::RootPath().append("\\"));
-                id.append(".rom.sos");
+                if (find(resourceCache.begin(), resourceCache.end(), resources["vertexDataPath"])
+                    == resourceCache.end())
+                {
+                    std::string id = Util::GuidToString(actor->GetId());
+                    id.insert(0, Util::RootPath().append("\\"));
+                    id.append(".rom.sos");
 
-                std::string modelName(newResName);
-                modelName.append("_M");
+                    std::string modelName(newResName);
+                    modelName.append("_M");
 
-                specSegments.append("\nbeginseg\n\tname \"");
-                specSegments.append(modelName);
-                specSegments.append("\"\n\tflags RAW\n\tinclude \"");
-                specSegments.append(id);
-                specSegments.append("\"\nendseg\n");
+                    specSegments.append("\nbeginseg\n\tname \"");
+                    specSegments.append(modelName);
+                    specSegments.append("\"\n\tflags RAW\n\tinclude \"");
+                    specSegments.append(id);
+                    specSegments.append("\"\nendseg\n");
 
-                specIncludes.append("\n\tinclude \"");
-                specIncludes.append(modelName);
-                specIncludes.append("\"");
+                    specIncludes.append("\n\tinclude \"");
+                    specIncludes.append(modelName);
+                    specIncludes.append("\"");
 
-                resourceCache.push_back(resources["vertexDataPath"]);
-            }
+                    resourceCache.push_back(resources["vertexDataPath"]);
+                }
 
-            if (resources.count("textureDataPath") &&
-                find(resourceCache.begin(), resourceCache.end(), resources["textureDataPath"])
-                == resourceCache.end())
-            {
-                // Load the set texture and resize to required dimensions.
-                std::string path = resources["textureDataPath"];
-                int width, height, channels;
-                unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 3);
-                if (data)
+                // Mesh collider trees have the actor's transform baked in so they're never shared.
+                if (actor->HasCollider() && actor->GetCollider()->GetType() == ColliderType::Mesh)
                 {
-                    auto dimensions = static_cast<Model *>(actor)->TextureDimensions();
-                    if (stbir_resize_uint8(data, width, height, 0, data, dimensions[0], dimensions[1], 0, 3))
+                    std::string id = Util::GuidToString(actor->GetId());
+                    id.insert(0, Util::RootPath().append("\\"));
+                    id.append(".bvh.rom.sos");
+
+                    std::string treeName(newResName);
+                    treeName.append("_C");
+
+                    specSegments.append("\nbeginseg\n\tname \"");
+                    specSegments.append(treeName);
+                    specSegments.append("\"\n\tflags RAW\n\tinclude \"");
+                    specSegments.append(id);
+                    specSegments.append("\"\nendseg\n");
+
+                    specIncludes.append("\n\tinclude \"");
+                    specIncludes.append(treeName);
+                    specIncludes.append("\"");
+                }
+
+                if (resources.count("textureDataPath") &&
+                    find(resourceCache.begin(), resourceCache.end(), resources["textureDataPath"])
+                    == resourceCache.end())
+                {
+                    // Load the set texture and resize to required dimensions.
+                    std::string path = resources["textureDataPath"];
+                    int width, height, channels;
+                    unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 3);
+                    if (data)
                     {
-                        path.append(".rom.png");
-                        stbi_write_png(path.c_str(), dimensions[0], dimensions[1], 3, data, 0);
+                        auto dimensions = static_cast<Model *>(actor)->TextureDimensions();
+                        if (stbir_resize_uint8(data, width, height, 0, data, dimensions[0], dimensions[1], 0, 3))
+                        {
+                            path.append(".rom.png");
+                            stbi_write_png(path.c_str(), dimensions[0], dimensions[1], 3, data, 0);
+                        }
+
+                        stbi_image_free(data);
                     }
 
-                    stbi_image_free(data);
-                }
-
-                std::string textureName(newResName);
-                textureName.append("_T");
+                    std::string textureName(newResName);
+                    textureName.append("_T");
 
-                specSegments.append("\nbeginseg\n\tname \"");
-                specSegments.append(textureName);
-                specSegments.append("\"\n\tflags RAW\n\tinclude \"");
-                specSegments.append(path);
-                specSegments.append("\"\nendseg\n");
+                    specSegments.append("\nbeginseg\n\tname \"");
+                    specSegments.append(textureName);
+                    specSegments.append("\"\n\tflags RAW\n\tinclude \"");
+                    specSegments.append(path);
+                    specSegments.append("\"\nendseg\n");
 
-                specIncludes.append("\n\tinclude \"");
-                specIncludes.append(textureName);
-                specIncludes.append("\"");
+                    specIncludes.append("\n\tinclude \"");
+                    specIncludes.append(textureName);
+                    specIncludes.append("\"");
 
-                resourceCache.push_back(resources["textureDataPath"]);
+                    resourceCache.push_back(resources["textureDataPath"]);
+                }
             }
+
+            // WriteActorsFile always writes the level's actor table so it always gets a segment.
+            std::string tableName = std::string("UER_Actors").append(std::to_string(level));
+            std::string tablePath = Util::RootPath().append("\\").append(tableName).append(".rom.sos");
+            specSegments.append("\nbeginseg\n\tname \"").append(tableName).append("\"\n\tflags RAW\n\tinclude \"");
+            specSegments.append(tablePath);
+            specSegments.append("\"\nendseg\n");
+            specIncludes.append("\n\tinclude \"").append(tableName).append("\"");
         }
 
         std::string specPath = GetPathFor("Engine\\spec");
@@ -137,6 +196,9 @@ namespace UltraEd
         std::string mode = Settings::GetVideoMode() == VideoMode::NTSC ? "OS_VI_NTSC_LAN1" : "OS_VI_PAL_LAN1";
         sprintf(buffer, "#define _UER_VIDEO_MODE %s\n", mode.c_str());
 
+        // Script calls are only timed in the engine when this is defined.
+        if (Settings::GetProfileScripts()) strcat(buffer, "#define _UER_PROFILE_SCRIPTS\n");
+
         std::string path = GetPathFor("Engine\\definitions.h");
         std::unique_ptr<FILE, decltype(fclose) *> file(fopen(path.c_str(), "w"), fclose);
         if (file == NULL) return false;
@@ -144,10 +206,68 @@ namespace UltraEd
         return true;
     }
 
-    bool Build::WriteSegmentsFile(const std::vector<Actor *> &actors, std::map<std::string, std::string> *resourceCache)
+    bool Build::WriteLevelsFile(int levelCount)
     {
-        std::string romSegments;
-        int loopCount = 0;
+        // The resident code finds each overlay through the segment symbols makerom places and
+        // the entry its scene.c exports. Entries are only valid while their level is loaded.
+        std::string externs, table("\nstatic const level_overlay _UER_Levels[] = {"), segments("LEVELSEGMENTS =");
+        std::string dependencies;
+        for (int level = 0; level < levelCount; level++)
+        {
+            std::string name = std::string("_level").append(std::to_string(level)).append("Segment");
+            table.append("\n\t{");
+            for (const char *section : { "Rom", "Text", "Data", "Bss" })
+            {
+                externs.append("extern u8 ").append(name).append(section).append("Start[], ")
+                    .append(name).append(section).append("End[];\n");
+                table.append(" ").append(name).append(section).append("Start, ")
+                    .append(name).append(section).append("End,");
+            }
+
+            std::string entry = std::string("_UER_Level").append(std::to_string(level));
+            externs.append("extern const level_entry ").append(entry).append(";\n");
+            table.append(" &").append(entry).append(" },");
+            segments.append(" level").append(std::to_string(level)).append("segment.o");
+
+            // Make rebuilds a level when any of its generated headers change.
+            dependencies.append("\nlevel").append(std::to_string(level)).append("segment.o:");
+            for (const char *header : LevelHeaders)
+            {
+                dependencies.append(" levels\\").append(std::to_string(level)).append("\\").append(header);
+            }
+        }
+        table.append("\n};\n");
+        segments.append("\n").append(dependencies).append("\n");
+
+        std::string levelsPath = GetPathFor("Engine\\levels.h");
+        std::unique_ptr<FILE, decltype(fclose) *> file(fopen(levelsPath.c_str(), "w"), fclose);
+        if (file == NULL) return false;
+        fwrite(externs.c_str(), 1, externs.size(), file.get());
+        fwrite(table.c_str(), 1, table.size(), file.get());
+
+        std::string makePath = GetPathFor("Engine\\levels.mk");
+        std::unique_ptr<FILE, decltype(fclose) *> makeFile(fopen(makePath.c_str(), "w"), fclose);
+        if (makeFile == NULL) return false;
+        fwrite(segments.c_str(), 1, segments.size(), makeFile.get());
+        return true;
+    }
+
+    bool Build::WriteSegmentsFile(int level, const std::vector<Actor *> &actors, int firstResource,
+        std::map<std::string, std::string> *resourceCache, std::map<std::string, int> *segmentIndices)
+    {
+        std::string romSegments, segmentTable;
+        int loopCount = firstResource;
+
+        // Segments are also listed in a table so the actor table can refer to them by index.
+        auto addSegment = [&](const std::string &name) {
+            romSegments.append("extern u8 _").append(name).append("SegmentRomStart[];\n");
+            romSegments.append("extern u8 _").append(name).append("SegmentRomEnd[];\n");
+            segmentTable.append("\n\t{ _").append(name).append("SegmentRomStart, _").append(name).append("SegmentRomEnd },");
+
+            int index = static_cast<int>(segmentIndices->size());
+            (*segmentIndices)[name] = index;
+        };
+
         for (const auto &actor : actors)
         {
             std::string newResName = Util::NewResourceName(loopCount++);
@@ -158,77 +278,97 @@ namespace UltraEd
 
             if (resourceCache->find(resources["vertexDataPath"]) == resourceCache->end())
             {
-                std::string modelName(newResName);
-                modelName.append("_M");
-
-                romSegments.append("extern u8 _");
-                romSegments.append(modelName);
-                romSegments.append("SegmentRomStart[];\n");
-                romSegments.append("extern u8 _");
-                romSegments.append(modelName);
-                romSegments.append("SegmentRomEnd[];\n");
-
+                addSegment(std::string(newResName).append("_M"));
                 (*resourceCache)[resources["vertexDataPath"]] = newResName;
             }
 
+            if (actor->HasCollider() && actor->GetCollider()->GetType() == ColliderType::Mesh)
+            {
+                addSegment(std::string(newResName).append("_C"));
+            }
+
             if (resources.count("textureDataPath") &&
                 resourceCache->find(resources["textureDataPath"]) == resourceCache->end())
             {
-                std::string textureName(newResName);
-                textureName.append("_T");
-
-                romSegments.append("extern u8 _");
-                romSegments.append(textureName);
-                romSegments.append("SegmentRomStart[];\n");
-                romSegments.append("extern u8 _");
-                romSegments.append(textureName);
-                romSegments.append("SegmentRomEnd[];\n");
-
+                addSegment(std::string(newResName).append("_T"));
                 (*resourceCache)[resources["textureDataPath"]] = newResName;
             }
         }
 
-        std::string segmentsPath = GetPathFor("Engine\\segments.h");
+        std::string tableName = std::string("_UER_Actors").append(std::to_string(level));
+        romSegments.append("extern u8 ").append(tableName).append("SegmentRomStart[];\n");
+        romSegments.append("extern u8 ").append(tableName).append("SegmentRomEnd[];\n");
+
+        // The closing entry keeps the table valid for levels without models.
+        romSegments.append("\nstatic void *const _UER_Segments[][2] = {").append(segmentTable).append("\n\t{ NULL, NULL }\n};\n");
+
+        std::string segmentsPath = GetLevelPathFor(level, "segments.h");
         std::unique_ptr<FILE, decltype(fclose) *> file(fopen(segmentsPath.c_str(), "w"), fclose);
         if (file == NULL) return false;
         fwrite(romSegments.c_str(), 1, romSegments.size(), file.get());
         return true;
     }
 
-    bool Build::WriteSceneFile(Scene *scene)
+    bool Build::WriteSceneFile(int level, Scene *scene)
     {
-        char buffer[128];
+        char buffer[256];
         COLORREF bgColor = scene->GetBackgroundColor();
-        sprintf(buffer, "int _UER_SceneBackgroundColor[3] = { %i, %i, %i };\n", GetRValue(bgColor),
-            GetGValue(bgColor), GetBValue(bgColor));
+        int length = sprintf(buffer, "#define _UER_LEVEL_ENTRY _UER_Level%i\n\n", level);
+        length += sprintf(buffer + length, "static int _UER_SceneBackgroundColor[3] = { %i, %i, %i };\n",
+            GetRValue(bgColor), GetGValue(bgColor), GetBValue(bgColor));
+        sprintf(buffer + length, "static const int _UER_SceneTickRate = %i;\n", scene->GetTickRate());
 
-        std::string scenePath = GetPathFor("Engine\\scene.h");
+        std::string scenePath = GetLevelPathFor(level, "scene.h");
         std::unique_ptr<FILE, decltype(fclose) *> file(fopen(scenePath.c_str(), "w"), fclose);
         if (file == NULL) return false;
         fwrite(buffer, 1, strlen(buffer), file.get());
         return true;
     }
 
-    bool Build::WriteActorsFile(const std::vector<Actor *> &actors, const std::map<std::string, std::string> &resourceCache)
+    bool Build::WriteActorsFile(int level, const std::vector<Actor *> &actors, int firstResource,
+        const std::map<std::string, std::string> &resourceCache, const std::map<std::string, int> &segmentIndices)
     {
-        int actorCount = -1;
-        std::string totalActors = std::to_string(actors.size());
-        std::string actorInits, modelDraws;
+        int actorCount = firstResource - 1, tableSize = 0;
+
+        // Track RDRAM used by mesh and texture data now that actors sharing a segment share one copy.
+        std::set<std::string> loadedAssets;
+        size_t unsharedBytes = 0, sharedBytes = 0;
+
+        // The engine reads the whole table with one DMA so it's laid out exactly like its actor_record struct.
+        std::vector<unsigned char> table;
+        Util::WriteShort(table, static_cast<unsigned short>(actors.size()));
+        Util::WriteShort(table, ActorRecordSize);
 
-        std::string actorsArrayDef("const int _UER_ActorCount = ");
-        actorsArrayDef.append(totalActors).append(";\nactor *_UER_Actors[")
-            .append(totalActors).append("];\n").append("actor *_UER_ActiveCamera = NULL;\n");
+        auto segmentIndex = [&segmentIndices](const std::string &name) {
+            auto segment = segmentIndices.find(name);
+            return segment == segmentIndices.end() ? NoSegment : static_cast<short>(segment->second);
+        };
 
         for (const auto &actor : actors)
         {
             std::string resourceName = Util::NewResourceName(++actorCount);
-            actorInits.append("\n\t_UER_Actors[").append(std::to_string(actorCount)).append("] = ");
 
             D3DXVECTOR3 colliderCenter = actor->HasCollider() ? actor->GetCollider()->GetCenter() : D3DXVECTOR3(0, 0, 0);
             FLOAT colliderRadius = actor->HasCollider() && actor->GetCollider()->GetType() == ColliderType::Sphere ?
                 dynamic_cast<SphereCollider *>(actor->GetCollider())->GetRadius() : 0.0f;
             D3DXVECTOR3 colliderExtents = actor->HasCollider() && actor->GetCollider()->GetType() == ColliderType::Box ?
                 dynamic_cast<BoxCollider *>(actor->GetCollider())->GetExtents() : D3DXVECTOR3(0, 0, 0);
+            int isTrigger = actor->HasCollider() && actor->GetCollider()->IsTrigger() ? 1 : 0;
+
+            // Matches the engine's colliderType enum.
+            unsigned char colliderType = 0;
+            if (actor->HasCollider())
+            {
+                switch (actor->GetCollider()->GetType())
+                {
+                    case ColliderType::Sphere: colliderType = 1; break;
+                    case ColliderType::Box: colliderType = 2; break;
+                    case ColliderType::Mesh: colliderType = 3; break;
+                }
+            }
+
+            short meshSegment = NoSegment, textureSegment = NoSegment, treeSegment = NoSegment;
+            unsigned short textureWidth = 0, textureHeight = 0;
 
             if (actor->GetType() == ActorType::Model)
             {
@@ -237,46 +377,21 @@ namespace UltraEd
                 if (resourceCache.find(resources.at("vertexDataPath")) != resourceCache.end())
                     resourceName = resourceCache.at(resources.at("vertexDataPath"));
 
-                std::string modelName(resourceName);
-                modelName.append("_M");
-
-                if (resources.count("textureDataPath"))
-                    actorInits.append("(actor*)loadTexturedModel(_");
-                else
-                    actorInits.append("(actor*)loadModel(_");
-
-                actorInits.append(modelName).append("SegmentRomStart, _").append(modelName).append("SegmentRomEnd");
+                meshSegment = segmentIndex(std::string(resourceName).append("_M"));
 
                 if (resources.count("textureDataPath"))
                 {
                     if (resourceCache.find(resources.at("textureDataPath")) != resourceCache.end())
                         resourceName = resourceCache.at(resources.at("textureDataPath"));
 
-                    std::string textureName(resourceName);
-                    textureName.append("_T");
-
                     auto dimensions = static_cast<Model *>(actor)->TextureDimensions();
-                    actorInits.append(", _").append(textureName).append("SegmentRomStart, _")
-                        .append(textureName).append("SegmentRomEnd, ").append(std::to_string(dimensions[0])).append(", ")
-                        .append(std::to_string(dimensions[1]));
+                    textureSegment = segmentIndex(std::string(resourceName).append("_T"));
+                    textureWidth = static_cast<unsigned short>(dimensions[0]);
+                    textureHeight = static_cast<unsigned short>(dimensions[1]);
                 }
 
-                // Add transform data.
-                char vectorBuffer[256];
-                D3DXVECTOR3 position = actor->GetPosition(), scale = actor->GetScale(), axis;
-                float angle;
-                actor->GetAxisAngle(&axis, &angle);
-                sprintf(vectorBuffer, ", %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %s",
-                    position.x, position.y, position.z,
-                    axis.x, axis.y, axis.z, angle * (180.0 / D3DX_PI),
-                    scale.x, scale.y, scale.z,
-                    colliderCenter.x, colliderCenter.y, colliderCenter.z, colliderRadius,
-                    colliderExtents.x, colliderExtents.y, colliderExtents.z,
-                    actor->HasCollider() ? actor->GetCollider()->GetName() : "None");
-                actorInits.append(vectorBuffer).append(");\n");
-
-                // Write out mesh data.
-                std::vector<Vertex> vertices = actor->GetVertices();
+                // Write out mesh data with every corner expanded since the engine draws unindexed triangles.
+                std::vector<Vertex> vertices = actor->GetTriangles();
                 std::string id = Util::GuidToString(actor->GetId());
                 id.insert(0, Util::RootPath().append("\\")).append(".rom.sos");
                 FILE *file = fopen(id.c_str(), "w");
@@ -291,137 +406,317 @@ namespace UltraEd
                 }
                 fclose(file);
 
-                modelDraws.append("\n\tmodelDraw(_UER_Actors[").append(std::to_string(actorCount)).append("], display_list);\n");
-            }
-            else if (actor->GetType() == ActorType::Camera)
-            {
-                actorInits.append("(actor*)createCamera(");
-                char vectorBuffer[256];
-                D3DXVECTOR3 position = actor->GetPosition();
-                D3DXVECTOR3 axis;
-                float angle;
-                actor->GetAxisAngle(&axis, &angle);
-                sprintf(vectorBuffer, "%lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %s",
-                    position.x, position.y, position.z,
-                    axis.x, axis.y, axis.z, angle * (180.0 / D3DX_PI),
-                    colliderCenter.x, colliderCenter.y, colliderCenter.z, colliderRadius,
-                    colliderExtents.x, colliderExtents.y, colliderExtents.z,
-                    actor->HasCollider() ? actor->GetCollider()->GetName() : "None");
-                actorInits.append(vectorBuffer).append(");\n");
-            }
-        }
+                // Vertices are 16 bytes each and textures are decoded to 16 bits per pixel.
+                std::string dimensionKey;
+                size_t textureBytes = 0;
+                if (resources.count("textureDataPath"))
+                {
+                    dimensionKey = std::to_string(textureWidth).append("x").append(std::to_string(textureHeight));
+                    textureBytes = textureWidth * textureHeight * 2;
 
-        std::string actorInitsPath = GetPathFor("Engine\\actors.h");
-        std::unique_ptr<FILE, decltype(fclose) *> file(fopen(actorInitsPath.c_str(), "w"), fclose);
-        if (file == NULL) return false;
+                    unsharedBytes += textureBytes;
+                    if (loadedAssets.insert(resources.at("textureDataPath") + dimensionKey).second)
+                        sharedBytes += textureBytes;
+                }
 
-        fwrite(actorsArrayDef.c_str(), 1, actorsArrayDef.size(), file.get());
+                unsharedBytes += vertices.size() * 16;
+                if (loadedAssets.insert(resources.at("vertexDataPath") + dimensionKey).second)
+                    sharedBytes += vertices.size() * 16;
 
-        const char *actorInitStart = "\nvoid _UER_Load() {";
-        fwrite(actorInitStart, 1, strlen(actorInitStart), file.get());
-        fwrite(actorInits.c_str(), 1, actorInits.size(), file.get());
-        fwrite("}", 1, 1, file.get());
+                // Write out the collision tree for mesh colliders.
+                if (actor->HasCollider() && actor->GetCollider()->GetType() == ColliderType::Mesh)
+                {
+                    auto collider = static_cast<MeshCollider *>(actor->GetCollider());
+                    std::vector<unsigned char> tree;
 
-        const char *drawStart = "\n\nvoid _UER_Draw(Gfx **display_list) {";
-        fwrite(drawStart, 1, strlen(drawStart), file.get());
-        fwrite(modelDraws.c_str(), 1, modelDraws.size(), file.get());
-        fwrite("}", 1, 1, file.get());
+                    // Trees are baked in world space so pooled instances would all collide where the prefab sits.
+                    if (PooledInstances(actor) > 0)
+                    {
+                        Debug::Error("Mesh collider on " + actor->GetName()
+                            + " can't be pooled. Use a sphere or box collider or set the pool size to 0.");
+                        return false;
+                    }
+
+                    if (!collider->BuildTree(actor->GetMatrix(), tree))
+                    {
+                        if (collider->GetTriangleCount() == 0)
+                            Debug::Warning("Mesh collider on " + actor->GetName() + " has no triangles and was left empty.");
+                        else
+                            Debug::Warning("Mesh collider on " + actor->GetName() + " has too many triangles and was left empty.");
+                    }
+
+                    std::string treePath = Util::GuidToString(actor->GetId());
+                    treePath.insert(0, Util::RootPath().append("\\")).append(".bvh.rom.sos");
+                    file = fopen(treePath.c_str(), "wb");
+                    if (file == NULL) return false;
+                    fwrite(tree.data(), 1, tree.size(), file);
+                    fclose(file);
+
+                    treeSegment = segmentIndex(Util::NewResourceName(actorCount).append("_C"));
+                }
+            }
+
+            table.push_back(actor->GetType() == ActorType::Camera ? 1 : 0);
+            table.push_back(colliderType);
+            table.push_back(static_cast<unsigned char>(isTrigger));
+            table.push_back(0);
+            Util::WriteShort(table, meshSegment);
+            Util::WriteShort(table, textureSegment);
+            Util::WriteShort(table, treeSegment);
+            Util::WriteShort(table, textureWidth);
+            Util::WriteShort(table, textureHeight);
+            Util::WriteShort(table, static_cast<unsigned short>(PooledInstances(actor)));
+            tableSize += 1 + PooledInstances(actor);
+
+            D3DXVECTOR3 position = actor->GetPosition(), scale = actor->GetScale(), axis;
+            float angle;
+            actor->GetAxisAngle(&axis, &angle);
+            float values[] = {
+                position.x, position.y, position.z,
+                axis.x, axis.y, axis.z, static_cast<float>(angle * (180.0 / D3DX_PI)),
+                scale.x, scale.y, scale.z,
+                colliderCenter.x, colliderCenter.y, colliderCenter.z, colliderRadius,
+                colliderExtents.x, colliderExtents.y, colliderExtents.z
+            };
+            for (float value : values) Util::WriteFloat(table, value);
+        }
+
+        if (unsharedBytes > 0)
+        {
+            Debug::Info("Model data uses " + std::to_string(sharedBytes / 1024) + " KB of RDRAM, "
+                + std::to_string(unsharedBytes / 1024) + " KB before sharing.");
+        }
+
+        std::string tableName = std::string("UER_Actors").append(std::to_string(level));
+        std::string tablePath = Util::RootPath().append("\\").append(tableName).append(".rom.sos");
+        std::unique_ptr<FILE, decltype(fclose) *> tableFile(fopen(tablePath.c_str(), "wb"), fclose);
+        if (tableFile == NULL) return false;
+        fwrite(table.data(), 1, table.size(), tableFile.get());
+
+        // Pooled instances are created by the engine from their prefab's record but still need slots.
+        std::string totalActors = std::to_string(tableSize);
+        std::string actorsFile("static const int _UER_ActorCount = ");
+        actorsFile.append(totalActors).append(";\nstatic actor *_UER_Actors[")
+            .append(totalActors).append("];\n").append("static actor *_UER_ActiveCamera = NULL;\n");
+
+        actorsFile.append("\nstatic void _UER_Load() {\n\tlevel_load_actors(_").append(tableName).append("SegmentRomStart, _")
+            .append(tableName).append("SegmentRomEnd, _UER_Segments, _UER_Actors, _UER_ActorCount);\n}");
+        actorsFile.append("\n\nstatic void _UER_Draw(Gfx **display_list) {\n\t"
+            "level_draw(display_list);\n}");
+
+        std::string actorsPath = GetLevelPathFor(level, "actors.h");
+        std::unique_ptr<FILE, decltype(fclose) *> file(fopen(actorsPath.c_str(), "w"), fclose);
+        if (file == NULL) return false;
+        fwrite(actorsFile.c_str(), 1, actorsFile.size(), file.get());
         return true;
     }
 
-    bool Build::WriteCollisionFile(const std::vector<Actor *> &actors)
+    bool Build::WriteCollisionFile(int level, const std::vector<Actor *> &actors, int firstResource)
     {
-        std::string collideSetStart("void _UER_Collide() {");
-        std::string collisions;
-        int collisionCount = 0;
+        std::string hooks("static const unsigned char _UER_CollisionHooks[] = {");
+        std::string layers("\nstatic const unsigned short _UER_CollisionLayers[] = {");
+        std::string masks("\nstatic const unsigned short _UER_CollisionMasks[] = {");
+        std::vector<int> actorFlags;
+        std::string dispatchStart("\n\nstatic void _UER_OnCollide(int index, actor *other, enum collisionEvent event) {"
+            "\n\tswitch (index) {");
+        std::string collideSet("\n\nstatic void _UER_Collide() {\n\tcollision_update(_UER_CollisionHooks, _UER_OnCollide);\n");
+        std::string dispatches;
+        int actorCount = firstResource - 1, tableIndex = 0;
         char countBuffer[10];
 
         for (const auto &actor : actors)
         {
-            int subLoop = collisionCount++;
+            std::string resourceName = Util::NewResourceName(++actorCount);
+            std::string script = actor->GetScript();
+            int instances = PooledInstances(actor);
+            bool hasCollide = script.find("$collide(") != std::string::npos;
+            bool hasEnter = script.find("$enter(") != std::string::npos;
+            bool hasStay = script.find("$stay(") != std::string::npos;
+            bool hasExit = script.find("$exit(") != std::string::npos;
+
+            // Bits match the engine's collisionEvent enum. Collide runs every frame actors overlap so
+            // it listens for both enter and stay. The engine skips events an actor doesn't listen for.
+            int flags = 0;
+            if (actor->GetCollider())
+            {
+                if (hasCollide || hasEnter) flags |= 1;
+                if (hasCollide || hasStay) flags |= 2;
+                if (hasExit) flags |= 4;
+            }
 
-            if (!actor->GetCollider()) continue;
+            actorFlags.push_back(flags);
 
-            for (auto subActor = next(actors.begin(), collisionCount); subActor != actors.end(); ++subActor)
+            // The engine tests the layer as a single bit against the other actor's mask. Actors
+            // without a collider get zeroes so they never pair with anything. Pooled instances
+            // take their prefab's settings.
+            Collider *collider = actor->GetCollider();
+            for (int i = 0; i <= instances; i++)
             {
-                subLoop++;
+                const char *separator = tableIndex + i > 0 ? ", " : " ";
+                _itoa(flags, countBuffer, 10);
+                hooks.append(separator).append(countBuffer);
+                _itoa(collider ? 1 << collider->GetLayer() : 0, countBuffer, 10);
+                layers.append(separator).append(countBuffer);
+                _itoa(collider ? collider->GetMask() : 0, countBuffer, 10);
+                masks.append(separator).append(countBuffer);
+            }
 
-                if (!(*subActor)->GetCollider()) continue;
+            int firstIndex = tableIndex;
+            tableIndex += 1 + instances;
 
-                std::string actorScript = actor->GetScript();
-                std::string subActorScript = (*subActor)->GetScript();
+            if (flags == 0) continue;
 
-                // Both actors must define a collide method.
-                if (actorScript.find("collide(") == std::string::npos || subActorScript.find("collide(") == std::string::npos)
-                    continue;
+            if (instances > 0)
+            {
+                // Only the instances of a prefab ever collide and its script runs as whichever one it is.
+                dispatches.append("\n\t\tcase ").append(std::to_string(firstIndex + 1)).append(" ... ")
+                    .append(std::to_string(firstIndex + instances)).append(":");
+                dispatches.append("\n\t\t\t").append(resourceName).append("self = _UER_Actors[index];");
+            }
+            else
+            {
+                _itoa(firstIndex, countBuffer, 10);
+                dispatches.append("\n\t\tcase ").append(countBuffer).append(":");
+            }
 
-                _itoa(collisionCount - 1, countBuffer, 10);
-                collisions.append("\n\tif(check_collision(_UER_Actors[").append(countBuffer);
-                _itoa(subLoop, countBuffer, 10);
-                collisions.append("], _UER_Actors[").append(countBuffer).append("]))\n\t{\n");
+            // Every callback counts toward the actor's collide cost.
+            std::string profile = std::string("SCRIPT_PROFILE(index, ScriptCollide, ").append(resourceName);
 
-                collisions.append("\t\t").append(Util::NewResourceName(subLoop)).append("collide(");
-                _itoa(collisionCount - 1, countBuffer, 10);
-                collisions.append("_UER_Actors[").append(countBuffer).append("]);\n");
+            if (hasCollide)
+                dispatches.append("\n\t\t\tif (event != Exit) ").append(profile).append("collide(other));");
 
-                collisions.append("\t\t").append(Util::NewResourceName(collisionCount - 1)).append("collide(");
-                _itoa(subLoop, countBuffer, 10);
-                collisions.append("_UER_Actors[").append(countBuffer).append("]);\n");
+            if (hasEnter)
+                dispatches.append("\n\t\t\tif (event == Enter) ").append(profile).append("enter(other));");
 
-                collisions.append("\t}\n");
+            if (hasStay)
+                dispatches.append("\n\t\t\tif (event == Stay) ").append(profile).append("stay(other));");
+
+            if (hasExit)
+                dispatches.append("\n\t\t\tif (event == Exit) ").append(profile).append("exit(other));");
+
+            dispatches.append("\n\t\t\tbreak;");
+        }
+
+        // Arrays can't be empty so pad when the scene has no actors.
+        hooks.append(actors.empty() ? " 0 };" : " };");
+        layers.append(actors.empty() ? " 0 };" : " };");
+        masks.append(actors.empty() ? " 0 };" : " };");
+
+        // Count the pairs the engine would have tested and how many of those the layers rule out.
+        int totalPairs = 0, eliminatedPairs = 0;
+        for (size_t i = 0; i < actors.size(); i++)
+        {
+            if (!actors[i]->HasCollider()) continue;
+
+            for (size_t j = i + 1; j < actors.size(); j++)
+            {
+                if (!actors[j]->HasCollider() || (actorFlags[i] == 0 && actorFlags[j] == 0)) continue;
+
+                totalPairs++;
+                if (!actors[i]->GetCollider()->Interacts(actors[j]->GetCollider())) eliminatedPairs++;
             }
         }
 
-        std::string collisionPath = GetPathFor("Engine\\collisions.h");
+        if (eliminatedPairs > 0)
+        {
+            Debug::Info("Collision layers eliminated " + std::to_string(eliminatedPairs) + " of "
+                + std::to_string(totalPairs) + " collider pairs.");
+        }
+
+        std::string collisionPath = GetLevelPathFor(level, "collisions.h");
         std::unique_ptr<FILE, decltype(fclose) *> file(fopen(collisionPath.c_str(), "w"), fclose);
         if (file == NULL) return false;
-        fwrite(collideSetStart.c_str(), 1, collideSetStart.size(), file.get());
-        fwrite(collisions.c_str(), 1, collisions.size(), file.get());
+        fwrite(hooks.c_str(), 1, hooks.size(), file.get());
+        fwrite(layers.c_str(), 1, layers.size(), file.get());
+        fwrite(masks.c_str(), 1, masks.size(), file.get());
+        fwrite(dispatchStart.c_str(), 1, dispatchStart.size(), file.get());
+        fwrite(dispatches.c_str(), 1, dispatches.size(), file.get());
+        fwrite("\n\t}\n}", 1, 5, file.get());
+        fwrite(collideSet.c_str(), 1, collideSet.size(), file.get());
         fwrite("}", 1, 1, file.get());
         return true;
     }
 
-    bool Build::WriteScriptsFile(const std::vector<Actor *> &actors)
+    bool Build::WriteScriptsFile(int level, const std::vector<Actor *> &actors, int firstResource)
     {
-        std::string scriptStartStart("void _UER_Start() {");
-        std::string scriptUpdateStart("\n\nvoid _UER_Update() {");
-        std::string inputStart("\n\nvoid _UER_Input(NUContData gamepads[4]) {");
+        std::string scriptStartStart("static void _UER_Start() {");
+        std::string scriptUpdateStart("\n\nstatic void _UER_Update(float delta) {");
+        std::string inputStart("\n\nstatic void _UER_Input(NUContData gamepads[4]) {");
+        std::string spawnStart("\n\nstatic void _UER_Spawn(int prefab, actor *spawned) {\n\tswitch (prefab) {");
 
         std::string scripts;
         char countBuffer[10];
-        int actorCount = -1;
+        int actorCount = firstResource - 1, tableIndex = 0;
 
         for (const auto &actor : actors)
         {
             std::string actorRef;
-            actorRef.append("_UER_Actors[");
-
             std::string newResName = Util::NewResourceName(++actorCount);
             std::string script = actor->GetScript();
             auto result = std::unique_ptr<char>(Util::ReplaceString(script.c_str(), "$", newResName.c_str()));
+            int instances = PooledInstances(actor);
+            int firstIndex = tableIndex;
+            tableIndex += 1 + instances;
+
+            // A prefab's script is shared by its instances so self is set to each one before it runs.
+            // Calls are charged to the slot they ran as when scripts are being profiled.
+            std::string runAs, slot;
+            if (instances > 0)
+            {
+                actorRef.append(newResName).append("self");
+                scripts.append("actor *").append(newResName).append("self = NULL;\n\n");
+                runAs.append("\n\tfor (int i = ").append(std::to_string(firstIndex + 1)).append("; i <= ")
+                    .append(std::to_string(firstIndex + instances)).append("; i++) if (_UER_Actors[i]->active) { ")
+                    .append(newResName).append("self = _UER_Actors[i]; ");
+                slot = "i";
+            }
+            else
+            {
+                _itoa(firstIndex, countBuffer, 10);
+                actorRef.append("_UER_Actors[").append(countBuffer).append("]");
+                runAs.append("\n\t");
+                slot = countBuffer;
+            }
 
-            _itoa(actorCount, countBuffer, 10);
-            actorRef.append(countBuffer).append("]->");
-            result = std::unique_ptr<char>(Util::ReplaceString(result.get(), "self->", actorRef.c_str()));
-            scripts.append(result.get()).append("\n\n");
+            const char *runEnd = instances > 0 ? "; }\n" : ";\n";
+            // Self is rewritten wherever it's used as a name so it can also be passed to calls like Despawn.
+            scripts.append(Util::ReplaceToken(result.get(), "self", actorRef)).append("\n\n");
 
             if (scripts.find(std::string(newResName).append("start(")) != std::string::npos)
             {
-                scriptStartStart.append("\n\t").append(newResName).append("start();\n");
+                // Instances start when they're spawned instead of with the level.
+                if (instances > 0)
+                {
+                    _itoa(firstIndex, countBuffer, 10);
+                    spawnStart.append("\n\t\tcase ").append(countBuffer).append(":\n\t\t\t").append(newResName)
+                        .append("self = spawned;\n\t\t\tSCRIPT_PROFILE(spawned->index, ScriptStart, ").append(newResName)
+                        .append("start());\n\t\t\tbreak;");
+                }
+                else
+                {
+                    scriptStartStart.append("\n\tSCRIPT_PROFILE(").append(slot).append(", ScriptStart, ")
+                        .append(newResName).append("start());\n");
+                }
             }
 
-            if (scripts.find(std::string(newResName).append("update(")) != std::string::npos)
+            size_t update = scripts.find(std::string(newResName).append("update("));
+            if (update != std::string::npos)
             {
-                scriptUpdateStart.append("\n\t").append(newResName).append("update();\n");
+                // Scripts written before the fixed tick declare update without the delta time.
+                size_t next = scripts.find_first_not_of(" \t\r\n", update + newResName.size() + 7);
+                bool takesDelta = next != std::string::npos && scripts[next] != ')';
+                scriptUpdateStart.append(runAs).append("SCRIPT_PROFILE(").append(slot).append(", ScriptUpdate, ")
+                    .append(newResName).append(takesDelta ? "update(delta))" : "update())").append(runEnd);
             }
 
             if (scripts.find(std::string(newResName).append("input(")) != std::string::npos)
             {
-                inputStart.append("\n\t").append(newResName).append("input(gamepads);\n");
+                inputStart.append(runAs).append("SCRIPT_PROFILE(").append(slot).append(", ScriptInput, ")
+                    .append(newResName).append("input(gamepads))").append(runEnd);
             }
         }
 
-        std::string scriptsPath = GetPathFor("Engine\\scripts.h");
+        std::string scriptsPath = GetLevelPathFor(level, "scripts.h");
         std::unique_ptr<FILE, decltype(fclose) *> file(fopen(scriptsPath.c_str(), "w"), fclose);
         if (file == NULL) return false;
         fwrite(scripts.c_str(), 1, scripts.size(), file.get());
@@ -431,23 +726,27 @@ namespace UltraEd
         fwrite("}", 1, 1, file.get());
         fwrite(inputStart.c_str(), 1, inputStart.size(), file.get());
         fwrite("}", 1, 1, file.get());
+        fwrite(spawnStart.c_str(), 1, spawnStart.size(), file.get());
+        fwrite("\n\t}\n}", 1, 5, file.get());
         return true;
     }
 
-    bool Build::WriteMappingsFile(const std::vector<Actor *> &actors)
+    bool Build::WriteMappingsFile(int level, const std::vector<Actor *> &actors)
     {
-        std::string mappingsStart("void _UER_Mappings() {");
+        std::string mappingsStart("static void _UER_Mappings() {");
         int loopCount = 0;
         char countBuffer[10];
 
+        // Names map to the actor's slot which for a prefab is followed by its instances.
         for (const auto &actor : actors)
         {
-            _itoa(loopCount++, countBuffer, 10);
+            _itoa(loopCount, countBuffer, 10);
             mappingsStart.append("\n\tinsert(\"").append(actor->GetName()).append("\", ")
                 .append(countBuffer).append(");\n");
+            loopCount += 1 + PooledInstances(actor);
         }
 
-        std::string mappingsPath = GetPathFor("Engine\\mappings.h");
+        std::string mappingsPath = GetLevelPathFor(level, "mappings.h");
         std::unique_ptr<FILE, decltype(fclose) *> file(fopen(mappingsPath.c_str(), "w"), fclose);
         if (file == NULL) return false;
         fwrite(mappingsStart.c_str(), 1, mappingsStart.size(), file.get());
@@ -455,22 +754,103 @@ namespace UltraEd
         return true;
     }
 
+    std::vector<std::vector<Actor *>> Build::SplitLevels(const std::vector<Actor *> &actors)
+    {
+        // Levels between used ones are kept, empty, so the numbers scripts pass to LoadLevel hold.
+        std::vector<std::vector<Actor *>> levels(1);
+        for (const auto &actor : actors)
+        {
+            if (actor->GetLevel() >= static_cast<int>(levels.size())) levels.resize(actor->GetLevel() + 1);
+            levels[actor->GetLevel()].push_back(actor);
+        }
+        return levels;
+    }
+
+    int Build::PooledInstances(Actor *actor)
+    {
+        // Only models can be prefabs.
+        return actor->GetType() == ActorType::Model ? actor->GetPoolSize() : 0;
+    }
+
+    std::vector<std::vector<GUID>> Build::ScriptSlots(const std::vector<Actor *> &actors)
+    {
+        // Slots are laid out the same way as each level's actor table.
+        std::vector<std::vector<GUID>> slots;
+        for (const auto &level : SplitLevels(actors))
+        {
+            slots.emplace_back();
+            for (const auto &actor : level)
+            {
+                slots.back().insert(slots.back().end(), 1 + PooledInstances(actor), actor->GetId());
+            }
+        }
+        return slots;
+    }
+
+    bool Build::ReadScriptCosts(const std::vector<std::vector<GUID>> &levelSlots, std::map<GUID, ScriptCost> *costs)
+    {
+        std::string path = GetPathFor("Player\\").append(ScriptCostFile);
+        std::unique_ptr<FILE, decltype(fclose) *> file(fopen(path.c_str(), "rb"), fclose);
+        if (file == NULL) return false;
+
+        std::vector<unsigned char> data((ScriptCostMaxSlots + 1) * ScriptCostBlockSize);
+        size_t size = fread(data.data(), 1, data.size(), file.get());
+        if (size < ScriptCostBlockSize || memcmp(data.data(), "UER", 3) != 0) return false;
+
+        // Costs are for whichever level the run ended in.
+        if (data[3] >= levelSlots.size()) return false;
+        const std::vector<GUID> &slots = levelSlots[data[3]];
+
+        int slotCount = std::min(static_cast<int>(Util::ReadShort(&data[4])), static_cast<int>(slots.size()));
+        slotCount = std::min(slotCount, static_cast<int>(size / ScriptCostBlockSize) - 1);
+
+        // Start is stored in whole microseconds and the per tick averages in tenths. Instances
+        // of a prefab are added together under it.
+        for (int i = 0; i < slotCount; i++)
+        {
+            const unsigned char *block = &data[(i + 1) * ScriptCostBlockSize];
+            ScriptCost &cost = (*costs)[slots[i]];
+            cost.start += Util::ReadShort(&block[0]);
+            cost.update += Util::ReadShort(&block[2]) / 10.0f;
+            cost.input += Util::ReadShort(&block[4]) / 10.0f;
+            cost.collide += Util::ReadShort(&block[6]) / 10.0f;
+        }
+
+        Debug::Info("Read script costs for " + std::to_string(Util::ReadShort(&data[6])) + " ticks of level "
+            + std::to_string(data[3]) + ".");
+        return true;
+    }
+
     bool Build::Start(Scene *scene)
     {
-        auto actors = scene->GetActors();
+        auto levels = SplitLevels(scene->GetActors());
 
-        // Share texture and model data to reduce ROM size. Resource use is tracked during
-        // segment generation and the actor script generator uses that info. 
-        std::map<std::string, std::string> resourceCache;
-        WriteSegmentsFile(actors, &resourceCache);
-        WriteActorsFile(actors, resourceCache);
+        // Headers from before scenes were split into levels would be found ahead of the per level ones.
+        for (const char *name : LevelHeaders)
+        {
+            DeleteFile(GetPathFor(std::string("Engine\\").append(name)).c_str());
+        }
 
-        WriteSpecFile(actors);
+        int firstResource = 0;
+        for (int level = 0; level < static_cast<int>(levels.size()); level++)
+        {
+            // Share texture and model data to reduce ROM size. Resource use is tracked during
+            // segment generation and the actor script generator uses that info. 
+            std::map<std::string, std::string> resourceCache;
+            std::map<std::string, int> segmentIndices;
+            WriteSegmentsFile(level, levels[level], firstResource, &resourceCache, &segmentIndices);
+            if (!WriteActorsFile(level, levels[level], firstResource, resourceCache, segmentIndices)) return false;
+
+            WriteCollisionFile(level, levels[level], firstResource);
+            WriteScriptsFile(level, levels[level], firstResource);
+            WriteMappingsFile(level, levels[level]);
+            WriteSceneFile(level, scene);
+            firstResource += static_cast<int>(levels[level].size());
+        }
+
+        WriteSpecFile(levels);
+        WriteLevelsFile(static_cast<int>(levels.size()));
         WriteDefinitionsFile();
-        WriteCollisionFile(actors);
-        WriteScriptsFile(actors);
-        WriteMappingsFile(actors);
-        WriteSceneFile(scene);
 
         return Compile(scene->GetWndHandle());
     }
@@ -491,10 +871,20 @@ namespace UltraEd
 
             // Format the path to execute the ROM build.
             std::string currDir = GetPathFor("Player");
+            std::string command("cmd /c cen64.exe");
+
+            // Profiled builds write their script costs to the EEPROM which the player saves to a file.
+            // Costs left over from an earlier run are removed so they can't be mistaken for these.
+            if (Settings::GetProfileScripts())
+            {
+                DeleteFile(std::string(currDir).append("\\").append(ScriptCostFile).c_str());
+                command.append(" -eep16k ").append(ScriptCostFile);
+            }
+
+            command.append(" pifdata.bin ..\\Engine\\main.n64");
 
             // Start the build with no window.
-            CreateProcess(NULL, const_cast<LPSTR>("cmd /c cen64.exe pifdata.bin ..\\Engine\\main.n64"), NULL, NULL, FALSE,
-                CREATE_NO_WINDOW, NULL, currDir.c_str(), &si, &pi);
+            CreateProcess(NULL, &command[0], NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, currDir.c_str(), &si, &pi);
 
             WaitForSingleObject(pi.hProcess, INFINITE);
             GetExitCodeProcess(pi.hProcess, &exitCode);
@@ -647,6 +1037,15 @@ namespace UltraEd
         return false;
     }
 
+    std::string Build::GetLevelPathFor(int level, const std::string &name)
+    {
+        std::string path = GetPathFor("Engine\\levels");
+        CreateDirectory(path.c_str(), NULL);
+        path.append("\\").append(std::to_string(level));
+        CreateDirectory(path.c_str(), NULL);
+        return path.append("\\").append(name);
+    }
+
     std::string Build::GetPathFor(const std::string &name)
     {
         char buffer[MAX_PATH];
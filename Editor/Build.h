@@ -14,18 +14,26 @@ namespace UltraEd
     public:
         static bool Start(Scene *scene);
         static bool Run();
+        static std::vector<std::vector<GUID>> ScriptSlots(const std::vector<Actor*> &actors);
+        static bool ReadScriptCosts(const std::vector<std::vector<GUID>> &levelSlots, std::map<GUID, ScriptCost> *costs);
         static bool Load(const HWND &hWnd);
 
     private:
-        static bool WriteSpecFile(const std::vector<Actor*> &actors);
+        static bool WriteSpecFile(const std::vector<std::vector<Actor*>> &levels);
         static bool WriteDefinitionsFile();
-        static bool WriteSegmentsFile(const std::vector<Actor*> &actors, std::map<std::string, std::string> *resourceCache);
-        static bool WriteSceneFile(Scene *scene);
-        static bool WriteActorsFile(const std::vector<Actor*> &actors, const std::map<std::string, std::string> &resourceCache);
-        static bool WriteCollisionFile(const std::vector<Actor*> &actors);
-        static bool WriteScriptsFile(const std::vector<Actor*> &actors);
-        static bool WriteMappingsFile(const std::vector<Actor*> &actors);
+        static bool WriteLevelsFile(int levelCount);
+        static bool WriteSegmentsFile(int level, const std::vector<Actor*> &actors, int firstResource,
+            std::map<std::string, std::string> *resourceCache, std::map<std::string, int> *segmentIndices);
+        static bool WriteSceneFile(int level, Scene *scene);
+        static bool WriteActorsFile(int level, const std::vector<Actor*> &actors, int firstResource,
+            const std::map<std::string, std::string> &resourceCache, const std::map<std::string, int> &segmentIndices);
+        static bool WriteCollisionFile(int level, const std::vector<Actor*> &actors, int firstResource);
+        static bool WriteScriptsFile(int level, const std::vector<Actor*> &actors, int firstResource);
+        static bool WriteMappingsFile(int level, const std::vector<Actor*> &actors);
         static bool Compile(const HWND &hWnd);
+        static std::vector<std::vector<Actor*>> SplitLevels(const std::vector<Actor*> &actors);
+        static int PooledInstances(Actor *actor);
+        static std::string GetLevelPathFor(int level, const std::string &name);
         static std::string GetPathFor(const std::string &name);
     };
 }
@@ -14,21 +14,27 @@ namespace UltraEd
     {
         *this = camera;
         ResetId();
+
+        // Colliders are editable so each copy needs its own.
+        if (HasCollider()) SetCollider(GetCollider()->Clone());
     }
 
     void Camera::Render(IDirect3DDevice9 *device, ID3DXMatrixStack *stack)
     {
-        auto *buffer = m_vertexBuffer->GetBuffer(device, GetVertices());
+        auto *buffer = GetVertexBuffer(device);
+        auto *indices = GetIndexBuffer(device);
 
-        if (buffer != NULL)
+        if (buffer != NULL && indices != NULL)
         {
             stack->Push();
             stack->MultMatrixLocal(&GetMatrix());
 
             device->SetTransform(D3DTS_WORLD, stack->GetTop());
             device->SetStreamSource(0, buffer, 0, sizeof(Vertex));
+            device->SetIndices(indices);
             device->SetFVF(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_DIFFUSE);
-            device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, static_cast<UINT>(GetVertices().size() / 3));
+            device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, static_cast<UINT>(GetVertices().size()), 0,
+                static_cast<UINT>(GetTriangleCount()));
 
             stack->Pop();
         }
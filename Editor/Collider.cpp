@@ -6,7 +6,11 @@ namespace UltraEd
     Collider::Collider() : 
         m_type(ColliderType::Box),
         m_vertices(),
+        m_vertexVersion(0),
         m_center(0, 0, 0), 
+        m_isTrigger(false),
+        m_layer(0),
+        m_mask(ColliderMaskAll),
         m_material(),
         m_vertexBuffer(std::make_shared<VertexBuffer>())
     {
@@ -17,7 +21,7 @@ namespace UltraEd
 
     void Collider::Render(IDirect3DDevice9 *device)
     {
-        auto *buffer = m_vertexBuffer->GetBuffer(device, m_vertices);
+        auto *buffer = m_vertexBuffer->GetBuffer(device, m_vertices, m_vertexVersion);
 
         if (buffer != NULL)
         {
@@ -44,6 +48,12 @@ namespace UltraEd
         return (ColliderType)typeValue;
     }
 
+    bool Collider::Interacts(Collider *other)
+    {
+        // Both sides must accept the other's layer, same as the engine's broad phase.
+        return (m_mask & (1 << other->m_layer)) != 0 && (other->m_mask & (1 << m_layer)) != 0;
+    }
+
     void Collider::DistantAABBPoints(D3DXVECTOR3 &min, D3DXVECTOR3 &max, const std::vector<Vertex> &vertices)
     {
         int minX = 0, maxX = 0, minY = 0, maxY = 0, minZ = 0, maxZ = 0;
@@ -72,6 +82,16 @@ namespace UltraEd
         sprintf(buffer, "%f %f %f", m_center.x, m_center.y, m_center.z);
         cJSON_AddStringToObject(root, "center", buffer);
 
+        cJSON_AddStringToObject(root, "trigger", m_isTrigger ? "1" : "0");
+
+        sprintf(buffer, "%i", m_layer);
+        cJSON_AddStringToObject(root, "layer", buffer);
+
+        sprintf(buffer, "%u", m_mask);
+        cJSON_AddStringToObject(root, "mask", buffer);
+
+        SetDirty(false);
+
         return root;
     }
 
@@ -84,6 +104,25 @@ namespace UltraEd
         sscanf(center->valuestring, "%f %f %f", &x, &y, &z);
         m_center = D3DXVECTOR3(x, y, z);
 
+        int trigger = 0;
+        if (cJSON *isTrigger = cJSON_GetObjectItem(root, "trigger"))
+        {
+            sscanf(isTrigger->valuestring, "%i", &trigger);
+        }
+        m_isTrigger = trigger != 0;
+
+        m_layer = 0;
+        if (cJSON *layer = cJSON_GetObjectItem(root, "layer"))
+        {
+            sscanf(layer->valuestring, "%i", &m_layer);
+        }
+
+        m_mask = ColliderMaskAll;
+        if (cJSON *mask = cJSON_GetObjectItem(root, "mask"))
+        {
+            sscanf(mask->valuestring, "%u", &m_mask);
+        }
+
         return true;
     }
 }
@@ -11,10 +11,14 @@ namespace UltraEd
 {
     enum class ColliderType
     {
-        Box, Sphere
+        Box, Sphere, Mesh
     };
 
-    static const char* ColliderTypeNames[] { "Box", "Sphere" };
+    static const char* ColliderTypeNames[] { "Box", "Sphere", "Mesh" };
+
+    // Layers are stored as an index and masks as a bit per layer, matching the engine's 16 bit tables.
+    static const int ColliderLayerCount = 16;
+    static const unsigned int ColliderMaskAll = (1 << ColliderLayerCount) - 1;
 
     class Collider : public Savable
     {
@@ -24,7 +28,15 @@ namespace UltraEd
         void Release();
         void Render(IDirect3DDevice9 *device);
         virtual void Build() = 0;
+        virtual Collider *Clone() = 0;
         D3DXVECTOR3 GetCenter() { return m_center; }
+        bool IsTrigger() { return m_isTrigger; }
+        bool SetTrigger(bool isTrigger) { return Dirty([&] { m_isTrigger = isTrigger; }, &m_isTrigger); }
+        int GetLayer() { return m_layer; }
+        bool SetLayer(int layer) { return Dirty([&] { m_layer = layer; }, &m_layer); }
+        unsigned int GetMask() { return m_mask; }
+        bool SetMask(unsigned int mask) { return Dirty([&] { m_mask = mask; }, &m_mask); }
+        bool Interacts(Collider *other);
         cJSON *Save();
         bool Load(cJSON *root);
         ColliderType GetType() { return m_type; };
@@ -35,7 +47,11 @@ namespace UltraEd
         void DistantAABBPoints(D3DXVECTOR3 &min, D3DXVECTOR3 &max, const std::vector<Vertex> &vertices);
         ColliderType m_type;
         std::vector<Vertex> m_vertices;
+        unsigned int m_vertexVersion;
         D3DXVECTOR3 m_center;
+        bool m_isTrigger;
+        int m_layer;
+        unsigned int m_mask;
 
     private:
         D3DMATERIAL9 m_material;
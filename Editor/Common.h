@@ -14,4 +14,13 @@ inline bool operator<(const GUID &first, const GUID &second)
     return memcmp(&first, &second, sizeof(GUID)) < 0;
 }
 
+namespace UltraEd
+{
+    // Microseconds per tick an actor's script took in a profiled run. Start is the total for the run.
+    struct ScriptCost
+    {
+        float start, update, input, collide;
+    };
+}
+
 #endif
@@ -18,7 +18,11 @@ namespace UltraEd
         m_textEditorOpen(false),
         m_optionsModalOpen(false),
         m_sceneSettingsModalOpen(false),
-        m_selectedActor()
+        m_selectedActor(),
+        m_scriptCosts(),
+        m_pendingScriptCosts(),
+        m_hasPendingScriptCosts(false),
+        m_scriptCostsMutex()
     {
         IMGUI_CHECKVERSION();
         ImGui::CreateContext();
@@ -40,6 +44,13 @@ namespace UltraEd
             m_openContextMenu = true;
             m_selectedActor = static_cast<Actor *>(data);
         } });
+
+        // Costs arrive on the build thread so they're only picked up when the next frame is prepared.
+        PubSub::Subscribe({ "ScriptCosts", [&](void *data) {
+            std::lock_guard<std::mutex> lock(m_scriptCostsMutex);
+            m_pendingScriptCosts = *static_cast<std::map<GUID, ScriptCost> *>(data);
+            m_hasPendingScriptCosts = true;
+        } });
     }
 
     Gui::~Gui()
@@ -55,6 +66,15 @@ namespace UltraEd
         ImGui_ImplWin32_NewFrame();
         ImGui::NewFrame();
 
+        {
+            std::lock_guard<std::mutex> lock(m_scriptCostsMutex);
+            if (m_hasPendingScriptCosts)
+            {
+                m_scriptCosts.swap(m_pendingScriptCosts);
+                m_hasPendingScriptCosts = false;
+            }
+        }
+
         ImGuiViewport *viewport = ImGui::GetMainViewport();
         ImGui::SetNextWindowPos(viewport->Pos);
         ImGui::SetNextWindowSize(viewport->Size);
@@ -293,6 +313,11 @@ namespace UltraEd
                     m_scene->OnAddCollider(ColliderType::Sphere);
                 }
 
+                if (ImGui::MenuItem("Mesh"))
+                {
+                    m_scene->OnAddCollider(ColliderType::Mesh);
+                }
+
                 if (ImGui::MenuItem("Delete"))
                 {
                     m_scene->OnDeleteCollider();
@@ -406,16 +431,32 @@ namespace UltraEd
             ImGuiTreeNodeFlags baseFlags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick
                 | ImGuiTreeNodeFlags_SpanAvailWidth;
 
-            auto actors = m_scene->GetActors();
+            const auto &actors = m_scene->GetActors();
             for (int i = 0; i < actors.size(); i++)
             {
                 ImGuiTreeNodeFlags leafFlags = baseFlags | ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
-                if (m_scene->IsActorSelected(actors[i]->GetId()))
+                if (m_scene->m_actors.IsSelected(static_cast<size_t>(i)))
                     leafFlags |= ImGuiTreeNodeFlags_Selected;
 
-                ImGui::TreeNodeEx((void *)(intptr_t)i, leafFlags, actors[i]->GetName().c_str());
+                // Actors from the last profiled run show what their script costs each tick.
+                std::string label = actors[i]->GetName();
+                auto cost = m_scriptCosts.find(actors[i]->GetId());
+                if (cost != m_scriptCosts.end())
+                {
+                    char costText[32];
+                    sprintf(costText, "  %.1f us", cost->second.update + cost->second.input + cost->second.collide);
+                    label.append(costText);
+                }
+
+                ImGui::TreeNodeEx((void *)(intptr_t)i, leafFlags, label.c_str());
                 if (ImGui::IsItemClicked())
                     m_scene->SelectActorById(actors[i]->GetId(), !IO().KeyShift);
+
+                if (cost != m_scriptCosts.end() && ImGui::IsItemHovered())
+                {
+                    ImGui::SetTooltip("Start: %.1f us\nUpdate: %.1f us\nInput: %.1f us\nCollide: %.1f us",
+                        cost->second.start, cost->second.update, cost->second.input, cost->second.collide);
+                }
             }
         }
 
@@ -455,7 +496,7 @@ namespace UltraEd
             float position[3] = { 0 };
             float rotation[3] = { 0 };
             float scale[3] = { 0 };
-            auto actors = m_scene->GetActors(true);
+            auto actors = m_scene->GetSelectedActors();
             Actor *targetActor = NULL;
 
             if (actors.size() > 0)
@@ -481,6 +522,65 @@ namespace UltraEd
             D3DXVECTOR3 tempScale = D3DXVECTOR3(scale);
             ImGui::InputFloat3("Scale", scale, "%g");
 
+            bool isTrigger = targetActor != NULL && targetActor->HasCollider() && targetActor->GetCollider()->IsTrigger();
+            bool tempTrigger = isTrigger;
+            int layer = targetActor != NULL && targetActor->HasCollider() ? targetActor->GetCollider()->GetLayer() : 0;
+            int tempLayer = layer;
+            unsigned int mask = targetActor != NULL && targetActor->HasCollider() ? targetActor->GetCollider()->GetMask() : 0;
+            unsigned int tempMask = mask;
+
+            int poolSize = targetActor != NULL ? targetActor->GetPoolSize() : 0;
+            int tempPoolSize = poolSize;
+            int level = targetActor != NULL ? targetActor->GetLevel() : 0;
+            int tempLevel = level;
+
+            if (targetActor != NULL)
+            {
+                if (ImGui::InputInt("Level", &level))
+                {
+                    if (level < 0) level = 0;
+                    if (level > ActorMaxLevel) level = ActorMaxLevel;
+                }
+
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Level the actor is built into. The game starts in level 0 and scripts switch with LoadLevel.");
+            }
+
+            if (targetActor != NULL && targetActor->GetType() == ActorType::Model)
+            {
+                ImGui::Separator();
+                if (ImGui::InputInt("Pool Size", &poolSize))
+                {
+                    if (poolSize < 0) poolSize = 0;
+                    if (poolSize > ActorMaxPoolSize) poolSize = ActorMaxPoolSize;
+                }
+
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Makes the actor a prefab with this many instances to Spawn at runtime.");
+            }
+
+            if (targetActor != NULL && targetActor->HasCollider())
+            {
+                ImGui::Separator();
+                ImGui::Checkbox("Trigger", &isTrigger);
+
+                if (ImGui::InputInt("Layer", &layer))
+                {
+                    if (layer < 0) layer = 0;
+                    if (layer >= ColliderLayerCount) layer = ColliderLayerCount - 1;
+                }
+
+                ImGui::Text("Collides With");
+                for (int i = 0; i < ColliderLayerCount; i++)
+                {
+                    if (i % 8 != 0) ImGui::SameLine();
+                    ImGui::PushID(i);
+                    ImGui::CheckboxFlags("", &mask, 1 << i);
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Layer %i", i);
+                    ImGui::PopID();
+                }
+            }
+
             GUID groupId = Util::NewGuid();
 
             // Only apply changes to selected actors when one if it's properties has changed
@@ -529,6 +629,36 @@ namespace UltraEd
                         tempScale.z != scale[2] ? scale[2] : curScale.z
                     ));
                 }
+
+                if (tempTrigger != isTrigger && actors[i]->HasCollider())
+                {
+                    m_scene->m_auditor.ChangeActor("Trigger Set", actors[i]->GetId(), groupId);
+                    actors[i]->GetCollider()->SetTrigger(isTrigger);
+                }
+
+                if (tempLayer != layer && actors[i]->HasCollider())
+                {
+                    m_scene->m_auditor.ChangeActor("Layer Set", actors[i]->GetId(), groupId);
+                    actors[i]->GetCollider()->SetLayer(layer);
+                }
+
+                if (tempMask != mask && actors[i]->HasCollider())
+                {
+                    m_scene->m_auditor.ChangeActor("Mask Set", actors[i]->GetId(), groupId);
+                    actors[i]->GetCollider()->SetMask(mask);
+                }
+
+                if (tempPoolSize != poolSize && actors[i]->GetType() == ActorType::Model)
+                {
+                    m_scene->m_auditor.ChangeActor("Pool Size Set", actors[i]->GetId(), groupId);
+                    actors[i]->SetPoolSize(poolSize);
+                }
+
+                if (tempLevel != level)
+                {
+                    m_scene->m_auditor.ChangeActor("Level Set", actors[i]->GetId(), groupId);
+                    actors[i]->SetLevel(level);
+                }
             }
         }
 
@@ -540,6 +670,7 @@ namespace UltraEd
         static int videoMode;
         static int buildCart;
         static int colorTheme;
+        static bool profileScripts;
 
         if (m_optionsModalOpen)
         {
@@ -548,6 +679,7 @@ namespace UltraEd
             videoMode = static_cast<int>(Settings::GetVideoMode());
             buildCart = static_cast<int>(Settings::GetBuildCart());
             colorTheme = static_cast<int>(Settings::GetColorTheme());
+            profileScripts = Settings::GetProfileScripts();
 
             m_optionsModalOpen = false;
         }
@@ -557,6 +689,10 @@ namespace UltraEd
             ImGui::Combo("Color Theme", &colorTheme, "Classic\0Dark\0Light\0\0");
             ImGui::Combo("Video Mode", &videoMode, "NTSC\0PAL\0\0");
             ImGui::Combo("Build Cart", &buildCart, "64drive\0EverDrive-64 X7\0\0");
+            ImGui::Checkbox("Profile Scripts", &profileScripts);
+
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Times each actor's script calls when the ROM is run in the player.");
 
             if (ImGui::Button("Save"))
             {
@@ -565,6 +701,7 @@ namespace UltraEd
 
                 Settings::SetVideoMode(static_cast<VideoMode>(videoMode));
                 Settings::SetBuildCart(static_cast<BuildCart>(buildCart));
+                Settings::SetProfileScripts(profileScripts);
 
                 ImGui::CloseCurrentPopup();
             }
@@ -584,6 +721,7 @@ namespace UltraEd
     {
         static float backgroundColor[3];
         static float gridSnapSize;
+        static int tickRate;
 
         if (m_sceneSettingsModalOpen)
         {
@@ -593,6 +731,7 @@ namespace UltraEd
             backgroundColor[1] = m_scene->m_backgroundColorRGB[1] / 255.0f;
             backgroundColor[2] = m_scene->m_backgroundColorRGB[2] / 255.0f;
             gridSnapSize = m_scene->m_gizmo.GetSnapSize();
+            tickRate = m_scene->GetTickRate();
 
             m_sceneSettingsModalOpen = false;
         }
@@ -601,12 +740,14 @@ namespace UltraEd
         {
             ImGui::ColorEdit3("Background Color", backgroundColor);
             ImGui::InputFloat("Grid Snap Size", &gridSnapSize);
+            ImGui::InputInt("Tick Rate", &tickRate);
 
             if (ImGui::Button("Save"))
             {
                 m_scene->SetBackgroundColor(RGB(backgroundColor[0] * 255, backgroundColor[1] * 255,
                     backgroundColor[2] * 255));
                 m_scene->SetGizmoSnapSize(gridSnapSize);
+                m_scene->SetTickRate(tickRate);
 
                 ImGui::CloseCurrentPopup();
             }
@@ -670,6 +811,11 @@ namespace UltraEd
                     m_scene->OnAddCollider(ColliderType::Sphere);
                 }
 
+                if (ImGui::MenuItem("Mesh"))
+                {
+                    m_scene->OnAddCollider(ColliderType::Mesh);
+                }
+
                 if (m_selectedActor != NULL && m_selectedActor->HasCollider())
                 {
                     ImGui::Separator();
@@ -3,13 +3,16 @@
 
 #include <windows.h>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <ImGui/imgui.h>
 #include <ImGui/imgui_impl_dx9.h>
 #include <ImGui/imgui_impl_win32.h>
 #include <ImGui/Plugins/TextEditor.h>
 #include "Actor.h"
+#include "Common.h"
 
 namespace UltraEd
 {
@@ -50,6 +53,10 @@ namespace UltraEd
         int m_optionsModalOpen;
         int m_sceneSettingsModalOpen;
         Actor *m_selectedActor;
+        std::map<GUID, ScriptCost> m_scriptCosts;
+        std::map<GUID, ScriptCost> m_pendingScriptCosts;
+        bool m_hasPendingScriptCosts;
+        std::mutex m_scriptCostsMutex;
     };
 }
 
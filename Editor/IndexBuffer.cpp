@@ -0,0 +1,55 @@
+#include "IndexBuffer.h"
+
+namespace UltraEd
+{
+    IndexBuffer::IndexBuffer() : m_indexBuffer() { }
+
+    IndexBuffer::~IndexBuffer()
+    {
+        Release();
+    }
+
+    IDirect3DIndexBuffer9 *IndexBuffer::GetBuffer(IDirect3DDevice9 *device, const std::vector<unsigned short> &indices)
+    {
+        return GetOrCreate(device, indices.data(), (UINT)indices.size() * sizeof(unsigned short), D3DFMT_INDEX16);
+    }
+
+    IDirect3DIndexBuffer9 *IndexBuffer::GetBuffer(IDirect3DDevice9 *device, const std::vector<unsigned int> &indices)
+    {
+        return GetOrCreate(device, indices.data(), (UINT)indices.size() * sizeof(unsigned int), D3DFMT_INDEX32);
+    }
+
+    IDirect3DIndexBuffer9 *IndexBuffer::GetOrCreate(IDirect3DDevice9 *device, const void *indices, UINT size,
+        D3DFORMAT format)
+    {
+        // Indices never change after import so the buffer is only filled once.
+        if (m_indexBuffer == NULL && size > 0)
+        {
+            if (FAILED(device->CreateIndexBuffer(size, 0, format, D3DPOOL_DEFAULT, &m_indexBuffer, 0)))
+            {
+                return NULL;
+            }
+
+            void *pIndices;
+            if (FAILED(m_indexBuffer->Lock(0, size, &pIndices, 0)))
+            {
+                Release();
+                return NULL;
+            }
+
+            memcpy(pIndices, indices, size);
+            m_indexBuffer->Unlock();
+        }
+
+        return m_indexBuffer;
+    }
+
+    void IndexBuffer::Release()
+    {
+        if (m_indexBuffer != NULL)
+        {
+            m_indexBuffer->Release();
+            m_indexBuffer = 0;
+        }
+    }
+}
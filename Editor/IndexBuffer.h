@@ -0,0 +1,26 @@
+#ifndef _INDEXBUFFER_H_
+#define _INDEXBUFFER_H_
+
+#include <vector>
+#include <d3dx9.h>
+
+namespace UltraEd
+{
+    class IndexBuffer
+    {
+    public:
+        IndexBuffer();
+        ~IndexBuffer();
+        IDirect3DIndexBuffer9 *GetBuffer(IDirect3DDevice9 *device, const std::vector<unsigned short> &indices);
+        IDirect3DIndexBuffer9 *GetBuffer(IDirect3DDevice9 *device, const std::vector<unsigned int> &indices);
+        void Release();
+
+    private:
+        IDirect3DIndexBuffer9 *GetOrCreate(IDirect3DDevice9 *device, const void *indices, UINT size, D3DFORMAT format);
+
+    private:
+        IDirect3DIndexBuffer9 *m_indexBuffer;
+    };
+}
+
+#endif
@@ -2,17 +2,19 @@
 #include <assimp/postprocess.h>
 #include <assimp/cimport.h>
 #include "Mesh.h"
-#include "FileIO.h"
 
 namespace UltraEd
 {
+    // Corners that share every attribute are welded so faces index into them.
+    const unsigned int Mesh::ImportFlags = aiProcess_Triangulate | aiProcess_ConvertToLeftHanded |
+        aiProcess_OptimizeMeshes | aiProcess_JoinIdenticalVertices;
+
     Mesh::Mesh(const char *filePath) :
         m_vertices(),
-        m_info(FileIO::Import(filePath))
+        m_indices()
     {
         Assimp::Importer importer;
-        const aiScene *scene = importer.ReadFile(m_info.path, aiProcess_Triangulate | aiProcess_ConvertToLeftHanded |
-            aiProcess_OptimizeMeshes);
+        const aiScene *scene = importer.ReadFile(filePath, ImportFlags);
 
         if (scene)
         {
@@ -36,45 +38,55 @@ namespace UltraEd
 
     void Mesh::InsertVerts(aiMatrix4x4 transform, aiMesh *mesh)
     {
-        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        const unsigned int base = static_cast<unsigned int>(m_vertices.size());
+
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            aiFace face = mesh->mFaces[i];
-            for (unsigned int j = 0; j < face.mNumIndices; j++)
-            {
-                Vertex vertex = {
-                    D3DXVECTOR3(0, 0, 0),
-                    D3DXVECTOR3(0, 0, 0),
-                    D3DCOLOR_COLORVALUE(1, 1, 1, 1),
-                    0, 0
-                };
+            Vertex vertex = {
+                D3DXVECTOR3(0, 0, 0),
+                D3DXVECTOR3(0, 0, 0),
+                D3DCOLOR_COLORVALUE(1, 1, 1, 1),
+                0, 0
+            };
 
-                // Apply the current transform to the mesh
-                // so it renders in the correct local location.
-                aiVector3D transformedVertex = mesh->mVertices[face.mIndices[j]];
-                aiTransformVecByMatrix4(&transformedVertex, &transform);
+            // Apply the current transform to the mesh
+            // so it renders in the correct local location.
+            aiVector3D transformedVertex = mesh->mVertices[i];
+            aiTransformVecByMatrix4(&transformedVertex, &transform);
 
-                vertex.position.x = transformedVertex.x;
-                vertex.position.y = transformedVertex.y;
-                vertex.position.z = transformedVertex.z;
+            vertex.position.x = transformedVertex.x;
+            vertex.position.y = transformedVertex.y;
+            vertex.position.z = transformedVertex.z;
 
-                aiVector3D normal = mesh->mNormals[face.mIndices[j]];
-                vertex.normal.x = normal.x;
-                vertex.normal.y = normal.y;
-                vertex.normal.z = normal.z;
-              
-                if (mesh->HasTextureCoords(0))
-                {
-                    vertex.tu = mesh->mTextureCoords[0][face.mIndices[j]].x;
-                    vertex.tv = mesh->mTextureCoords[0][face.mIndices[j]].y;
-                }
+            aiVector3D normal = mesh->mNormals[i];
+            vertex.normal.x = normal.x;
+            vertex.normal.y = normal.y;
+            vertex.normal.z = normal.z;
 
-                if (mesh->HasVertexColors(0))
-                {
-                    aiColor4D color = mesh->mColors[0][face.mIndices[j]];
-                    vertex.color = D3DCOLOR_COLORVALUE(color.r, color.g, color.b, color.a);
-                }
+            if (mesh->HasTextureCoords(0))
+            {
+                vertex.tu = mesh->mTextureCoords[0][i].x;
+                vertex.tv = mesh->mTextureCoords[0][i].y;
+            }
 
-                m_vertices.push_back(vertex);
+            if (mesh->HasVertexColors(0))
+            {
+                aiColor4D color = mesh->mColors[0][i];
+                vertex.color = D3DCOLOR_COLORVALUE(color.r, color.g, color.b, color.a);
+            }
+
+            m_vertices.push_back(vertex);
+        }
+
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            // Triangulation leaves points and lines as they are and those can't be drawn as triangles.
+            aiFace face = mesh->mFaces[i];
+            if (face.mNumIndices != 3) continue;
+
+            for (unsigned int j = 0; j < face.mNumIndices; j++)
+            {
+                m_indices.push_back(base + face.mIndices[j]);
             }
         }
     }
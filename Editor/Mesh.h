@@ -2,7 +2,8 @@
 #define _MESH_H_
 
 #include <assimp/scene.h>
-#include "FileIO.h"
+#include <vector>
+#include "Vertex.h"
 
 namespace UltraEd
 {
@@ -10,14 +11,15 @@ namespace UltraEd
     {
     public:
         Mesh(const char *filePath);
-        std::vector<Vertex> GetVertices() { return m_vertices; }
-        FileInfo GetFileInfo() { return m_info; }
+        static const unsigned int ImportFlags;
+        const std::vector<Vertex> &GetVertices() { return m_vertices; }
+        const std::vector<unsigned int> &GetIndices() { return m_indices; }
 
     private:
         void InsertVerts(aiMatrix4x4 transform, aiMesh *mesh);
         void Process(aiNode *node, const aiScene *scene);
         std::vector<Vertex> m_vertices;
-        FileInfo m_info;
+        std::vector<unsigned int> m_indices;
     };
 }
 
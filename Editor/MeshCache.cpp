@@ -0,0 +1,257 @@
+#include <chrono>
+#include <cstdio>
+#include <shlwapi.h>
+#include "MeshCache.h"
+#include "Mesh.h"
+#include "Debug.h"
+#include "Util.h"
+
+namespace UltraEd
+{
+    std::map<std::string, unsigned long long> MeshCache::m_paths;
+    std::map<unsigned long long, std::shared_ptr<const MeshData>> MeshCache::m_contents;
+    std::mutex MeshCache::m_mutex;
+
+    static const size_t ShortIndexLimit = 65536;
+
+    // Bumped whenever the cache layout or what an import produces changes.
+    static const unsigned int CacheVersion = 1;
+    static const char CacheMagic[4] = { 'U', 'E', 'R', 'M' };
+
+    // Followed by the vertices and then the indices, each laid out as they are in memory.
+    struct CacheHeader
+    {
+        char magic[4];
+        unsigned int version;
+        unsigned long long hash;
+        unsigned int flags;
+        unsigned int vertexCount;
+        unsigned int indexCount;
+        unsigned int indexSize;
+    };
+
+    static std::vector<unsigned short> ShortIndices(size_t vertexCount, const std::vector<unsigned int> &indices)
+    {
+        std::vector<unsigned short> result;
+        if (vertexCount > ShortIndexLimit) return result;
+
+        result.reserve(indices.size());
+        for (unsigned int index : indices)
+        {
+            result.push_back(static_cast<unsigned short>(index));
+        }
+        return result;
+    }
+
+    MeshData::MeshData(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices) :
+        vertices(vertices),
+        shortIndices(ShortIndices(vertices.size(), indices)),
+        longIndices(vertices.size() > ShortIndexLimit ? indices : std::vector<unsigned int>()),
+        pickTree(GetTriangles()),
+        vertexBuffer(std::make_shared<VertexBuffer>()),
+        indexBuffer(std::make_shared<IndexBuffer>())
+    { }
+
+    std::vector<Vertex> MeshData::GetTriangles() const
+    {
+        // Every corner written out in order for the ROM and anything else that wants a plain list.
+        std::vector<Vertex> triangles;
+        triangles.reserve(GetIndexCount());
+        for (size_t i = 0; i < GetIndexCount(); i++)
+        {
+            triangles.push_back(vertices[GetIndex(i)]);
+        }
+        return triangles;
+    }
+
+    size_t MeshData::GetSize() const
+    {
+        return vertices.size() * sizeof(Vertex) + shortIndices.size() * sizeof(unsigned short) +
+            longIndices.size() * sizeof(unsigned int);
+    }
+
+    std::shared_ptr<const MeshData> MeshCache::Get(const std::string &path, std::string *log)
+    {
+        // Hashing and importing run unlocked so meshes loading on other threads carry on meanwhile.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        unsigned long long hash;
+        auto known = m_paths.find(path);
+        if (known != m_paths.end())
+        {
+            // Imported files are never rewritten so a path seen before needs no reading at all.
+            hash = known->second;
+        }
+        else
+        {
+            lock.unlock();
+            bool hashed = Hash(path, &hash);
+            lock.lock();
+
+            // Missing files have nothing to import.
+            if (!hashed) return std::make_shared<const MeshData>();
+            m_paths[path] = hash;
+        }
+
+        // The same model imported twice is copied to two paths but shares one mesh.
+        auto data = m_contents.find(hash);
+        if (data != m_contents.end()) return data->second;
+
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        std::string cachePath = CachePath(hash);
+        auto loaded = ReadCache(cachePath, hash);
+        bool cached = loaded != NULL;
+        if (!cached)
+        {
+            Mesh mesh(path.c_str());
+            loaded = std::make_shared<const MeshData>(mesh.GetVertices(), mesh.GetIndices());
+            WriteCache(cachePath, hash, *loaded);
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::string message = std::string(cached ? "Loaded cached " : "Imported ") + PathFindFileName(path.c_str()) +
+            " in " + std::to_string(elapsed.count()) + " ms, " + std::to_string(loaded->vertices.size()) +
+            " vertices and " + std::to_string(loaded->GetIndexCount() / 3) + " triangles in " +
+            std::to_string(loaded->GetSize() / 1024) + " KB.";
+
+        // The console isn't thread safe so only the render thread writes to it directly.
+        if (log != NULL) *log = message;
+        else Debug::Info(message);
+
+        lock.lock();
+
+        // Another thread may have finished the same content first and actors should all share its copy.
+        return m_contents.insert({ hash, loaded }).first->second;
+    }
+
+    void MeshCache::Purge()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Meshes only the cache holds on to have no actors left to restore them.
+        for (auto entry = m_contents.begin(); entry != m_contents.end();)
+        {
+            entry = entry->second.use_count() == 1 ? m_contents.erase(entry) : ++entry;
+        }
+
+        for (auto entry = m_paths.begin(); entry != m_paths.end();)
+        {
+            entry = m_contents.count(entry->second) == 0 ? m_paths.erase(entry) : ++entry;
+        }
+    }
+
+    bool MeshCache::Hash(const std::string &path, unsigned long long *hash)
+    {
+        std::unique_ptr<FILE, decltype(fclose) *> file(fopen(path.c_str(), "rb"), fclose);
+        if (file == NULL) return false;
+
+        // 64-bit FNV-1a over the file's bytes.
+        unsigned long long value = 0xcbf29ce484222325ULL;
+        unsigned char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file.get())) > 0)
+        {
+            for (size_t i = 0; i < read; i++)
+            {
+                value = (value ^ buffer[i]) * 0x100000001b3ULL;
+            }
+        }
+
+        *hash = value;
+        return true;
+    }
+
+    std::string MeshCache::CachePath(unsigned long long hash)
+    {
+        // Keyed by the flags as well so changing how meshes import skips stale entries.
+        char name[64];
+        sprintf(name, "%016llx-%08x.mesh", hash, Mesh::ImportFlags);
+        return Util::RootPath().append("\\MeshCache\\").append(name);
+    }
+
+    std::shared_ptr<const MeshData> MeshCache::ReadCache(const std::string &cachePath, unsigned long long hash)
+    {
+        HANDLE file = CreateFile(cachePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return NULL;
+
+        // Mapped rather than read so the vertices are copied once, straight out of the page cache.
+        LARGE_INTEGER size;
+        HANDLE mapping = NULL;
+        if (GetFileSizeEx(file, &size) && static_cast<unsigned long long>(size.QuadPart) >= sizeof(CacheHeader))
+        {
+            mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        }
+
+        const void *view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        std::shared_ptr<const MeshData> data;
+        if (view != NULL)
+        {
+            data = ParseCache(static_cast<const unsigned char *>(view), size.QuadPart, hash);
+            UnmapViewOfFile(view);
+        }
+
+        if (mapping != NULL) CloseHandle(mapping);
+        CloseHandle(file);
+        return data;
+    }
+
+    std::shared_ptr<const MeshData> MeshCache::ParseCache(const unsigned char *bytes, unsigned long long size,
+        unsigned long long hash)
+    {
+        const CacheHeader *header = reinterpret_cast<const CacheHeader *>(bytes);
+        if (memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0 || header->version != CacheVersion ||
+            header->hash != hash || header->flags != Mesh::ImportFlags)
+            return NULL;
+
+        if (header->indexSize != sizeof(unsigned short) && header->indexSize != sizeof(unsigned int)) return NULL;
+
+        // A write cut short leaves the file smaller than its header says.
+        unsigned long long vertexBytes = static_cast<unsigned long long>(header->vertexCount) * sizeof(Vertex);
+        unsigned long long indexBytes = static_cast<unsigned long long>(header->indexCount) * header->indexSize;
+        if (size != sizeof(CacheHeader) + vertexBytes + indexBytes) return NULL;
+
+        const Vertex *vertices = reinterpret_cast<const Vertex *>(bytes + sizeof(CacheHeader));
+        const unsigned char *indexData = bytes + sizeof(CacheHeader) + vertexBytes;
+
+        std::vector<unsigned int> indices(header->indexCount);
+        for (unsigned int i = 0; i < header->indexCount; i++)
+        {
+            if (header->indexSize == sizeof(unsigned short))
+                indices[i] = reinterpret_cast<const unsigned short *>(indexData)[i];
+            else
+                indices[i] = reinterpret_cast<const unsigned int *>(indexData)[i];
+
+            // A corrupt index would read past the vertices so the mesh is imported again instead.
+            if (indices[i] >= header->vertexCount) return NULL;
+        }
+
+        return std::make_shared<const MeshData>(std::vector<Vertex>(vertices, vertices + header->vertexCount), indices);
+    }
+
+    void MeshCache::WriteCache(const std::string &cachePath, unsigned long long hash, const MeshData &data)
+    {
+        std::string rootPath = Util::RootPath();
+        CreateDirectory(rootPath.c_str(), NULL);
+        CreateDirectory(rootPath.append("\\MeshCache").c_str(), NULL);
+
+        std::unique_ptr<FILE, decltype(fclose) *> file(fopen(cachePath.c_str(), "wb"), fclose);
+        if (file == NULL) return;
+
+        CacheHeader header = {};
+        memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+        header.version = CacheVersion;
+        header.hash = hash;
+        header.flags = Mesh::ImportFlags;
+        header.vertexCount = static_cast<unsigned int>(data.vertices.size());
+        header.indexCount = static_cast<unsigned int>(data.GetIndexCount());
+        header.indexSize = data.longIndices.empty() ? sizeof(unsigned short) : sizeof(unsigned int);
+
+        fwrite(&header, sizeof(header), 1, file.get());
+        fwrite(data.vertices.data(), sizeof(Vertex), data.vertices.size(), file.get());
+        if (data.longIndices.empty())
+            fwrite(data.shortIndices.data(), sizeof(unsigned short), data.shortIndices.size(), file.get());
+        else
+            fwrite(data.longIndices.data(), sizeof(unsigned int), data.longIndices.size(), file.get());
+    }
+}
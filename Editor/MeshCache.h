@@ -0,0 +1,60 @@
+#ifndef _MESHCACHE_H_
+#define _MESHCACHE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Vertex.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "MeshTree.h"
+
+namespace UltraEd
+{
+    // Geometry shared by every actor that uses the same mesh. Never changed once imported
+    // so copies of an actor only copy the pointer.
+    struct MeshData
+    {
+        MeshData(const std::vector<Vertex> &vertices = {}, const std::vector<unsigned int> &indices = {});
+        size_t GetIndexCount() const { return longIndices.empty() ? shortIndices.size() : longIndices.size(); }
+        unsigned int GetIndex(size_t i) const { return longIndices.empty() ? shortIndices[i] : longIndices[i]; }
+        std::vector<Vertex> GetTriangles() const;
+        size_t GetSize() const;
+        const std::vector<Vertex> vertices;
+
+        // Only one is filled, 16 bits wide unless there are too many vertices to address.
+        const std::vector<unsigned short> shortIndices;
+        const std::vector<unsigned int> longIndices;
+
+        const MeshTree pickTree;
+        const std::shared_ptr<VertexBuffer> vertexBuffer;
+        const std::shared_ptr<IndexBuffer> indexBuffer;
+    };
+
+    // Safe to use from any thread.
+    class MeshCache
+    {
+    public:
+        // Imports are logged to the console unless log is given, which callers off the render thread need.
+        static std::shared_ptr<const MeshData> Get(const std::string &path, std::string *log = NULL);
+        static void Purge();
+
+    private:
+        MeshCache() {}
+        static bool Hash(const std::string &path, unsigned long long *hash);
+        static std::string CachePath(unsigned long long hash);
+        static std::shared_ptr<const MeshData> ReadCache(const std::string &cachePath, unsigned long long hash);
+        static std::shared_ptr<const MeshData> ParseCache(const unsigned char *bytes, unsigned long long size,
+            unsigned long long hash);
+        static void WriteCache(const std::string &cachePath, unsigned long long hash, const MeshData &data);
+
+    private:
+        static std::map<std::string, unsigned long long> m_paths;
+        static std::map<unsigned long long, std::shared_ptr<const MeshData>> m_contents;
+        static std::mutex m_mutex;
+    };
+}
+
+#endif
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <climits>
+#include <map>
+#include <numeric>
+#include "MeshCollider.h"
+#include "Util.h"
+
+namespace UltraEd
+{
+    // Leaves hold a handful of triangles so the tree stays shallow without wasting nodes.
+    static const int LeafTriangles = 4;
+    static const int QuantizedMax = 65535;
+
+    MeshCollider::MeshCollider() :
+        m_triangles()
+    {
+        m_type = ColliderType::Mesh;
+    }
+
+    MeshCollider::MeshCollider(const std::vector<Vertex> &vertices) : MeshCollider()
+    {
+        for (const auto &vertex : vertices)
+        {
+            m_triangles.push_back(vertex.position);
+        }
+
+        Build();
+    }
+
+    void MeshCollider::Build()
+    {
+        m_vertices.clear();
+        m_vertexVersion++;
+
+        // Outline every triangle edge.
+        for (size_t i = 0; i + 2 < m_triangles.size(); i += 3)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                Vertex v1;
+                v1.position = m_triangles[i + j];
+                m_vertices.push_back(v1);
+
+                Vertex v2;
+                v2.position = m_triangles[i + (j + 1) % 3];
+                m_vertices.push_back(v2);
+            }
+        }
+    }
+
+    bool MeshCollider::BuildTree(const D3DXMATRIX &world, std::vector<unsigned char> &data)
+    {
+        typedef std::array<unsigned short, 3> Quantized;
+
+        struct Node
+        {
+            Quantized min, max;
+            int start, count;
+        };
+
+        struct Pending
+        {
+            int node, start, count;
+        };
+
+        const size_t triangleCount = GetTriangleCount();
+        std::vector<Quantized> vertices;
+        std::vector<Quantized> triangles(triangleCount);
+        std::vector<Node> nodes;
+        bool fits = triangleCount > 0 && triangleCount <= USHRT_MAX;
+
+        // Bake the world transform in since mesh colliders are static and flip z to match the engine.
+        std::vector<D3DXVECTOR3> points(triangleCount * 3);
+        D3DXVECTOR3 lower(FLT_MAX, FLT_MAX, FLT_MAX), upper(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (size_t i = 0; fits && i < points.size(); i++)
+        {
+            D3DXVec3TransformCoord(&points[i], &m_triangles[i], &world);
+            points[i].z = -points[i].z;
+            D3DXVec3Minimize(&lower, &lower, &points[i]);
+            D3DXVec3Maximize(&upper, &upper, &points[i]);
+        }
+
+        D3DXVECTOR3 scale(0, 0, 0);
+        if (fits)
+        {
+            scale = (upper - lower) / static_cast<float>(QuantizedMax);
+            if (scale.x <= 0) scale.x = 1;
+            if (scale.y <= 0) scale.y = 1;
+            if (scale.z <= 0) scale.z = 1;
+
+            // Weld on the quantized position so shared corners are only stored once.
+            std::map<Quantized, unsigned short> welded;
+            for (size_t i = 0; fits && i < points.size(); i++)
+            {
+                Quantized q = {
+                    Quantize(points[i].x - lower.x, scale.x),
+                    Quantize(points[i].y - lower.y, scale.y),
+                    Quantize(points[i].z - lower.z, scale.z)
+                };
+
+                auto found = welded.find(q);
+                if (found == welded.end())
+                {
+                    fits = vertices.size() < USHRT_MAX;
+                    found = welded.insert({ q, static_cast<unsigned short>(vertices.size()) }).first;
+                    vertices.push_back(q);
+                }
+
+                triangles[i / 3][i % 3] = found->second;
+            }
+        }
+
+        std::vector<int> order(triangleCount);
+        std::iota(order.begin(), order.end(), 0);
+
+        // Centroids are kept as the sum of the corners to stay in integers.
+        auto centroid = [&](int triangle, int axis) {
+            return vertices[triangles[triangle][0]][axis] + vertices[triangles[triangle][1]][axis]
+                + vertices[triangles[triangle][2]][axis];
+        };
+
+        std::vector<Pending> pending;
+        if (fits)
+        {
+            nodes.push_back(Node());
+            pending.push_back({ 0, 0, static_cast<int>(triangleCount) });
+        }
+
+        // Median splits along the widest centroid axis. Children are stored next to each
+        // other so inner nodes only need the index of the first.
+        while (fits && !pending.empty())
+        {
+            Pending item = pending.back();
+            pending.pop_back();
+
+            Quantized nodeMin = { USHRT_MAX, USHRT_MAX, USHRT_MAX }, nodeMax = { 0, 0, 0 };
+            int centroidMin[3] = { INT_MAX, INT_MAX, INT_MAX }, centroidMax[3] = { 0, 0, 0 };
+            for (int i = item.start; i < item.start + item.count; i++)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    for (int corner = 0; corner < 3; corner++)
+                    {
+                        unsigned short value = vertices[triangles[order[i]][corner]][axis];
+                        if (value < nodeMin[axis]) nodeMin[axis] = value;
+                        if (value > nodeMax[axis]) nodeMax[axis] = value;
+                    }
+
+                    int center = centroid(order[i], axis);
+                    if (center < centroidMin[axis]) centroidMin[axis] = center;
+                    if (center > centroidMax[axis]) centroidMax[axis] = center;
+                }
+            }
+
+            nodes[item.node].min = nodeMin;
+            nodes[item.node].max = nodeMax;
+            nodes[item.node].start = item.start;
+            nodes[item.node].count = item.count;
+
+            int axis = 0;
+            for (int i = 1; i < 3; i++)
+            {
+                if (centroidMax[i] - centroidMin[i] > centroidMax[axis] - centroidMin[axis]) axis = i;
+            }
+
+            // Stop when the triangles can't be separated any further.
+            if (item.count <= LeafTriangles || centroidMax[axis] == centroidMin[axis]) continue;
+
+            int mid = item.start + item.count / 2;
+            std::nth_element(order.begin() + item.start, order.begin() + mid, order.begin() + item.start + item.count,
+                [&](int a, int b) { return centroid(a, axis) < centroid(b, axis); });
+
+            int child = static_cast<int>(nodes.size());
+            nodes.resize(child + 2);
+            nodes[item.node].start = child;
+            nodes[item.node].count = 0;
+            fits = nodes.size() <= USHRT_MAX;
+
+            pending.push_back({ child, item.start, mid - item.start });
+            pending.push_back({ child + 1, mid, item.start + item.count - mid });
+        }
+
+        // Unbuildable meshes still get a header so the ROM segment links and the engine sees an empty tree.
+        if (!fits)
+        {
+            lower = scale = D3DXVECTOR3(0, 0, 0);
+            nodes.clear();
+            vertices.clear();
+            order.clear();
+        }
+
+        data.clear();
+        Util::WriteFloat(data, lower.x);
+        Util::WriteFloat(data, lower.y);
+        Util::WriteFloat(data, lower.z);
+        Util::WriteFloat(data, scale.x);
+        Util::WriteFloat(data, scale.y);
+        Util::WriteFloat(data, scale.z);
+        Util::WriteShort(data, static_cast<unsigned short>(nodes.size()));
+        Util::WriteShort(data, static_cast<unsigned short>(order.size()));
+        Util::WriteShort(data, static_cast<unsigned short>(vertices.size()));
+        Util::WriteShort(data, 0);
+
+        for (const auto &node : nodes)
+        {
+            for (int i = 0; i < 3; i++) Util::WriteShort(data, node.min[i]);
+            for (int i = 0; i < 3; i++) Util::WriteShort(data, node.max[i]);
+            Util::WriteShort(data, static_cast<unsigned short>(node.start));
+            Util::WriteShort(data, static_cast<unsigned short>(node.count));
+        }
+
+        for (const auto &vertex : vertices)
+        {
+            for (int i = 0; i < 3; i++) Util::WriteShort(data, vertex[i]);
+        }
+
+        for (const auto &triangle : order)
+        {
+            for (int i = 0; i < 3; i++) Util::WriteShort(data, triangles[triangle][i]);
+        }
+
+        // Keep the segment a multiple of 8 bytes for DMA.
+        while (data.size() % 8 != 0) data.push_back(0);
+
+        return fits;
+    }
+
+    unsigned short MeshCollider::Quantize(float offset, float scale)
+    {
+        float steps = floorf(offset / scale + 0.5f);
+        if (steps < 0) return 0;
+        if (steps > QuantizedMax) return QuantizedMax;
+        return static_cast<unsigned short>(steps);
+    }
+}
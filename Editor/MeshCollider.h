@@ -0,0 +1,26 @@
+#ifndef _MESHCOLLIDER_H_
+#define _MESHCOLLIDER_H_
+
+#include "Collider.h"
+
+namespace UltraEd
+{
+    class MeshCollider : public Collider
+    {
+    public:
+        MeshCollider();
+        MeshCollider(const std::vector<Vertex> &vertices);
+        void Build();
+        Collider *Clone() { return new MeshCollider(*this); }
+        size_t GetTriangleCount() { return m_triangles.size() / 3; }
+        bool BuildTree(const D3DXMATRIX &world, std::vector<unsigned char> &data);
+
+    private:
+        unsigned short Quantize(float offset, float scale);
+
+    private:
+        std::vector<D3DXVECTOR3> m_triangles;
+    };
+}
+
+#endif
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include "MeshTree.h"
+
+namespace UltraEd
+{
+    // Matches the mesh collider tree. Median splits keep the depth well under the traversal stack.
+    static const int LeafTriangles = 4;
+    static const int MaxDepth = 64;
+
+    MeshTree::MeshTree(const std::vector<Vertex> &vertices) :
+        m_nodes(),
+        m_triangles()
+    {
+        struct Pending
+        {
+            int node, start, count;
+        };
+
+        const int triangleCount = static_cast<int>(vertices.size() / 3);
+        if (triangleCount == 0) return;
+
+        std::vector<D3DXVECTOR3> centroids(triangleCount);
+        for (int i = 0; i < triangleCount; i++)
+        {
+            centroids[i] = (vertices[i * 3].position + vertices[i * 3 + 1].position + vertices[i * 3 + 2].position) / 3.0f;
+        }
+
+        std::vector<int> order(triangleCount);
+        std::iota(order.begin(), order.end(), 0);
+
+        std::vector<Pending> pending;
+        m_nodes.push_back(Node());
+        pending.push_back({ 0, 0, triangleCount });
+
+        // Children are stored next to each other so inner nodes only need the index of the first.
+        while (!pending.empty())
+        {
+            Pending item = pending.back();
+            pending.pop_back();
+
+            D3DXVECTOR3 nodeMin(FLT_MAX, FLT_MAX, FLT_MAX), nodeMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            D3DXVECTOR3 centroidMin(nodeMin), centroidMax(nodeMax);
+            for (int i = item.start; i < item.start + item.count; i++)
+            {
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    D3DXVec3Minimize(&nodeMin, &nodeMin, &vertices[order[i] * 3 + corner].position);
+                    D3DXVec3Maximize(&nodeMax, &nodeMax, &vertices[order[i] * 3 + corner].position);
+                }
+
+                D3DXVec3Minimize(&centroidMin, &centroidMin, &centroids[order[i]]);
+                D3DXVec3Maximize(&centroidMax, &centroidMax, &centroids[order[i]]);
+            }
+
+            m_nodes[item.node] = { nodeMin, nodeMax, item.start, item.count };
+
+            D3DXVECTOR3 spread = centroidMax - centroidMin;
+            int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+            // Stop when the triangles can't be separated any further.
+            if (item.count <= LeafTriangles || spread[axis] <= 0) continue;
+
+            int mid = item.start + item.count / 2;
+            std::nth_element(order.begin() + item.start, order.begin() + mid, order.begin() + item.start + item.count,
+                [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+            int child = static_cast<int>(m_nodes.size());
+            m_nodes.resize(child + 2);
+            m_nodes[item.node].start = child;
+            m_nodes[item.node].count = 0;
+
+            pending.push_back({ child, item.start, mid - item.start });
+            pending.push_back({ child + 1, mid, item.start + item.count - mid });
+        }
+
+        // Leaves point into the triangles in tree order so each one reads a contiguous run.
+        m_triangles.reserve(triangleCount * 3);
+        for (int triangle : order)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                m_triangles.push_back(vertices[triangle * 3 + corner].position);
+            }
+        }
+    }
+
+    bool MeshTree::Intersect(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, bool mirrored, float *dist) const
+    {
+        struct Visit
+        {
+            int node;
+            float entry;
+        };
+
+        if (m_nodes.empty()) return false;
+
+        D3DXVECTOR3 invDir = InverseDirection(dir);
+        float nearest = FLT_MAX, entry;
+        Visit stack[MaxDepth];
+        int top = 0;
+
+        if (!IntersectBounds(m_nodes[0].min, m_nodes[0].max, orig, invDir, nearest, &entry)) return false;
+        stack[top++] = { 0, entry };
+
+        while (top > 0)
+        {
+            Visit visit = stack[--top];
+            if (visit.entry > nearest) continue;
+
+            const Node &node = m_nodes[visit.node];
+            if (node.count > 0)
+            {
+                for (int i = node.start; i < node.start + node.count; i++)
+                {
+                    float hit;
+                    if (IntersectTriangle(orig, dir, &m_triangles[i * 3], mirrored, &hit) && hit < nearest)
+                        nearest = hit;
+                }
+                continue;
+            }
+
+            // The nearer child goes on top so its hits can cull the farther one.
+            Visit first = { node.start, 0 }, second = { node.start + 1, 0 };
+            const Node &firstNode = m_nodes[first.node], &secondNode = m_nodes[second.node];
+            bool hitFirst = IntersectBounds(firstNode.min, firstNode.max, orig, invDir, nearest, &first.entry);
+            bool hitSecond = IntersectBounds(secondNode.min, secondNode.max, orig, invDir, nearest, &second.entry);
+
+            if (hitFirst && hitSecond && second.entry < first.entry) std::swap(first, second);
+            if (hitSecond) stack[top++] = second;
+            if (hitFirst) stack[top++] = first;
+        }
+
+        if (nearest == FLT_MAX) return false;
+
+        *dist = nearest;
+        return true;
+    }
+
+    bool MeshTree::GetBounds(D3DXVECTOR3 *min, D3DXVECTOR3 *max) const
+    {
+        if (m_nodes.empty()) return false;
+
+        *min = m_nodes[0].min;
+        *max = m_nodes[0].max;
+        return true;
+    }
+
+    bool MeshTree::IntersectBounds(const D3DXVECTOR3 &min, const D3DXVECTOR3 &max, const D3DXVECTOR3 &orig,
+        const D3DXVECTOR3 &invDir, float maxDist, float *entry)
+    {
+        float nearDist = 0, farDist = maxDist;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float t1 = (min[axis] - orig[axis]) * invDir[axis];
+            float t2 = (max[axis] - orig[axis]) * invDir[axis];
+            nearDist = fmaxf(nearDist, fminf(t1, t2));
+            farDist = fminf(farDist, fmaxf(t1, t2));
+        }
+
+        *entry = nearDist;
+        return nearDist <= farDist;
+    }
+
+    D3DXVECTOR3 MeshTree::InverseDirection(const D3DXVECTOR3 &dir)
+    {
+        // Axes the ray runs parallel to get a huge but finite slope. Infinity would give NaN in the
+        // slab test when the origin sits on a node's face.
+        D3DXVECTOR3 invDir;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (fabsf(dir[axis]) > FLT_EPSILON)
+                invDir[axis] = 1.0f / dir[axis];
+            else
+                invDir[axis] = dir[axis] < 0 ? -FLT_MAX : FLT_MAX;
+        }
+        return invDir;
+    }
+
+    bool MeshTree::IntersectTriangle(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, const D3DXVECTOR3 *corners,
+        bool mirrored, float *dist)
+    {
+        D3DXVECTOR3 edge1 = corners[1] - corners[0];
+        D3DXVECTOR3 edge2 = corners[2] - corners[0];
+
+        D3DXVECTOR3 pvec;
+        D3DXVec3Cross(&pvec, &dir, &edge2);
+
+        // Back faces can't be picked, the same as they can't be seen. A mirroring transform
+        // flips the winding so the other side faces the camera.
+        float det = D3DXVec3Dot(&edge1, &pvec);
+        if ((mirrored ? -det : det) <= 0.0f) return false;
+
+        float invDet = 1.0f / det;
+        D3DXVECTOR3 tvec = orig - corners[0];
+        float u = D3DXVec3Dot(&tvec, &pvec) * invDet;
+        if (u < 0.0f || u > 1.0f) return false;
+
+        D3DXVECTOR3 qvec;
+        D3DXVec3Cross(&qvec, &tvec, &edge1);
+        float v = D3DXVec3Dot(&dir, &qvec) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return false;
+
+        // Hits behind the ray's origin don't count.
+        *dist = D3DXVec3Dot(&edge2, &qvec) * invDet;
+        return *dist >= 0.0f;
+    }
+}
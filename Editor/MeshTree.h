@@ -0,0 +1,39 @@
+#ifndef _MESHTREE_H_
+#define _MESHTREE_H_
+
+#include <vector>
+#include "Vertex.h"
+
+namespace UltraEd
+{
+    // Bounding volume hierarchy over a mesh's triangles in the mesh's own space. Built once
+    // on import so picking only visits the triangles near the ray.
+    class MeshTree
+    {
+    public:
+        MeshTree(const std::vector<Vertex> &vertices);
+        bool Intersect(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, bool mirrored, float *dist) const;
+        size_t GetTriangleCount() const { return m_triangles.size() / 3; }
+        size_t GetNodeCount() const { return m_nodes.size(); }
+        bool GetBounds(D3DXVECTOR3 *min, D3DXVECTOR3 *max) const;
+        static bool IntersectBounds(const D3DXVECTOR3 &min, const D3DXVECTOR3 &max, const D3DXVECTOR3 &orig,
+            const D3DXVECTOR3 &invDir, float maxDist, float *entry);
+        static D3DXVECTOR3 InverseDirection(const D3DXVECTOR3 &dir);
+
+    private:
+        struct Node
+        {
+            D3DXVECTOR3 min, max;
+            int start, count;
+        };
+
+        static bool IntersectTriangle(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, const D3DXVECTOR3 *corners,
+            bool mirrored, float *dist);
+
+    private:
+        std::vector<Node> m_nodes;
+        std::vector<D3DXVECTOR3> m_triangles;
+    };
+}
+
+#endif
@@ -9,6 +9,9 @@ namespace UltraEd
     {
         *this = model;
         ResetId();
+
+        // Colliders are editable so each copy needs its own.
+        if (HasCollider()) SetCollider(GetCollider()->Clone());
     }
 
     Model::Model(const char *filePath) : Model()
@@ -18,9 +21,10 @@ namespace UltraEd
 
     void Model::Render(IDirect3DDevice9 *device, ID3DXMatrixStack *stack)
     {
-        auto *buffer = m_vertexBuffer->GetBuffer(device, GetVertices());
+        auto *buffer = GetVertexBuffer(device);
+        auto *indices = GetIndexBuffer(device);
 
-        if (buffer != NULL)
+        if (buffer != NULL && indices != NULL)
         {
             stack->Push();
             stack->MultMatrixLocal(&GetMatrix());
@@ -30,8 +34,10 @@ namespace UltraEd
             device->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
             device->SetTransform(D3DTS_WORLD, stack->GetTop());
             device->SetStreamSource(0, buffer, 0, sizeof(Vertex));
+            device->SetIndices(indices);
             device->SetFVF(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_DIFFUSE | D3DFVF_TEX1);
-            device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, static_cast<UINT>(GetVertices().size() / 3));
+            device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, static_cast<UINT>(GetVertices().size()), 0,
+                static_cast<UINT>(GetTriangleCount()));
             device->SetTexture(0, NULL);
 
             stack->Pop();
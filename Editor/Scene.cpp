@@ -7,10 +7,17 @@
 #include "Util.h"
 #include "BoxCollider.h"
 #include "SphereCollider.h"
+#include "MeshCollider.h"
+#include "MeshCache.h"
 #include "PubSub.h"
+#include "Settings.h"
 
 namespace UltraEd
 {
+    // Gameplay ticks per second, independent of how fast the ROM renders.
+    static const int DefaultTickRate = 30;
+    static const int MaxTickRate = 60;
+
     Scene::Scene() :
         m_defaultMaterial(),
         m_fillMode(D3DFILLMODE::D3DFILL_SOLID),
@@ -20,13 +27,15 @@ namespace UltraEd
         m_d3d9(0),
         m_d3dpp(),
         m_actors(),
+        m_sceneTree(),
+        m_loader(),
         m_grid(),
-        m_selectedActorIds(),
         m_mouseSmoothX(0),
         m_mouseSmoothY(0),
         m_activeViewType(ViewType::Perspective),
         m_sceneName(),
         m_backgroundColorRGB(),
+        m_tickRate(DefaultTickRate),
         m_auditor(this),
         m_gui()
     {
@@ -78,17 +87,22 @@ namespace UltraEd
 
         SetTitle("Untitled");
         UnselectAll();
+        m_loader.Cancel();
         ReleaseResources(ModelRelease::AllResources);
-        m_actors.clear();
+        m_actors.Clear();
         m_auditor.Reset();
+        MeshCache::Purge();
         ResetViews();
         m_backgroundColorRGB[0] = m_backgroundColorRGB[1] = m_backgroundColorRGB[2] = 0;
+        m_tickRate = DefaultTickRate;
         m_gizmo.SetSnapSize(0.5f);
         SetDirty(false);
     }
 
     bool Scene::OnSave()
     {
+        RestoreLoadedActors(true);
+
         std::string savedName;
         if (FileIO::Save(this, savedName))
         {
@@ -117,12 +131,21 @@ namespace UltraEd
 
     void Scene::OnBuildROM(BuildFlag flag)
     {
+        RestoreLoadedActors(true);
+
         std::thread run([this, flag]() {
+            std::vector<std::vector<GUID>> slots = Build::ScriptSlots(GetActors());
             if (Build::Start(this))
             {
                 if (static_cast<int>(flag) & static_cast<int>(BuildFlag::Run))
                 {
                     Build::Run();
+
+                    std::map<GUID, ScriptCost> costs;
+                    if (Settings::GetProfileScripts() && Build::ReadScriptCosts(slots, &costs))
+                    {
+                        PubSub::Publish("ScriptCosts", &costs);
+                    }
                 }
                 else if (static_cast<int>(flag) & static_cast<int>(BuildFlag::Load))
                 {
@@ -152,8 +175,8 @@ namespace UltraEd
                     "VRML (*.wrl)\0*.wrl\0Wavefront (*.obj)\0*.obj", file))
                 {
                     model = std::make_shared<Model>(file.c_str());
-                    m_actors[model->GetId()] = model;
-                    model->SetName(std::string("Actor ").append(std::to_string(m_actors.size())));
+                    m_actors.Add(model);
+                    model->SetName(std::string("Actor ").append(std::to_string(m_actors.GetSize())));
                     m_auditor.AddActor("Model", model->GetId());
                 }
                 break;
@@ -161,8 +184,8 @@ namespace UltraEd
             case ModelPreset::Pumpkin:
             {
                 model = std::make_shared<Model>("presets/pumpkin.fbx");
-                m_actors[model->GetId()] = model;
-                model->SetName(std::string("Pumpkin ").append(std::to_string(m_actors.size())));
+                m_actors.Add(model);
+                model->SetName(std::string("Pumpkin ").append(std::to_string(m_actors.GetSize())));
                 model->SetTexture(m_device, "presets/pumpkin.png");
                 m_auditor.AddActor("Pumpkin", model->GetId());
                 break;
@@ -178,8 +201,8 @@ namespace UltraEd
     void Scene::OnAddCamera()
     {
         auto newCamera = std::make_shared<Camera>();
-        m_actors[newCamera->GetId()] = newCamera;
-        newCamera->SetName(std::string("Camera ").append(std::to_string(m_actors.size())));
+        m_actors.Add(newCamera);
+        newCamera->SetName(std::string("Camera ").append(std::to_string(m_actors.GetSize())));
         m_auditor.AddActor("Camera", newCamera->GetId());
 
         SelectActorById(newCamera->GetId());
@@ -187,42 +210,53 @@ namespace UltraEd
 
     void Scene::OnAddCollider(ColliderType type)
     {
-        if (m_selectedActorIds.empty())
+        if (!m_actors.HasSelection())
         {
             Debug::Warning("An object must be selected first.");
         }
 
         GUID groupId = Util::NewGuid();
 
-        for (const auto &selectedActorId : m_selectedActorIds)
+        for (const auto &selectedActorId : m_actors.GetSelection())
         {
+            auto actor = GetActor(selectedActorId);
+            if (type == ColliderType::Mesh && actor->GetType() != ActorType::Model)
+            {
+                Debug::Warning("Mesh colliders can only be added to models.");
+                continue;
+            }
+
             m_auditor.ChangeActor("Add Collider", selectedActorId, groupId);
 
             if (type == ColliderType::Box)
             {
-                m_actors[selectedActorId]->SetCollider(new BoxCollider(m_actors[selectedActorId]->GetVertices()));
+                actor->SetCollider(new BoxCollider(actor->GetVertices()));
+            }
+            else if (type == ColliderType::Sphere)
+            {
+                actor->SetCollider(new SphereCollider(actor->GetVertices()));
             }
             else
             {
-                m_actors[selectedActorId]->SetCollider(new SphereCollider(m_actors[selectedActorId]->GetVertices()));
+                actor->SetCollider(new MeshCollider(actor->GetTriangles()));
             }
         }
     }
 
     void Scene::OnDeleteCollider()
     {
-        if (m_selectedActorIds.empty())
+        if (!m_actors.HasSelection())
         {
             Debug::Warning("An object must be selected first.");
         }
 
         GUID groupId = Util::NewGuid();
 
-        for (const auto &selectedActorId : m_selectedActorIds)
+        for (const auto &selectedActorId : m_actors.GetSelection())
         {
             m_auditor.ChangeActor("Delete Collider", selectedActorId, groupId);
 
-            m_actors[selectedActorId]->SetCollider(NULL);
+            GetActor(selectedActorId)->SetCollider(NULL);
         }
     }
 
@@ -230,7 +264,7 @@ namespace UltraEd
     {
         std::string file;
 
-        if (m_selectedActorIds.empty())
+        if (!m_actors.HasSelection())
         {
             Debug::Warning("An actor must be selected first.");
             return;
@@ -241,13 +275,14 @@ namespace UltraEd
         {
             GUID groupId = Util::NewGuid();
 
-            for (const auto &selectedActorId : m_selectedActorIds)
+            for (const auto &selectedActorId : m_actors.GetSelection())
             {
-                if (m_actors[selectedActorId]->GetType() != ActorType::Model) continue;
+                auto actor = GetActor(selectedActorId);
+                if (actor->GetType() != ActorType::Model) continue;
 
                 m_auditor.ChangeActor("Add Texture", selectedActorId, groupId);
 
-                if (!dynamic_cast<Model *>(m_actors[selectedActorId].get())->SetTexture(m_device, file.c_str()))
+                if (!dynamic_cast<Model *>(actor.get())->SetTexture(m_device, file.c_str()))
                 {
                     Debug::Warning("Texture could not be loaded.");
                 }
@@ -257,7 +292,7 @@ namespace UltraEd
 
     void Scene::OnDeleteTexture()
     {
-        if (m_selectedActorIds.empty())
+        if (!m_actors.HasSelection())
         {
             Debug::Warning("An actor must be selected first.");
             return;
@@ -265,13 +300,14 @@ namespace UltraEd
 
         GUID groupId = Util::NewGuid();
 
-        for (const auto &selectedActorId : m_selectedActorIds)
+        for (const auto &selectedActorId : m_actors.GetSelection())
         {
-            if (m_actors[selectedActorId]->GetType() != ActorType::Model) continue;
+            auto actor = GetActor(selectedActorId);
+            if (actor->GetType() != ActorType::Model) continue;
 
             m_auditor.ChangeActor("Delete Texture", selectedActorId, groupId);
 
-            dynamic_cast<Model *>(m_actors[selectedActorId].get())->DeleteTexture();
+            dynamic_cast<Model *>(actor.get())->DeleteTexture();
         }
     }
 
@@ -282,27 +318,23 @@ namespace UltraEd
         const bool gizmoSelected = m_gizmo.Select(orig, dir);
         float closestDist = FLT_MAX;
 
-        if (!ignoreGizmo && gizmoSelected && !m_selectedActorIds.empty())
+        if (!ignoreGizmo && gizmoSelected && m_actors.HasSelection())
             return false;
 
-        // Check all actors to see which poly might have been picked.
-        for (const auto &actor : m_actors)
-        {
-            // Only choose the closest actors to the view.
-            float pickDist = 0;
-            if (actor.second->Pick(orig, dir, &pickDist) && pickDist < closestDist)
-            {
-                closestDist = pickDist;
+        // Only actors whose bounds the ray crosses have their triangles tested. The tree first
+        // catches up with actors added, removed or moved since the last pick.
+        m_sceneTree.Update(m_actors);
+        Actor *closest = m_sceneTree.Pick(orig, dir, &closestDist);
 
-                SelectActorById(actor.first, !m_gui->IO().KeyShift);
+        if (closest != NULL)
+        {
+            SelectActorById(closest->GetId(), !m_gui->IO().KeyShift);
 
-                if (selectedActor != NULL)
-                    *selectedActor = actor.second.get();
-            }
-        }
+            if (selectedActor != NULL)
+                *selectedActor = closest;
 
-        if (closestDist != FLT_MAX)
             return true;
+        }
 
         UnselectAll();
 
@@ -342,19 +374,19 @@ namespace UltraEd
         if (ImGui::IsKeyPressed(0x32, false)) m_gizmo.SetModifier(GizmoModifierState::Rotate);
         if (ImGui::IsKeyPressed(0x33, false)) m_gizmo.SetModifier(GizmoModifierState::Scale);
 
-        if (m_gui->IO().MouseDown[0] && !m_selectedActorIds.empty())
+        if (m_gui->IO().MouseDown[0] && m_actors.HasSelection())
         {
             D3DXVECTOR3 rayOrigin, rayDir;
             ScreenRaycast(m_gui->IO().MousePos, &rayOrigin, &rayDir);
             if (prevGizmo || (prevGizmo = m_gizmo.Select(rayOrigin, rayDir)))
             {
-                GUID lastSelectedActorId = m_selectedActorIds.back();
-                for (const auto &selectedActorId : m_selectedActorIds)
+                Actor *lastSelectedActor = m_actors.GetLastSelected();
+                for (const auto &selectedActorId : m_actors.GetSelection())
                 {
                     auto action = m_auditor.PotentialChangeActor(m_gizmo.GetModifierName(), selectedActorId, groupId);
 
-                    if (m_gizmo.Update(GetActiveView(), rayOrigin, rayDir, m_actors[selectedActorId].get(),
-                        m_actors[lastSelectedActorId].get()))
+                    if (m_gizmo.Update(GetActiveView(), rayOrigin, rayDir, GetActor(selectedActorId).get(),
+                        lastSelectedActor))
                     {
                         action();
                     }
@@ -441,6 +473,7 @@ namespace UltraEd
 
         if (!m_device || !m_gui) return;
 
+        RestoreLoadedActors();
         m_gui->PrepareFrame();
 
         ID3DXMatrixStack *stack;
@@ -461,14 +494,14 @@ namespace UltraEd
             m_device->SetRenderState(D3DRS_FILLMODE, m_fillMode);
             m_device->SetRenderState(D3DRS_AMBIENTMATERIALSOURCE, D3DMCS_COLOR1);
 
-            for (const auto &actor : m_actors)
+            for (size_t i = 0; i < m_actors.GetSize(); i++)
             {
                 // Highlight any selected actors.
-                m_device->SetRenderState(D3DRS_AMBIENT, IsActorSelected(actor.first) ? 0x0000ff00 : 0xffffffff);
-                actor.second->Render(m_device, stack);
+                m_device->SetRenderState(D3DRS_AMBIENT, m_actors.IsSelected(i) ? 0x0000ff00 : 0xffffffff);
+                m_actors.GetActors()[i]->Render(m_device, stack);
             }
 
-            if (!m_selectedActorIds.empty())
+            if (m_actors.HasSelection())
             {
                 // Draw the gizmo on "top" of all objects in scene.
                 m_device->SetRenderState(D3DRS_FILLMODE, D3DFILL_SOLID);
@@ -493,7 +526,7 @@ namespace UltraEd
 
         for (const auto &actor : m_actors)
         {
-            if (actor.second->IsDirty())
+            if (actor->IsDirty() || (actor->HasCollider() && actor->GetCollider()->IsDirty()))
             {
                 SetDirty(true);
                 break;
@@ -570,24 +603,25 @@ namespace UltraEd
 
     std::string Scene::GetStats()
     {
-        size_t vertCount = 0;
+        size_t triangleCount = 0;
         for (const auto &actor : m_actors)
         {
-            if (actor.second->GetType() == ActorType::Model)
+            if (actor->GetType() == ActorType::Model)
             {
-                vertCount += actor.second->GetVertices().size();
+                triangleCount += actor->GetTriangleCount();
             }
         }
-        return std::string("Actors:").append(std::to_string(m_actors.size()))
-            .append(" | Tris:").append(std::to_string(vertCount / 3));
+        return std::string("Actors:").append(std::to_string(m_actors.GetSize()))
+            .append(" | Tris:").append(std::to_string(triangleCount))
+            .append(" | Uploads:").append(std::to_string(VertexBuffer::GetUploadCount()));
     }
 
     bool Scene::ToggleMovementSpace()
     {
         auto toggled = m_gizmo.ToggleSpace();
-        if (!m_selectedActorIds.empty())
+        if (m_actors.HasSelection())
         {
-            m_gizmo.Update(m_actors[m_selectedActorIds.back()].get());
+            m_gizmo.Update(m_actors.GetLastSelected());
         }
         return toggled;
     }
@@ -611,26 +645,25 @@ namespace UltraEd
 
         for (const auto &actor : m_actors)
         {
-            if (auto model = dynamic_cast<Model *>(actor.second.get()))
+            if (auto model = dynamic_cast<Model *>(actor.get()))
             {
                 model->Release(type);
             }
             else
             {
-                actor.second->Release();
+                actor->Release();
             }
         }
     }
 
     void Scene::Delete()
     {
-        // Copy selected ids since loop modifies the master selected actor id vector.
+        // The selection is copied out since deleting an actor drops it from the registry's.
         GUID groupId = Util::NewGuid();
-        auto selectedActorIds = m_selectedActorIds;
-        for (const auto &selectedActorId : selectedActorIds)
+        for (const auto &selectedActorId : m_actors.GetSelection())
         {
             m_auditor.DeleteActor("Actor", selectedActorId, groupId);
-            Delete(m_actors[selectedActorId]);
+            Delete(GetActor(selectedActorId));
             SetDirty(true);
         }
     }
@@ -646,34 +679,32 @@ namespace UltraEd
             actor->Release();
         }
 
-        // Unselect actor if selected.
-        auto it = find(m_selectedActorIds.begin(), m_selectedActorIds.end(), actor->GetId());
-        if (it != m_selectedActorIds.end()) m_selectedActorIds.erase(it);
-
-        m_actors.erase(actor->GetId());
+        // Removing the actor also drops it from the selection.
+        m_actors.Remove(actor->GetId());
     }
 
     void Scene::Duplicate()
     {
         GUID groupId = Util::NewGuid();
 
-        for (const auto &selectedActorId : m_selectedActorIds)
+        for (const auto &selectedActorId : m_actors.GetSelection())
         {
-            switch (m_actors[selectedActorId]->GetType())
+            auto actor = GetActor(selectedActorId);
+            switch (actor->GetType())
             {
                 case ActorType::Model:
                 {
-                    auto model = std::make_shared<Model>(*dynamic_cast<Model *>(m_actors[selectedActorId].get()));
+                    auto model = std::make_shared<Model>(*dynamic_cast<Model *>(actor.get()));
                     std::string texturePath = model->GetResources()["textureDataPath"];
                     model->SetTexture(m_device, texturePath.c_str());
-                    m_actors[model->GetId()] = model;
+                    m_actors.Add(model);
                     m_auditor.AddActor("Model", model->GetId(), groupId);
                     break;
                 }
                 case ActorType::Camera:
                 {
-                    auto camera = std::make_shared<Camera>(*dynamic_cast<Camera *>(m_actors[selectedActorId].get()));
-                    m_actors[camera->GetId()] = camera;
+                    auto camera = std::make_shared<Camera>(*dynamic_cast<Camera *>(actor.get()));
+                    m_actors.Add(camera);
                     m_auditor.AddActor("Camera", camera->GetId(), groupId);
                     break;
                 }
@@ -683,27 +714,27 @@ namespace UltraEd
 
     void Scene::FocusSelected()
     {
-        if (m_selectedActorIds.size() > 0)
+        if (m_actors.HasSelection())
         {
-            auto selectedActor = m_actors[m_selectedActorIds[0]];
+            Actor *selectedActor = m_actors.GetFirstSelected();
             GetActiveView()->SetPosition(selectedActor->GetPosition() + (GetActiveView()->GetForward() * -2.5f));
         }
     }
 
     void Scene::SetScript(std::string script)
     {
-        if (!m_selectedActorIds.empty())
+        if (m_actors.HasSelection())
         {
-            m_auditor.ChangeActor("Script Change", m_selectedActorIds[0]);
-            m_actors[m_selectedActorIds[0]]->SetScript(script);
+            m_auditor.ChangeActor("Script Change", m_actors.GetFirstSelected()->GetId());
+            m_actors.GetFirstSelected()->SetScript(script);
         }
     }
 
     std::string Scene::GetScript()
     {
-        if (!m_selectedActorIds.empty())
+        if (m_actors.HasSelection())
         {
-            return m_actors[m_selectedActorIds[0]]->GetScript();
+            return m_actors.GetFirstSelected()->GetScript();
         }
         return std::string("");
     }
@@ -739,6 +770,23 @@ namespace UltraEd
         return RGB(m_backgroundColorRGB[0], m_backgroundColorRGB[1], m_backgroundColorRGB[2]);
     }
 
+    void Scene::SetTickRate(int rate)
+    {
+        if (rate < 1) rate = 1;
+        if (rate > MaxTickRate) rate = MaxTickRate;
+
+        if (m_tickRate != rate)
+        {
+            m_auditor.ChangeScene("Tick Rate");
+            Dirty([&] { m_tickRate = rate; }, &m_tickRate);
+        }
+    }
+
+    int Scene::GetTickRate()
+    {
+        return m_tickRate;
+    }
+
     HWND Scene::GetWndHandle()
     {
         D3DDEVICE_CREATION_PARAMETERS params;
@@ -749,37 +797,29 @@ namespace UltraEd
         return NULL;
     }
 
-    std::vector<Actor *> Scene::GetActors(bool selectedOnly)
+    const std::vector<Actor *> &Scene::GetActors()
+    {
+        return m_actors.GetActors();
+    }
+
+    std::vector<Actor *> Scene::GetSelectedActors()
     {
         std::vector<Actor *> actors;
-        if (selectedOnly)
+        for (const auto &actorId : m_actors.GetSelection())
         {
-            for (const auto &actorId : m_selectedActorIds)
-            {
-                actors.push_back(GetActor(actorId).get());
-            }
-        }
-        else
-        {
-            for (const auto &actor : m_actors)
-            {
-                actors.push_back(actor.second.get());
-            }
+            actors.push_back(GetActor(actorId).get());
         }
         return actors;
     }
 
     std::shared_ptr<Actor> Scene::GetActor(GUID id)
     {
-        if (m_actors.find(id) != m_actors.end())
-            return m_actors[id];
-        return NULL;
+        return m_actors.Find(id);
     }
 
     bool Scene::IsActorSelected(GUID id)
     {
-        auto it = std::find(m_selectedActorIds.begin(), m_selectedActorIds.end(), id);
-        return it != m_selectedActorIds.end();
+        return m_actors.IsSelected(id);
     }
 
     void Scene::SelectActorById(GUID id, bool clearAll)
@@ -789,18 +829,17 @@ namespace UltraEd
         if (IsActorSelected(id))
         {
             // Unselect actor when already selected and clicked on again.
-            auto it = std::find(m_selectedActorIds.begin(), m_selectedActorIds.end(), id);
-            m_selectedActorIds.erase(it);
+            m_actors.SetSelected(id, false);
 
             // Select previous selected actor if any available.
-            if (!m_selectedActorIds.empty())
-                m_gizmo.Update(m_actors[m_selectedActorIds.back()].get());
+            if (m_actors.HasSelection())
+                m_gizmo.Update(m_actors.GetLastSelected());
         }
         else
         {
             // Add to selection and move gizmo to its location.
-            m_selectedActorIds.push_back(id);
-            m_gizmo.Update(m_actors[id].get());
+            m_actors.SetSelected(id, true);
+            m_gizmo.Update(GetActor(id).get());
         }
     }
 
@@ -809,13 +848,13 @@ namespace UltraEd
         UnselectAll();
         for (const auto &actor : m_actors)
         {
-            SelectActorById(actor.first, false);
+            SelectActorById(actor->GetId(), false);
         }
     }
 
     void Scene::UnselectAll()
     {
-        m_selectedActorIds.clear();
+        m_actors.ClearSelection();
     }
 
     void Scene::SetTitle(std::string title, bool store)
@@ -890,7 +929,7 @@ namespace UltraEd
         cJSON_AddItemToObject(scene, "actors", actorArray);
         for (const auto &actor : m_actors)
         {
-            cJSON_AddItemToArray(actorArray, actor.second->Save());
+            cJSON_AddItemToArray(actorArray, actor->Save());
         }
 
         PartialSave(scene);
@@ -915,6 +954,9 @@ namespace UltraEd
         sprintf(buffer, "%f", m_gizmo.GetSnapSize());
         cJSON_AddStringToObject(scene, "gizmo_snap_size", buffer);
 
+        sprintf(buffer, "%i", m_tickRate);
+        cJSON_AddStringToObject(scene, "tick_rate", buffer);
+
         return scene;
     }
 
@@ -935,13 +977,8 @@ namespace UltraEd
         sscanf(activeView->valuestring, "%i", &viewType);
         SetViewType(viewType);
 
-        // Restore saved actors.
-        cJSON *actors = cJSON_GetObjectItem(root, "actors");
-        cJSON *actor = NULL;
-        cJSON_ArrayForEach(actor, actors)
-        {
-            RestoreActor(actor);
-        }
+        // Saved actors join the scene as their meshes finish importing in the background.
+        m_loader.Start(cJSON_GetObjectItem(root, "actors"));
 
         PartialLoad(root);
 
@@ -961,6 +998,11 @@ namespace UltraEd
         sscanf(gizmoSnapSize->valuestring, "%f", &snapSize);
         m_gizmo.SetSnapSize(snapSize);
 
+        // Scenes saved before the fixed tick keep the default rate.
+        m_tickRate = DefaultTickRate;
+        cJSON *tickRate = cJSON_GetObjectItem(root, "tick_rate");
+        if (tickRate != NULL) sscanf(tickRate->valuestring, "%i", &m_tickRate);
+
         return true;
     }
 
@@ -974,16 +1016,33 @@ namespace UltraEd
             {
                 auto model = existingActor ? std::static_pointer_cast<Model>(existingActor) : std::make_shared<Model>();
                 model->Load(item, m_device);
-                if (!existingActor) m_actors[model->GetId()] = model;
+                if (!existingActor) m_actors.Add(model);
                 break;
             }
             case ActorType::Camera:
             {
                 auto camera = existingActor ? std::static_pointer_cast<Camera>(existingActor) : std::make_shared<Camera>();
                 camera->Load(item);
-                if (!existingActor) m_actors[camera->GetId()] = camera;
+                if (!existingActor) m_actors.Add(camera);
                 break;
             }
         }
     }
+
+    void Scene::RestoreLoadedActors(bool wait)
+    {
+        // Saving and building need every actor so those wait for the rest to load.
+        if (wait) m_loader.Finish();
+
+        while (cJSON *item = m_loader.Next())
+        {
+            RestoreActor(item);
+            cJSON_Delete(item);
+        }
+
+        for (const auto &log : m_loader.TakeLogs())
+        {
+            Debug::Info(log);
+        }
+    }
 }
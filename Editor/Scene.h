@@ -14,6 +14,9 @@
 #include "Model.h"
 #include "Camera.h"
 #include "Auditor.h"
+#include "ActorRegistry.h"
+#include "SceneTree.h"
+#include "ActorLoader.h"
 
 namespace UltraEd
 {
@@ -31,8 +34,10 @@ namespace UltraEd
         ~Scene();
         bool Create(HWND hWnd);
         bool Confirm();
-        std::vector<Actor *> GetActors(bool selectedOnly = false);
+        const std::vector<Actor *> &GetActors();
+        std::vector<Actor *> GetSelectedActors();
         COLORREF GetBackgroundColor();
+        int GetTickRate();
         HWND GetWndHandle();
         void Render();
         cJSON *Save();
@@ -41,6 +46,7 @@ namespace UltraEd
         void UnselectAll();
         std::shared_ptr<Actor> GetActor(GUID id);
         void RestoreActor(cJSON *item);
+        void RestoreLoadedActors(bool wait = false);
         void Delete(std::shared_ptr<Actor> actor);
         void SelectActorById(GUID id, bool clearAll = true);
      
@@ -52,6 +58,7 @@ namespace UltraEd
         std::string GetScript();
         void SetBackgroundColor(COLORREF color);
         void SetGizmoSnapSize(float size);
+        void SetTickRate(int rate);
         void Resize(int width, int height);
         void OnNew(bool confirm = true);
         bool OnSave();
@@ -90,13 +97,15 @@ namespace UltraEd
         IDirect3DDevice9 *m_device;
         IDirect3D9 *m_d3d9;
         D3DPRESENT_PARAMETERS m_d3dpp;
-        std::map<GUID, std::shared_ptr<Actor>> m_actors;
+        ActorRegistry m_actors;
+        SceneTree m_sceneTree;
+        ActorLoader m_loader;
         Grid m_grid;
-        std::vector<GUID> m_selectedActorIds;
         float m_mouseSmoothX, m_mouseSmoothY;
         ViewType m_activeViewType;
         std::string m_sceneName;
         std::array<int, 3> m_backgroundColorRGB;
+        int m_tickRate;
         Auditor m_auditor;
         std::unique_ptr<Gui> m_gui;
     };
@@ -0,0 +1,262 @@
+#include <cfloat>
+#include "SceneTree.h"
+#include "MeshTree.h"
+
+namespace UltraEd
+{
+    SceneTree::SceneTree() :
+        m_nodes(),
+        m_freeNodes(),
+        m_leaves(),
+        m_root(-1)
+    { }
+
+    void SceneTree::Update(ActorRegistry &actors)
+    {
+        // Leaves share the actors' slots. A dirty slot's leaf is taken out and whatever actor
+        // holds the slot now goes back in with its new bounds.
+        for (unsigned int slot : actors.TakeDirtySlots())
+        {
+            if (slot >= m_leaves.size()) m_leaves.resize(slot + 1, -1);
+
+            int &leaf = m_leaves[slot];
+            if (leaf >= 0)
+            {
+                RemoveLeaf(leaf);
+                FreeNode(leaf);
+                leaf = -1;
+            }
+
+            // Actors without a mesh can't be picked so they stay out of the tree.
+            Actor *actor = actors.GetInSlot(slot);
+            D3DXVECTOR3 min, max;
+            if (actor == NULL || !actor->GetWorldBounds(&min, &max)) continue;
+
+            leaf = AllocateNode();
+            m_nodes[leaf] = { min, max, -1, -1, -1, 0, actor };
+            InsertLeaf(leaf);
+        }
+    }
+
+    Actor *SceneTree::Pick(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, float *dist)
+    {
+        struct Visit
+        {
+            int node;
+            float entry;
+        };
+
+        if (m_root < 0) return NULL;
+
+        D3DXVECTOR3 invDir = MeshTree::InverseDirection(dir);
+        float nearest = FLT_MAX, entry;
+        Actor *closest = NULL;
+
+        if (!MeshTree::IntersectBounds(m_nodes[m_root].min, m_nodes[m_root].max, orig, invDir, nearest, &entry))
+            return NULL;
+
+        // Balancing keeps the depth near the log of the actor count but it isn't fixed like a mesh tree's.
+        std::vector<Visit> stack;
+        stack.push_back({ m_root, entry });
+
+        while (!stack.empty())
+        {
+            Visit visit = stack.back();
+            stack.pop_back();
+            if (visit.entry > nearest) continue;
+
+            const Node &node = m_nodes[visit.node];
+            if (node.actor != NULL)
+            {
+                float hit;
+                if (node.actor->Pick(orig, dir, &hit) && hit < nearest)
+                {
+                    nearest = hit;
+                    closest = node.actor;
+                }
+                continue;
+            }
+
+            // The nearer child goes on top so its hits can cull the farther one.
+            Visit first = { node.left, 0 }, second = { node.right, 0 };
+            const Node &firstNode = m_nodes[first.node], &secondNode = m_nodes[second.node];
+            bool hitFirst = MeshTree::IntersectBounds(firstNode.min, firstNode.max, orig, invDir, nearest, &first.entry);
+            bool hitSecond = MeshTree::IntersectBounds(secondNode.min, secondNode.max, orig, invDir, nearest,
+                &second.entry);
+
+            if (hitFirst && hitSecond && second.entry < first.entry) std::swap(first, second);
+            if (hitSecond) stack.push_back(second);
+            if (hitFirst) stack.push_back(first);
+        }
+
+        if (closest != NULL) *dist = nearest;
+        return closest;
+    }
+
+    int SceneTree::AllocateNode()
+    {
+        if (m_freeNodes.empty())
+        {
+            m_nodes.push_back(Node());
+            return static_cast<int>(m_nodes.size()) - 1;
+        }
+
+        int index = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        return index;
+    }
+
+    void SceneTree::FreeNode(int index)
+    {
+        m_nodes[index].actor = NULL;
+        m_freeNodes.push_back(index);
+    }
+
+    void SceneTree::InsertLeaf(int leaf)
+    {
+        if (m_root < 0)
+        {
+            m_root = leaf;
+            m_nodes[leaf].parent = -1;
+            return;
+        }
+
+        // Walk toward the child whose bounds grow the least and stop where pairing with the
+        // node itself is cheaper, going by surface area.
+        const D3DXVECTOR3 leafMin = m_nodes[leaf].min, leafMax = m_nodes[leaf].max;
+        int index = m_root;
+        while (m_nodes[index].actor == NULL)
+        {
+            const Node &node = m_nodes[index];
+            D3DXVECTOR3 unionMin, unionMax;
+            D3DXVec3Minimize(&unionMin, &node.min, &leafMin);
+            D3DXVec3Maximize(&unionMax, &node.max, &leafMax);
+
+            float combined = Area(unionMin, unionMax);
+            float cost = 2 * combined;
+            float inherited = 2 * (combined - Area(node.min, node.max));
+
+            int children[2] = { node.left, node.right };
+            float childCost[2];
+            for (int i = 0; i < 2; i++)
+            {
+                const Node &child = m_nodes[children[i]];
+                D3DXVec3Minimize(&unionMin, &child.min, &leafMin);
+                D3DXVec3Maximize(&unionMax, &child.max, &leafMax);
+                float grown = Area(unionMin, unionMax);
+                childCost[i] = (child.actor != NULL ? grown : grown - Area(child.min, child.max)) + inherited;
+            }
+
+            if (cost < childCost[0] && cost < childCost[1]) break;
+            index = childCost[0] < childCost[1] ? children[0] : children[1];
+        }
+
+        int sibling = index;
+        int oldParent = m_nodes[sibling].parent;
+        int parent = AllocateNode();
+        m_nodes[parent] = { leafMin, leafMax, oldParent, sibling, leaf, 1, NULL };
+        m_nodes[sibling].parent = parent;
+        m_nodes[leaf].parent = parent;
+
+        if (oldParent < 0)
+            m_root = parent;
+        else if (m_nodes[oldParent].left == sibling)
+            m_nodes[oldParent].left = parent;
+        else
+            m_nodes[oldParent].right = parent;
+
+        Refit(parent);
+    }
+
+    void SceneTree::RemoveLeaf(int leaf)
+    {
+        if (leaf == m_root)
+        {
+            m_root = -1;
+            return;
+        }
+
+        int parent = m_nodes[leaf].parent;
+        int grandParent = m_nodes[parent].parent;
+        int sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+        // The sibling takes its parent's place.
+        m_nodes[sibling].parent = grandParent;
+        if (grandParent < 0)
+        {
+            m_root = sibling;
+        }
+        else
+        {
+            if (m_nodes[grandParent].left == parent)
+                m_nodes[grandParent].left = sibling;
+            else
+                m_nodes[grandParent].right = sibling;
+
+            Refit(grandParent);
+        }
+
+        FreeNode(parent);
+    }
+
+    void SceneTree::Refit(int index)
+    {
+        for (; index >= 0; index = m_nodes[index].parent)
+        {
+            index = Balance(index);
+            Combine(index);
+        }
+    }
+
+    int SceneTree::Balance(int index)
+    {
+        Node &node = m_nodes[index];
+        if (node.actor != NULL || node.height < 2) return index;
+
+        // Lift the taller child's taller child up in place of the node, which takes the other one.
+        int left = node.left, right = node.right;
+        int balance = m_nodes[right].height - m_nodes[left].height;
+        if (balance >= -1 && balance <= 1) return index;
+
+        int raised = balance > 1 ? right : left;
+        int kept = balance > 1 ? left : right;
+        int higher = m_nodes[raised].left, lower = m_nodes[raised].right;
+        if (m_nodes[higher].height < m_nodes[lower].height) std::swap(higher, lower);
+
+        int parent = node.parent;
+        m_nodes[raised].parent = parent;
+        if (parent < 0)
+            m_root = raised;
+        else if (m_nodes[parent].left == index)
+            m_nodes[parent].left = raised;
+        else
+            m_nodes[parent].right = raised;
+
+        node.left = kept;
+        node.right = lower;
+        node.parent = raised;
+        m_nodes[lower].parent = index;
+        Combine(index);
+
+        m_nodes[raised].left = index;
+        m_nodes[raised].right = higher;
+        Combine(raised);
+
+        return raised;
+    }
+
+    void SceneTree::Combine(int index)
+    {
+        Node &node = m_nodes[index];
+        const Node &left = m_nodes[node.left], &right = m_nodes[node.right];
+        D3DXVec3Minimize(&node.min, &left.min, &right.min);
+        D3DXVec3Maximize(&node.max, &left.max, &right.max);
+        node.height = 1 + (left.height > right.height ? left.height : right.height);
+    }
+
+    float SceneTree::Area(const D3DXVECTOR3 &min, const D3DXVECTOR3 &max)
+    {
+        D3DXVECTOR3 size = max - min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef _SCENETREE_H_
+#define _SCENETREE_H_
+
+#include <vector>
+#include "Common.h"
+#include "ActorRegistry.h"
+
+namespace UltraEd
+{
+    // Dynamic bounding volume hierarchy over the world bounds of a scene's actors. Only
+    // actors the registry marked as added, removed or transformed are touched on update and
+    // rotations keep the tree balanced as they move.
+    class SceneTree
+    {
+    public:
+        SceneTree();
+        void Update(ActorRegistry &actors);
+        Actor *Pick(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir, float *dist);
+
+    private:
+        struct Node
+        {
+            D3DXVECTOR3 min, max;
+            int parent, left, right, height;
+            Actor *actor;
+        };
+
+        int AllocateNode();
+        void FreeNode(int index);
+        void InsertLeaf(int leaf);
+        void RemoveLeaf(int leaf);
+        void Refit(int index);
+        int Balance(int index);
+        void Combine(int index);
+        static float Area(const D3DXVECTOR3 &min, const D3DXVECTOR3 &max);
+
+    private:
+        std::vector<Node> m_nodes;
+        std::vector<int> m_freeNodes;
+        std::vector<int> m_leaves;
+        int m_root;
+    };
+}
+
+#endif
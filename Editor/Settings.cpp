@@ -47,4 +47,19 @@ namespace UltraEd
         }
         return ColorTheme::Light;
     }
+
+    void Settings::SetProfileScripts(bool enabled)
+    {
+        Registry::Set("ProfileScripts", std::to_string(static_cast<int>(enabled)));
+    }
+
+    bool Settings::GetProfileScripts()
+    {
+        std::string enabled;
+        if (Registry::Get("ProfileScripts", enabled))
+        {
+            return atoi(enabled.c_str()) != 0;
+        }
+        return false;
+    }
 }
@@ -18,6 +18,7 @@ namespace UltraEd
 
     void SphereCollider::Build()
     {
+        m_vertexVersion++;
         const int segments = 32;
         const float sample = (2 * D3DX_PI) / segments;
 
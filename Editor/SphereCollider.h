@@ -11,6 +11,7 @@ namespace UltraEd
         SphereCollider();
         SphereCollider(const std::vector<Vertex> &vertices);
         void Build();
+        Collider *Clone() { return new SphereCollider(*this); }
         FLOAT GetRadius() { return m_radius; }
         cJSON *Save();
         bool Load(cJSON *root);
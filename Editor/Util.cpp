@@ -158,6 +158,40 @@ namespace UltraEd
         return ret;
     }
 
+    std::string Util::ReplaceToken(const std::string &str, const std::string &token, const std::string &to)
+    {
+        // Only whole identifiers are replaced and string literals are left alone.
+        auto isIdentifier = [](char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+        std::string result;
+        size_t i = 0;
+
+        while (i < str.size())
+        {
+            if (str[i] == '"')
+            {
+                size_t end = i + 1;
+                while (end < str.size() && str[end] != '"') end += str[end] == '\\' ? 2 : 1;
+                if (end < str.size()) end++;
+                result.append(str, i, end - i);
+                i = end;
+            }
+            else if (isIdentifier(str[i]))
+            {
+                size_t end = i;
+                while (end < str.size() && isIdentifier(str[end])) end++;
+                if (str.compare(i, end - i, token) == 0) result.append(to);
+                else result.append(str, i, end - i);
+                i = end;
+            }
+            else
+            {
+                result.push_back(str[i++]);
+            }
+        }
+
+        return result;
+    }
+
     std::vector<std::string> Util::SplitString(const char *str, const char delimiter)
     {
         std::vector<std::string> tokens;
@@ -179,4 +213,24 @@ namespace UltraEd
             position[2] = vec.z;
         }
     }
+
+    void Util::WriteShort(std::vector<unsigned char> &data, unsigned short value)
+    {
+        // The N64 is big endian.
+        data.push_back(static_cast<unsigned char>(value >> 8));
+        data.push_back(static_cast<unsigned char>(value & 0xFF));
+    }
+
+    void Util::WriteFloat(std::vector<unsigned char> &data, float value)
+    {
+        unsigned int bits;
+        memcpy(&bits, &value, sizeof(bits));
+        WriteShort(data, static_cast<unsigned short>(bits >> 16));
+        WriteShort(data, static_cast<unsigned short>(bits & 0xFFFF));
+    }
+
+    unsigned short Util::ReadShort(const unsigned char *data)
+    {
+        return static_cast<unsigned short>(data[0] << 8 | data[1]);
+    }
 }
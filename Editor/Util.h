@@ -22,8 +22,12 @@ namespace UltraEd
         static std::string RootPath();
         static std::string NewResourceName(int count);
         static char *ReplaceString(const char *str, const char *from, const char *to);
+        static std::string ReplaceToken(const std::string &str, const std::string &token, const std::string &to);
         static std::vector<std::string> SplitString(const char *str, const char delimiter);
         static void ToFloat3(const D3DXVECTOR3 &vec, float *position);
+        static void WriteShort(std::vector<unsigned char> &data, unsigned short value);
+        static void WriteFloat(std::vector<unsigned char> &data, float value);
+        static unsigned short ReadShort(const unsigned char *data);
 
     private:
         Util() {};
@@ -2,15 +2,24 @@
 
 namespace UltraEd
 {
-    VertexBuffer::VertexBuffer() : m_vertexBuffer() { }
+    unsigned int VertexBuffer::m_uploadCount = 0;
+    size_t VertexBuffer::m_uploadBytes = 0;
+
+    VertexBuffer::VertexBuffer() : m_vertexBuffer(), m_capacity(0), m_version(0) { }
 
     VertexBuffer::~VertexBuffer()
     {
         Release();
     }
 
-    IDirect3DVertexBuffer9 *VertexBuffer::GetBuffer(IDirect3DDevice9 *device, std::vector<Vertex> vertices)
+    IDirect3DVertexBuffer9 *VertexBuffer::GetBuffer(IDirect3DDevice9 *device, const std::vector<Vertex> &vertices,
+        unsigned int version)
     {
+        if (vertices.empty()) return NULL;
+
+        // Vertices that outgrew the buffer need a bigger one, smaller sets reuse it.
+        if (m_vertexBuffer != NULL && vertices.size() > m_capacity) Release();
+
         if (m_vertexBuffer == NULL)
         {
             if (FAILED(device->CreateVertexBuffer(
@@ -23,25 +32,50 @@ namespace UltraEd
                 return NULL;
             }
 
-            void *pVertices;
-            if (FAILED(m_vertexBuffer->Lock(0, (UINT)vertices.size() * sizeof(Vertex), &pVertices, 0)))
+            m_capacity = vertices.size();
+            if (!Upload(vertices))
             {
+                Release();
                 return NULL;
             }
 
-            memcpy(pVertices, &vertices[0], vertices.size() * sizeof(Vertex));
-            m_vertexBuffer->Unlock();
+            m_version = version;
+        }
+        else if (m_version != version)
+        {
+            // Owners bump their version when they rebuild their vertices so unchanged ones
+            // are only read by the GPU.
+            if (!Upload(vertices)) return NULL;
+            m_version = version;
         }
 
         return m_vertexBuffer;
     }
 
+    bool VertexBuffer::Upload(const std::vector<Vertex> &vertices)
+    {
+        void *pVertices;
+        UINT size = (UINT)vertices.size() * sizeof(Vertex);
+        if (FAILED(m_vertexBuffer->Lock(0, size, &pVertices, 0)))
+        {
+            return false;
+        }
+
+        memcpy(pVertices, &vertices[0], size);
+        m_vertexBuffer->Unlock();
+
+        m_uploadCount++;
+        m_uploadBytes += size;
+        return true;
+    }
+
     void VertexBuffer::Release()
     {
         if (m_vertexBuffer != NULL)
         {
             m_vertexBuffer->Release();
             m_vertexBuffer = 0;
+            m_capacity = 0;
         }
     }
 }
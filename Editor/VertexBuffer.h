@@ -11,11 +11,21 @@ namespace UltraEd
     public:
         VertexBuffer();
         ~VertexBuffer();
-        IDirect3DVertexBuffer9 *GetBuffer(IDirect3DDevice9 *device, std::vector<Vertex> vertices);
+        IDirect3DVertexBuffer9 *GetBuffer(IDirect3DDevice9 *device, const std::vector<Vertex> &vertices,
+            unsigned int version = 0);
         void Release();
+        static unsigned int GetUploadCount() { return m_uploadCount; }
+        static size_t GetUploadBytes() { return m_uploadBytes; }
+
+    private:
+        bool Upload(const std::vector<Vertex> &vertices);
 
     private:
         IDirect3DVertexBuffer9 *m_vertexBuffer;
+        size_t m_capacity;
+        unsigned int m_version;
+        static unsigned int m_uploadCount;
+        static size_t m_uploadBytes;
     };
 }
 
@@ -1,84 +1,441 @@
 #include <nusys.h>
-#include <malloc.h>
 #include <string.h>
 #include <stdio.h>
 #include "upng.h"
 #include "actor.h"
 #include "utilities.h"
+#include "arena.h"
+#include "stream.h"
+
+typedef struct shared_asset
+{
+    void *segment;
+    int width;
+    int height;
+    void *data;
+    int size;
+    int references;
+    int ready;
+    // Written by the stream thread and only read once the game thread hears it's done.
+    int decodedSize;
+    struct shared_asset *next;
+} shared_asset;
+
+typedef struct streamed_model
+{
+    actor *model;
+    shared_asset *meshAsset;
+    shared_asset *textureAsset;
+    struct streamed_model *next;
+} streamed_model;
+
+static shared_asset *mesh_assets = NULL;
+static shared_asset *texture_assets = NULL;
+static streamed_model *streamed_models = NULL;
+static asset_stats assets;
+static float interpolation = 1.0f;
+
+static actor *create_model(void *dataStart, void *dataEnd, void *textureStart, void *textureEnd,
+    int textureWidth, int textureHeight, double positionX, double positionY, double positionZ, double rotX,
+    double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ,
+    double centerX, double centerY, double centerZ, double radius,
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger, int stream);
 
 actor *loadModel(void *dataStart, void *dataEnd, double positionX, double positionY, double positionZ,
-    double rotX, double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ, 
+    double rotX, double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ,
     double centerX, double centerY, double centerZ, double radius,
-    double extentX, double extentY, double extentZ, enum colliderType collider)
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger)
 {
-    return loadTexturedModel(dataStart, dataEnd,
-        NULL, NULL, 0, 0, positionX, positionY, positionZ, rotX, rotY, rotZ, angle, scaleX, scaleY, scaleZ, 
-        centerX, centerY, centerZ, radius, extentX, extentY, extentZ, collider);
+    return create_model(dataStart, dataEnd,
+        NULL, NULL, 0, 0, positionX, positionY, positionZ, rotX, rotY, rotZ, angle, scaleX, scaleY, scaleZ,
+        centerX, centerY, centerZ, radius, extentX, extentY, extentZ, collider, trigger, 0);
 }
 
 actor *loadTexturedModel(void *dataStart, void *dataEnd, void *textureStart, void *textureEnd,
-    int textureWidth, int textureHeight, double positionX, double positionY, double positionZ, double rotX, 
-    double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ, 
+    int textureWidth, int textureHeight, double positionX, double positionY, double positionZ, double rotX,
+    double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ,
+    double centerX, double centerY, double centerZ, double radius,
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger)
+{
+    return create_model(dataStart, dataEnd, textureStart, textureEnd, textureWidth, textureHeight,
+        positionX, positionY, positionZ, rotX, rotY, rotZ, angle, scaleX, scaleY, scaleZ,
+        centerX, centerY, centerZ, radius, extentX, extentY, extentZ, collider, trigger, 0);
+}
+
+actor *streamModel(void *dataStart, void *dataEnd, double positionX, double positionY, double positionZ,
+    double rotX, double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ,
+    double centerX, double centerY, double centerZ, double radius,
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger)
+{
+    return create_model(dataStart, dataEnd,
+        NULL, NULL, 0, 0, positionX, positionY, positionZ, rotX, rotY, rotZ, angle, scaleX, scaleY, scaleZ,
+        centerX, centerY, centerZ, radius, extentX, extentY, extentZ, collider, trigger, 1);
+}
+
+actor *streamTexturedModel(void *dataStart, void *dataEnd, void *textureStart, void *textureEnd,
+    int textureWidth, int textureHeight, double positionX, double positionY, double positionZ, double rotX,
+    double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ,
     double centerX, double centerY, double centerZ, double radius,
-    double extentX, double extentY, double extentZ, enum colliderType collider)
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger)
+{
+    return create_model(dataStart, dataEnd, textureStart, textureEnd, textureWidth, textureHeight,
+        positionX, positionY, positionZ, rotX, rotY, rotZ, angle, scaleX, scaleY, scaleZ,
+        centerX, centerY, centerZ, radius, extentX, extentY, extentZ, collider, trigger, 1);
+}
+
+void asset_cache_reset()
+{
+    // Records live in the level arena so forgetting them is all a reset needs.
+    mesh_assets = NULL;
+    texture_assets = NULL;
+    streamed_models = NULL;
+    memset(&assets, 0, sizeof(assets));
+}
+
+asset_stats asset_get_stats()
+{
+    return assets;
+}
+
+static shared_asset *acquire_asset(shared_asset *list, void *segment, int width, int height)
+{
+    // Texture coordinates are baked for the texture size so it's part of the key.
+    for (shared_asset *asset = list; asset != NULL; asset = asset->next)
+    {
+        if (asset->segment == segment && asset->width == width && asset->height == height)
+        {
+            asset->references++;
+            assets.references++;
+            assets.bytesShared += asset->size;
+            return asset;
+        }
+    }
+
+    return NULL;
+}
+
+static shared_asset *add_asset(shared_asset **list, void *segment, int width, int height, void *data,
+    enum memoryCategory category)
+{
+    shared_asset *asset = (shared_asset *)level_alloc(sizeof(shared_asset), category);
+    if (asset == NULL) return NULL;
+
+    asset->segment = segment;
+    asset->width = width;
+    asset->height = height;
+    asset->data = data;
+    asset->size = 0;
+    asset->references = 1;
+    asset->ready = 0;
+    asset->decodedSize = 0;
+    asset->next = *list;
+    *list = asset;
+
+    assets.references++;
+    return asset;
+}
+
+static void finish_asset(shared_asset *asset, int size)
+{
+    // Actors that shared the asset while it was still loading are counted now.
+    asset->size = size;
+    asset->ready = 1;
+    assets.bytesLoaded += size;
+    assets.bytesShared += (asset->references - 1) * size;
+}
+
+static void release_asset(shared_asset *list, void *data)
+{
+    for (shared_asset *asset = list; asset != NULL; asset = asset->next)
+    {
+        if (asset->data == data && asset->references > 0)
+        {
+            asset->references--;
+            assets.references--;
+            return;
+        }
+    }
+}
+
+static char *next_line(char **cursor)
+{
+    // Unlike strtok this keeps no state of its own so both threads can parse at once.
+    char *line = *cursor;
+    char *end = strchr(line, '\n');
+
+    if (end != NULL)
+    {
+        *end = '\0';
+        *cursor = end + 1;
+    }
+    else *cursor = line + strlen(line);
+
+    return line;
+}
+
+static void parse_mesh(mesh *newMesh, char *dataBuffer, int textureWidth, int textureHeight)
+{
+    // Read how many vertices for this mesh.
+    int vertexCount = 0;
+    char *cursor = dataBuffer;
+    char *line = next_line(&cursor);
+    sscanf(line, "%i", &vertexCount);
+    newMesh->vertices = (Vtx*)level_alloc(vertexCount * sizeof(Vtx), MemoryMesh);
+    if (newMesh->vertices == NULL) return;
+
+    // Gather all of the X, Y, and Z vertex info. Scale is left to the model matrix so
+    // every actor using this segment can share the vertices.
+    for (int i = 0; i < vertexCount; i++)
+    {
+        double x, y, z, r, g, b, a, s, t;
+        line = next_line(&cursor);
+        sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %lf %lf", &x, &y, &z, &r, &g, &b, &a, &s, &t);
+
+        newMesh->vertices[i].v.ob[0] = x * 100;
+        newMesh->vertices[i].v.ob[1] = y * 100;
+        newMesh->vertices[i].v.ob[2] = -z * 100;
+        newMesh->vertices[i].v.flag = 0;
+        newMesh->vertices[i].v.tc[0] = (int)(s * textureWidth) << 5;
+        newMesh->vertices[i].v.tc[1] = (int)(t * textureHeight) << 5;
+        newMesh->vertices[i].v.cn[0] = r * 255;
+        newMesh->vertices[i].v.cn[1] = g * 255;
+        newMesh->vertices[i].v.cn[2] = b * 255;
+        newMesh->vertices[i].v.cn[3] = a * 255;
+    }
+
+    // Set last so actors sharing a mesh that is still streaming never draw a partial one.
+    newMesh->vertexCount = vertexCount;
+}
+
+static int decode_texture(unsigned char *textureBuffer, int textureSize, int textureWidth, int textureHeight,
+    unsigned short *texture)
+{
+    int decoded = 0;
+
+    // Decode the png texture data straight into RGB5551 without a 24bpp copy.
+    upng_t *png = upng_new_from_bytes(textureBuffer, textureSize);
+    if (png != NULL)
+    {
+        upng_header(png);
+        if (upng_get_error(png) == UPNG_EOK && upng_get_width(png) == (unsigned)textureWidth
+            && upng_get_height(png) == (unsigned)textureHeight)
+        {
+            decoded = upng_decode_rgba5551(png, texture) == UPNG_EOK;
+        }
+        upng_free(png);
+    }
+
+    return decoded;
+}
+
+static int decode_mesh(shared_asset *asset, char *dataBuffer, int dataSize)
+{
+    mesh *newMesh = (mesh*)asset->data;
+
+    // Streamed buffers come back without a terminator.
+    dataBuffer[dataSize] = '\0';
+    parse_mesh(newMesh, dataBuffer, asset->width, asset->height);
+    return sizeof(mesh) + newMesh->vertexCount * sizeof(Vtx);
+}
+
+static int decode_texture_asset(shared_asset *asset, unsigned char *textureBuffer, int textureSize)
+{
+    if (!decode_texture(textureBuffer, textureSize, asset->width, asset->height, (unsigned short*)asset->data))
+        return -1;
+
+    return asset->width * asset->height * sizeof(unsigned short);
+}
+
+static void finish_texture(shared_asset *asset, int size)
+{
+    // A failed decode leaves its pixels in the level arena until the next level reset.
+    if (size < 0)
+    {
+        asset->data = NULL;
+        size = 0;
+    }
+
+    finish_asset(asset, size);
+}
+
+static void reveal_streamed_models()
+{
+    streamed_model **link = &streamed_models;
+
+    while (*link != NULL)
+    {
+        streamed_model *pending = *link;
+        if (!pending->meshAsset->ready || (pending->textureAsset != NULL && !pending->textureAsset->ready))
+        {
+            link = &pending->next;
+            continue;
+        }
+
+        if (pending->textureAsset != NULL) pending->model->texture = (unsigned short*)pending->textureAsset->data;
+        pending->model->loading = 0;
+        *link = pending->next;
+    }
+}
+
+// Parsing and decoding run on the stream thread so the game thread only marks the asset ready.
+static void mesh_decode(void *destination, int size, void *data)
+{
+    shared_asset *asset = (shared_asset*)data;
+    asset->decodedSize = decode_mesh(asset, (char*)destination, size);
+}
+
+static void texture_decode(void *destination, int size, void *data)
+{
+    shared_asset *asset = (shared_asset*)data;
+    asset->decodedSize = decode_texture_asset(asset, (unsigned char*)destination, size);
+}
+
+static void mesh_streamed(void *destination, int size, void *data)
+{
+    shared_asset *asset = (shared_asset*)data;
+    finish_asset(asset, asset->decodedSize);
+    heap_free(destination);
+    reveal_streamed_models();
+}
+
+static void texture_streamed(void *destination, int size, void *data)
+{
+    shared_asset *asset = (shared_asset*)data;
+    finish_texture(asset, asset->decodedSize);
+    heap_free(destination);
+    reveal_streamed_models();
+}
+
+static shared_asset *load_mesh(void *dataStart, void *dataEnd, int textureWidth, int textureHeight, int stream)
 {
     unsigned char dataBuffer[200000];
-    unsigned char textureBuffer[20000];
     int dataSize = dataEnd - dataStart;
-    int textureSize = textureEnd - textureStart;
-    actor *newModel;
 
-    // Transfer from ROM the model mesh data and texture.
+    // Actors built from the same segments share one copy. Only transfer from ROM
+    // and decode what hasn't been loaded yet.
+    shared_asset *asset = acquire_asset(mesh_assets, dataStart, textureWidth, textureHeight);
+    if (asset != NULL) return asset;
+
+    mesh *newMesh = (mesh*)level_alloc(sizeof(mesh), MemoryMesh);
+    if (newMesh == NULL) return NULL;
+    newMesh->vertexCount = 0;
+    newMesh->vertices = NULL;
+
+    asset = add_asset(&mesh_assets, dataStart, textureWidth, textureHeight, newMesh, MemoryMesh);
+    if (asset == NULL) return NULL;
+
+    // Streamed data waits on the heap while the stream thread parses it. Room is left for
+    // the terminator and the padding byte of odd sized transfers.
+    if (stream)
+    {
+        char *staging = (char*)heap_alloc(dataSize + 2, MemoryMesh);
+        if (staging != NULL && stream_request_process(dataStart, dataEnd, staging, mesh_decode, mesh_streamed, asset))
+            return asset;
+
+        // Fall back to a blocking load when the heap or the stream queue is full.
+        heap_free(staging);
+        assets.blockingLoads++;
+    }
+
     rom_2_ram(dataStart, dataBuffer, dataSize);
+    finish_asset(asset, decode_mesh(asset, (char*)dataBuffer, dataSize));
+    return asset;
+}
+
+static shared_asset *load_texture(void *textureStart, void *textureEnd, int textureWidth, int textureHeight, int stream)
+{
+    unsigned char textureBuffer[20000];
+    int textureSize = textureEnd - textureStart;
+    int size = textureWidth * textureHeight * sizeof(unsigned short);
+
+    shared_asset *asset = acquire_asset(texture_assets, textureStart, textureWidth, textureHeight);
+    if (asset != NULL) return asset;
+
+    unsigned short *texture = (unsigned short*)level_alloc(size, MemoryTexture);
+    if (texture == NULL) return NULL;
+
+    asset = add_asset(&texture_assets, textureStart, textureWidth, textureHeight, texture, MemoryTexture);
+    if (asset == NULL) return NULL;
+
+    if (stream)
+    {
+        unsigned char *staging = (unsigned char*)heap_alloc(textureSize + 1, MemoryTexture);
+        if (staging != NULL)
+        {
+            // Actors sharing it before it lands draw black rather than stale memory. Cleared
+            // before the request since the stream thread may decode into it straight away.
+            memset(texture, 0, size);
+            if (stream_request_process(textureStart, textureEnd, staging, texture_decode, texture_streamed, asset))
+                return asset;
+        }
+
+        heap_free(staging);
+        assets.blockingLoads++;
+    }
+
     rom_2_ram(textureStart, textureBuffer, textureSize);
+    finish_texture(asset, decode_texture_asset(asset, textureBuffer, textureSize));
+    return asset;
+}
 
-    newModel = (actor*)malloc(sizeof(actor));
-    newModel->mesh = (mesh*)malloc(sizeof(mesh));
-    newModel->position = (vector3*)malloc(sizeof(vector3));
-    newModel->rotationAxis = (vector3*)malloc(sizeof(vector3));
-    newModel->scale = (vector3*)malloc(sizeof(vector3));
+static actor *create_model(void *dataStart, void *dataEnd, void *textureStart, void *textureEnd,
+    int textureWidth, int textureHeight, double positionX, double positionY, double positionZ, double rotX,
+    double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ,
+    double centerX, double centerY, double centerZ, double radius,
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger, int stream)
+{
+    actor *newModel;
+
+    newModel = (actor*)level_alloc(sizeof(actor), MemoryActor);
+    newModel->position = (vector3*)level_alloc(sizeof(vector3), MemoryActor);
+    newModel->rotationAxis = (vector3*)level_alloc(sizeof(vector3), MemoryActor);
+    newModel->scale = (vector3*)level_alloc(sizeof(vector3), MemoryActor);
     newModel->visible = 1;
+    newModel->loading = 0;
+    newModel->active = 1;
+    newModel->index = 0;
+    newModel->pool = NULL;
+    newModel->poolSlot = 0;
     newModel->type = Model;
     newModel->collider = collider;
+    newModel->trigger = trigger;
+    newModel->bvh = NULL;
+    newModel->mesh = NULL;
     newModel->texture = NULL;
     newModel->textureWidth = textureWidth;
     newModel->textureHeight = textureHeight;
 
-    newModel->center = (vector3*)malloc(sizeof(vector3));
+    newModel->center = (vector3*)level_alloc(sizeof(vector3), MemoryActor);
     newModel->center->x = centerX;
     newModel->center->y = centerY;
     newModel->center->z = centerZ;
     newModel->radius = radius;
 
-    newModel->extents = (vector3 *)malloc(sizeof(vector3));
+    newModel->extents = (vector3 *)level_alloc(sizeof(vector3), MemoryActor);
     newModel->extents->x = extentX;
     newModel->extents->y = extentY;
     newModel->extents->z = extentZ;
 
-    // Read how many vertices for this mesh.
-    int vertexCount = 0;
-    char *line = (char*)strtok(dataBuffer, "\n");
-    sscanf(line, "%i", &vertexCount);
-    newModel->mesh->vertices = (Vtx*)malloc(vertexCount * sizeof(Vtx));
-    newModel->mesh->vertexCount = vertexCount;
+    shared_asset *meshAsset = load_mesh(dataStart, dataEnd, textureWidth, textureHeight, stream);
+    shared_asset *textureAsset = textureStart != NULL ?
+        load_texture(textureStart, textureEnd, textureWidth, textureHeight, stream) : NULL;
 
-    // Gather all of the X, Y, and Z vertex info.
-    for (int i = 0; i < vertexCount; i++)
-    {
-        double x, y, z, r, g, b, a, s, t;
-        line = (char*)strtok(NULL, "\n");
-        sscanf(line, "%lf %lf %lf %lf %lf %lf %lf %lf %lf", &x, &y, &z, &r, &g, &b, &a, &s, &t);
+    if (meshAsset != NULL) newModel->mesh = (mesh*)meshAsset->data;
+    if (textureAsset != NULL) newModel->texture = (unsigned short*)textureAsset->data;
 
-        newModel->mesh->vertices[i].v.ob[0] = x * scaleX * 100;
-        newModel->mesh->vertices[i].v.ob[1] = y * scaleY * 100;
-        newModel->mesh->vertices[i].v.ob[2] = -z * scaleZ * 100;
-        newModel->mesh->vertices[i].v.flag = 0;
-        newModel->mesh->vertices[i].v.tc[0] = (int)(s * textureWidth) << 5;
-        newModel->mesh->vertices[i].v.tc[1] = (int)(t * textureHeight) << 5;
-        newModel->mesh->vertices[i].v.cn[0] = r * 255;
-        newModel->mesh->vertices[i].v.cn[1] = g * 255;
-        newModel->mesh->vertices[i].v.cn[2] = b * 255;
-        newModel->mesh->vertices[i].v.cn[3] = a * 255;
+    // Streamed models stay hidden until everything they draw with has arrived.
+    if (meshAsset != NULL && (!meshAsset->ready || (textureAsset != NULL && !textureAsset->ready)))
+    {
+        streamed_model *pending = (streamed_model*)level_alloc(sizeof(streamed_model), MemoryActor);
+        if (pending != NULL)
+        {
+            pending->model = newModel;
+            pending->meshAsset = meshAsset;
+            pending->textureAsset = textureAsset;
+            pending->next = streamed_models;
+            streamed_models = pending;
+            newModel->loading = 1;
+        }
     }
 
     // Entire axis can't be zero or it won't render.
@@ -87,42 +444,92 @@ actor *loadTexturedModel(void *dataStart, void *dataEnd, void *textureStart, voi
     newModel->position->x = positionX;
     newModel->position->y = positionY;
     newModel->position->z = -positionZ;
-    newModel->scale->x = 0.01;
-    newModel->scale->y = 0.01;
-    newModel->scale->z = 0.01;
+    newModel->scale->x = 0.01 * scaleX;
+    newModel->scale->y = 0.01 * scaleY;
+    newModel->scale->z = 0.01 * scaleZ;
     newModel->rotationAxis->x = rotX;
     newModel->rotationAxis->y = rotY;
     newModel->rotationAxis->z = -rotZ;
     newModel->rotationAngle = -angle;
+    actor_snapshot(newModel);
 
-    // Load in the png texture data.
-    upng_t *png = upng_new_from_bytes(textureBuffer, textureSize);
-    if (png != NULL)
+    return newModel;
+}
+
+void unloadModel(actor *model)
+{
+    // A model dropped while still streaming must not be revealed once its data lands.
+    for (streamed_model **link = &streamed_models; *link != NULL; link = &(*link)->next)
     {
-        upng_decode(png);
-        if (upng_get_error(png) == UPNG_EOK)
+        if ((*link)->model == model)
         {
-            // Convert texture data from 24bpp to 16bpp in RGB5551 format.
-            newModel->texture = image_24_to_16(upng_get_buffer(png), textureWidth, textureHeight);
+            *link = (*link)->next;
+            break;
         }
-        upng_free(png);
     }
 
-    return newModel;
+    // Shared data stays loaded for the rest of the level so only the references drop.
+    if (model->mesh != NULL) release_asset(mesh_assets, model->mesh);
+    if (model->texture != NULL) release_asset(texture_assets, model->texture);
+    model->visible = 0;
+}
+
+void actor_snapshot(actor *target)
+{
+    target->previousPosition = *target->position;
+    target->previousRotationAxis = *target->rotationAxis;
+    target->previousRotationAngle = target->rotationAngle;
+    if (target->scale != NULL) target->previousScale = *target->scale;
+}
+
+void actor_set_interpolation(float alpha)
+{
+    interpolation = alpha;
+}
+
+static double lerp(double from, double to, float alpha)
+{
+    return from + (to - from) * alpha;
+}
+
+void actor_interpolate(actor *target, vector3 *position, vector3 *rotationAxis, double *rotationAngle, vector3 *scale)
+{
+    position->x = lerp(target->previousPosition.x, target->position->x, interpolation);
+    position->y = lerp(target->previousPosition.y, target->position->y, interpolation);
+    position->z = lerp(target->previousPosition.z, target->position->z, interpolation);
+
+    rotationAxis->x = lerp(target->previousRotationAxis.x, target->rotationAxis->x, interpolation);
+    rotationAxis->y = lerp(target->previousRotationAxis.y, target->rotationAxis->y, interpolation);
+    rotationAxis->z = lerp(target->previousRotationAxis.z, target->rotationAxis->z, interpolation);
+
+    // Take the short way around when the angle wraps.
+    double turn = target->rotationAngle - target->previousRotationAngle;
+    if (turn > 180.0) turn -= 360.0;
+    else if (turn < -180.0) turn += 360.0;
+    *rotationAngle = target->previousRotationAngle + turn * interpolation;
+
+    if (scale != NULL)
+    {
+        scale->x = lerp(target->previousScale.x, target->scale->x, interpolation);
+        scale->y = lerp(target->previousScale.y, target->scale->y, interpolation);
+        scale->z = lerp(target->previousScale.z, target->scale->z, interpolation);
+    }
 }
 
 void modelDraw(actor *model, Gfx **displayList)
 {
-    if (!model->visible) return;
+    vector3 position, rotationAxis, scale;
+    double rotationAngle;
+
+    if (!model->visible || model->loading || model->mesh == NULL) return;
+
+    actor_interpolate(model, &position, &rotationAxis, &rotationAngle, &scale);
 
-    guTranslate(&model->transform.translation, model->position->x,
-        model->position->y, model->position->z);
+    guTranslate(&model->transform.translation, position.x, position.y, position.z);
 
-    guRotate(&model->transform.rotation, model->rotationAngle,
-        model->rotationAxis->x, model->rotationAxis->y, model->rotationAxis->z);
+    guRotate(&model->transform.rotation, rotationAngle, rotationAxis.x, rotationAxis.y, rotationAxis.z);
 
-    guScale(&model->transform.scale, model->scale->x,
-        model->scale->y, model->scale->z);
+    guScale(&model->transform.scale, scale.x, scale.y, scale.z);
 
     gSPMatrix((*displayList)++, OS_K0_TO_PHYSICAL(&model->transform.translation),
         G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_PUSH);
@@ -181,22 +588,30 @@ void modelDraw(actor *model, Gfx **displayList)
 actor *createCamera(double positionX, double positionY, double positionZ,
     double rotX, double rotY, double rotZ, double angle, 
     double centerX, double centerY, double centerZ, double radius,
-    double extentX, double extentY, double extentZ, enum colliderType collider)
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger)
 {
-    actor *camera = (actor*)malloc(sizeof(actor));
-    camera->position = (vector3*)malloc(sizeof(vector3));
-    camera->rotationAxis = (vector3*)malloc(sizeof(vector3));
+    actor *camera = (actor*)level_alloc(sizeof(actor), MemoryActor);
+    camera->position = (vector3*)level_alloc(sizeof(vector3), MemoryActor);
+    camera->rotationAxis = (vector3*)level_alloc(sizeof(vector3), MemoryActor);
+    camera->scale = NULL;
     camera->visible = 1;
+    camera->loading = 0;
+    camera->active = 1;
+    camera->index = 0;
+    camera->pool = NULL;
+    camera->poolSlot = 0;
     camera->type = Camera;
     camera->collider = collider;
+    camera->trigger = trigger;
+    camera->bvh = NULL;
 
-    camera->center = (vector3*)malloc(sizeof(vector3));
+    camera->center = (vector3*)level_alloc(sizeof(vector3), MemoryActor);
     camera->center->x = centerX;
     camera->center->y = centerY;
     camera->center->z = centerZ;
     camera->radius = radius;
 
-    camera->extents = (vector3 *)malloc(sizeof(vector3));
+    camera->extents = (vector3 *)level_alloc(sizeof(vector3), MemoryActor);
     camera->extents->x = extentX;
     camera->extents->y = extentY;
     camera->extents->z = extentZ;
@@ -209,6 +624,7 @@ actor *createCamera(double positionX, double positionY, double positionZ,
     camera->rotationAxis->y = rotY;
     camera->rotationAxis->z = rotZ;
     camera->rotationAngle = angle;
+    actor_snapshot(camera);
 
     return camera;
 }
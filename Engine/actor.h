@@ -6,7 +6,7 @@
 
 enum actorType { Model, Camera };
 
-enum colliderType { None, Sphere, Box };
+enum colliderType { None, Sphere, Box, Mesh };
 
 typedef struct transform 
 {
@@ -31,6 +31,8 @@ typedef struct actor
 {
     enum actorType type;
     enum colliderType collider;
+    int trigger;
+    struct mesh_bvh *bvh;
     mesh *mesh;
     unsigned short *texture;
     int textureWidth;
@@ -38,18 +40,39 @@ typedef struct actor
     double rotationAngle;
     double radius;
     int visible;
+    // Streamed models don't draw until their mesh and texture arrive, whatever scripts set visible to.
+    int loading;
+    // Inactive actors are pooled instances waiting to be spawned and are skipped by drawing and collision.
+    int active;
+    int index;
+    struct actor_pool *pool;
+    int poolSlot;
     vector3 *position;
     vector3 *rotationAxis;
     vector3 *scale;
     vector3 *center;
     vector3 *extents;
     transform transform;
+    // Transform at the start of the current tick. Rendering blends from it to the current one.
+    vector3 previousPosition;
+    vector3 previousRotationAxis;
+    vector3 previousScale;
+    double previousRotationAngle;
 } actor;
 
+typedef struct asset_stats
+{
+    int references;
+    int bytesLoaded;
+    int bytesShared;
+    // Streamed assets loaded on the game thread since the heap or the stream queue was full.
+    int blockingLoads;
+} asset_stats;
+
 actor *loadModel(void *dataStart, void *dataEnd, double positionX, double positionY, double positionZ,
     double rotX, double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ, 
     double centerX, double centerY, double centerZ, double radius,
-    double extentX, double extentY, double extentZ, enum colliderType collider);
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger);
 
 actor *loadTexturedModel(void *dataStart, void *dataEnd,
     void *textureStart, void *textureEnd, int textureWidth, int textureHeight,
@@ -57,12 +80,37 @@ actor *loadTexturedModel(void *dataStart, void *dataEnd,
     double rotX, double rotY, double rotZ, double angle,
     double scaleX, double scaleY, double scaleZ, 
     double centerX, double centerY, double centerZ, double radius,
-    double extentX, double extentY, double extentZ, enum colliderType collider);
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger);
 
 actor *createCamera(double positionX, double positionY, double positionZ,
     double rotX, double rotY, double rotZ, double angle, 
     double centerX, double centerY, double centerZ, double radius,
-    double extentX, double extentY, double extentZ, enum colliderType collider);
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger);
+
+actor *streamModel(void *dataStart, void *dataEnd, double positionX, double positionY, double positionZ,
+    double rotX, double rotY, double rotZ, double angle, double scaleX, double scaleY, double scaleZ, 
+    double centerX, double centerY, double centerZ, double radius,
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger);
+
+actor *streamTexturedModel(void *dataStart, void *dataEnd,
+    void *textureStart, void *textureEnd, int textureWidth, int textureHeight,
+    double positionX, double positionY, double positionZ,
+    double rotX, double rotY, double rotZ, double angle,
+    double scaleX, double scaleY, double scaleZ, 
+    double centerX, double centerY, double centerZ, double radius,
+    double extentX, double extentY, double extentZ, enum colliderType collider, int trigger);
+
+void unloadModel(actor *model);
+
+void asset_cache_reset();
+
+asset_stats asset_get_stats();
+
+void actor_snapshot(actor *target);
+
+void actor_set_interpolation(float alpha);
+
+void actor_interpolate(actor *target, vector3 *position, vector3 *rotationAxis, double *rotationAngle, vector3 *scale);
 
 void modelDraw(actor *model, Gfx **displayList);
 
@@ -0,0 +1,170 @@
+#include <nusys.h>
+#include <malloc.h>
+#include "arena.h"
+
+// Matrices handed to the RSP need 8 byte alignment.
+#define ARENA_ALIGN 8
+
+// Heap blocks carry their size and category in front so a free can be charged back. It's
+// 8 bytes so the block after it keeps malloc's alignment.
+typedef struct heap_header
+{
+    int size;
+    int category;
+} heap_header;
+
+static arena level_arena;
+static arena frame_arena;
+static memory_category_stats category_stats[MemoryCategoryCount];
+static int heap_size = 0;
+static int heap_used = 0;
+static int heap_high_water = 0;
+static int heap_failures = 0;
+
+void arena_init(arena *region, void *buffer, int size)
+{
+    region->base = (unsigned char *)buffer;
+    region->size = size;
+    region->used = 0;
+    region->highWater = 0;
+    region->failures = 0;
+}
+
+void *arena_alloc(arena *region, int size)
+{
+    int offset = (region->used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    if (size < 0 || offset + size > region->size)
+    {
+        region->failures++;
+        return NULL;
+    }
+
+    region->used = offset + size;
+    if (region->used > region->highWater) region->highWater = region->used;
+
+    return region->base + offset;
+}
+
+void arena_reset(arena *region)
+{
+    region->used = 0;
+}
+
+void memory_init(void *levelBuffer, int levelSize, void *frameBuffer, int frameSize)
+{
+    arena_init(&level_arena, levelBuffer, levelSize);
+    arena_init(&frame_arena, frameBuffer, frameSize);
+}
+
+int heap_init(void *buffer, int size)
+{
+    heap_size = size;
+    return InitHeap(buffer, size);
+}
+
+void *heap_alloc(int size, enum memoryCategory category)
+{
+    // The stream thread allocates while decoding. Threads only switch on an interrupt so masking
+    // them keeps it from cutting in halfway through the game thread's allocation or the reverse.
+    OSIntMask mask = osSetIntMask(OS_IM_NONE);
+    heap_header *header = size >= 0 ? (heap_header *)malloc(sizeof(heap_header) + size) : NULL;
+
+    if (header == NULL)
+    {
+        heap_failures++;
+        osSetIntMask(mask);
+        return NULL;
+    }
+
+    header->size = size;
+    header->category = category;
+
+    // Used counts the headers too so it can be compared against the heap's size.
+    heap_used += sizeof(heap_header) + size;
+    if (heap_used > heap_high_water) heap_high_water = heap_used;
+
+    memory_category_stats *stats = &category_stats[category];
+    stats->heapBytes += size;
+    if (stats->heapBytes > stats->heapHighWater) stats->heapHighWater = stats->heapBytes;
+    stats->heapAllocations++;
+    osSetIntMask(mask);
+
+    return header + 1;
+}
+
+void heap_free(void *pointer)
+{
+    if (pointer == NULL) return;
+
+    OSIntMask mask = osSetIntMask(OS_IM_NONE);
+    heap_header *header = (heap_header *)pointer - 1;
+    memory_category_stats *stats = &category_stats[header->category];
+    stats->heapBytes -= header->size;
+    stats->heapFrees++;
+    heap_used -= sizeof(heap_header) + header->size;
+
+    free(header);
+    osSetIntMask(mask);
+}
+
+void *level_alloc(int size, enum memoryCategory category)
+{
+    OSIntMask mask = osSetIntMask(OS_IM_NONE);
+    void *memory = arena_alloc(&level_arena, size);
+
+    if (memory != NULL)
+    {
+        memory_category_stats *stats = &category_stats[category];
+        stats->levelBytes += size;
+        if (stats->levelBytes > stats->levelHighWater) stats->levelHighWater = stats->levelBytes;
+        stats->levelAllocations++;
+    }
+
+    osSetIntMask(mask);
+    return memory;
+}
+
+void level_reset()
+{
+    for (int i = 0; i < MemoryCategoryCount; i++)
+    {
+        category_stats[i].levelBytes = 0;
+        category_stats[i].levelAllocations = 0;
+    }
+
+    arena_reset(&level_arena);
+}
+
+void *frame_alloc(int size)
+{
+    return arena_alloc(&frame_arena, size);
+}
+
+void frame_reset()
+{
+    arena_reset(&frame_arena);
+}
+
+memory_stats memory_get_stats()
+{
+    memory_stats stats;
+
+    stats.levelUsed = level_arena.used;
+    stats.levelSize = level_arena.size;
+    stats.levelHighWater = level_arena.highWater;
+    stats.frameUsed = frame_arena.used;
+    stats.frameSize = frame_arena.size;
+    stats.frameHighWater = frame_arena.highWater;
+    stats.heapUsed = heap_used;
+    stats.heapSize = heap_size;
+    stats.heapHighWater = heap_high_water;
+    stats.failures = level_arena.failures + frame_arena.failures + heap_failures;
+
+    return stats;
+}
+
+memory_category_stats memory_get_category_stats(enum memoryCategory category)
+{
+    return category_stats[category];
+}
@@ -0,0 +1,71 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+typedef struct arena
+{
+    unsigned char *base;
+    int size;
+    int used;
+    int highWater;
+    int failures;
+} arena;
+
+// What level and heap allocations are for. Frame memory is scratch and isn't tracked by category.
+enum memoryCategory { MemoryMesh, MemoryTexture, MemoryActor, MemoryCollision, MemoryScript,
+    MemoryCategoryCount };
+
+typedef struct memory_stats
+{
+    int levelUsed;
+    int levelSize;
+    int levelHighWater;
+    int frameUsed;
+    int frameSize;
+    int frameHighWater;
+    int heapUsed;
+    int heapSize;
+    int heapHighWater;
+    int failures;
+} memory_stats;
+
+// Bytes are what was asked for, without alignment padding or heap headers. Level bytes and
+// allocations drop back to zero on a level reset while the high-water marks are kept for the
+// whole session. Heap allocations that never see a free are leaks.
+typedef struct memory_category_stats
+{
+    int levelBytes;
+    int levelHighWater;
+    int levelAllocations;
+    int heapBytes;
+    int heapHighWater;
+    int heapAllocations;
+    int heapFrees;
+} memory_category_stats;
+
+void arena_init(arena *region, void *buffer, int size);
+
+void *arena_alloc(arena *region, int size);
+
+void arena_reset(arena *region);
+
+void memory_init(void *levelBuffer, int levelSize, void *frameBuffer, int frameSize);
+
+int heap_init(void *buffer, int size);
+
+void *heap_alloc(int size, enum memoryCategory category);
+
+void heap_free(void *pointer);
+
+void *level_alloc(int size, enum memoryCategory category);
+
+void level_reset();
+
+void *frame_alloc(int size);
+
+void frame_reset();
+
+memory_stats memory_get_stats();
+
+memory_category_stats memory_get_category_stats(enum memoryCategory category);
+
+#endif
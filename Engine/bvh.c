@@ -0,0 +1,641 @@
+#include "utilities.h"
+#include "arena.h"
+#include "bvh.h"
+
+// Median splits in the editor keep the tree well under this depth.
+#define BVH_STACK_SIZE 64
+#define BVH_EPSILON 0.0000001f
+
+typedef struct bvh_header
+{
+    float origin[3];
+    float scale[3];
+    unsigned short nodeCount;
+    unsigned short triangleCount;
+    unsigned short vertexCount;
+    unsigned short padding;
+} bvh_header;
+
+mesh_bvh *bvh_load(void *romStart, void *romEnd)
+{
+    int size = romEnd - romStart;
+    unsigned char *data = (unsigned char *)level_alloc(size, MemoryCollision);
+    mesh_bvh *bvh = (mesh_bvh *)level_alloc(sizeof(mesh_bvh), MemoryCollision);
+
+    // The editor writes the tree big endian so it can be used straight from the DMA buffer.
+    rom_2_ram(romStart, data, size);
+    bvh_header *header = (bvh_header *)data;
+
+    for (int i = 0; i < 3; i++)
+    {
+        bvh->origin[i] = header->origin[i];
+        bvh->scale[i] = header->scale[i];
+    }
+
+    bvh->nodeCount = header->nodeCount;
+    bvh->triangleCount = header->triangleCount;
+    bvh->nodes = (bvh_node *)(data + sizeof(bvh_header));
+    bvh->vertices = (unsigned short *)(bvh->nodes + header->nodeCount);
+    bvh->triangles = bvh->vertices + header->vertexCount * 3;
+
+    return bvh;
+}
+
+static void vsub(float out[3], const float a[3], const float b[3])
+{
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+static void vcopy(float out[3], const float a[3])
+{
+    out[0] = a[0];
+    out[1] = a[1];
+    out[2] = a[2];
+}
+
+static void vmadd(float out[3], const float a[3], const float b[3], float s)
+{
+    out[0] = a[0] + b[0] * s;
+    out[1] = a[1] + b[1] * s;
+    out[2] = a[2] + b[2] * s;
+}
+
+static float vdot(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void vcross(float out[3], const float a[3], const float b[3])
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static int vnorm(float v[3])
+{
+    float len = sqrtf(vdot(v, v));
+    if (len < BVH_EPSILON) return 0;
+
+    v[0] /= len;
+    v[1] /= len;
+    v[2] /= len;
+    return 1;
+}
+
+static void node_bounds(const mesh_bvh *bvh, const bvh_node *node, float min[3], float max[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        min[i] = bvh->origin[i] + node->min[i] * bvh->scale[i];
+        max[i] = bvh->origin[i] + node->max[i] * bvh->scale[i];
+    }
+}
+
+static void triangle_vertices(const mesh_bvh *bvh, int triangle, float v[3][3])
+{
+    const unsigned short *indices = &bvh->triangles[triangle * 3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        const unsigned short *quantized = &bvh->vertices[indices[i] * 3];
+        v[i][0] = bvh->origin[0] + quantized[0] * bvh->scale[0];
+        v[i][1] = bvh->origin[1] + quantized[1] * bvh->scale[1];
+        v[i][2] = bvh->origin[2] + quantized[2] * bvh->scale[2];
+    }
+}
+
+void bvh_bounds(const mesh_bvh *bvh, vector3 *min, vector3 *max)
+{
+    float nodeMin[3] = { 0, 0, 0 }, nodeMax[3] = { 0, 0, 0 };
+
+    if (bvh->nodeCount > 0) node_bounds(bvh, &bvh->nodes[0], nodeMin, nodeMax);
+
+    min->x = nodeMin[0];
+    min->y = nodeMin[1];
+    min->z = nodeMin[2];
+    max->x = nodeMax[0];
+    max->y = nodeMax[1];
+    max->z = nodeMax[2];
+}
+
+static int ray_node(const float min[3], const float max[3], const float origin[3], const float invDir[3],
+    float radius, float maxDistance)
+{
+    float tMin = 0, tMax = maxDistance;
+
+    // Slab test against the node grown by the cast radius.
+    for (int i = 0; i < 3; i++)
+    {
+        float lo = (min[i] - radius - origin[i]) * invDir[i];
+        float hi = (max[i] + radius - origin[i]) * invDir[i];
+
+        if (lo > hi)
+        {
+            float swap = lo;
+            lo = hi;
+            hi = swap;
+        }
+
+        if (lo > tMin) tMin = lo;
+        if (hi < tMax) tMax = hi;
+        if (tMin > tMax) return 0;
+    }
+
+    return 1;
+}
+
+static int ray_triangle(const float origin[3], const float dir[3], float v[3][3], float *t, float normal[3])
+{
+    float e1[3], e2[3], p[3], s[3], q[3];
+
+    vsub(e1, v[1], v[0]);
+    vsub(e2, v[2], v[0]);
+    vcross(p, dir, e2);
+
+    float det = vdot(e1, p);
+    if (fabs(det) < BVH_EPSILON) return 0;
+
+    float invDet = 1.0f / det;
+    vsub(s, origin, v[0]);
+
+    float u = vdot(s, p) * invDet;
+    if (u < 0 || u > 1) return 0;
+
+    vcross(q, s, e1);
+    float w = vdot(dir, q) * invDet;
+    if (w < 0 || u + w > 1) return 0;
+
+    *t = vdot(e2, q) * invDet;
+    if (*t < 0) return 0;
+
+    // Triangles are two sided so face the normal back along the ray.
+    vcross(normal, e1, e2);
+    vnorm(normal);
+    if (vdot(normal, dir) > 0)
+    {
+        normal[0] = -normal[0];
+        normal[1] = -normal[1];
+        normal[2] = -normal[2];
+    }
+
+    return 1;
+}
+
+static int point_in_triangle(const float p[3], float v[3][3], const float faceNormal[3])
+{
+    float edge[3], toPoint[3], c[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        vsub(edge, v[(i + 1) % 3], v[i]);
+        vsub(toPoint, p, v[i]);
+        vcross(c, edge, toPoint);
+        if (vdot(c, faceNormal) < 0) return 0;
+    }
+
+    return 1;
+}
+
+static int ray_sphere(const float origin[3], const float dir[3], const float center[3], float radius, float *t)
+{
+    float m[3];
+    vsub(m, origin, center);
+
+    float b = vdot(m, dir);
+    float c = vdot(m, m) - radius * radius;
+    if (c > 0 && b > 0) return 0;
+
+    float disc = b * b - c;
+    if (disc < 0) return 0;
+
+    *t = -b - sqrtf(disc);
+    if (*t < 0) *t = 0;
+    return 1;
+}
+
+static int ray_cylinder(const float origin[3], const float dir[3], const float p[3], const float q[3],
+    float radius, float *t, float *along)
+{
+    float e[3], m[3];
+    vsub(e, q, p);
+    vsub(m, origin, p);
+
+    float ee = vdot(e, e);
+    if (ee < BVH_EPSILON) return 0;
+
+    // Solve against the components perpendicular to the edge. Rays running along
+    // the edge are left to the end cap spheres.
+    float md = vdot(m, e), dd = vdot(dir, e);
+    float a = vdot(dir, dir) - dd * dd / ee;
+    if (a < BVH_EPSILON) return 0;
+
+    float b = vdot(m, dir) - md * dd / ee;
+    float c = vdot(m, m) - md * md / ee - radius * radius;
+    float disc = b * b - a * c;
+    if (disc < 0) return 0;
+
+    float hit = (-b - sqrtf(disc)) / a;
+    if (hit < 0)
+    {
+        if (c > 0) return 0;
+        hit = 0;
+    }
+
+    float s = (md + hit * dd) / ee;
+    if (s < 0 || s > 1) return 0;
+
+    *t = hit;
+    *along = s;
+    return 1;
+}
+
+static int sphere_cast_triangle(const float origin[3], const float dir[3], float radius, float v[3][3],
+    float *t, float normal[3])
+{
+    float e1[3], e2[3], faceNormal[3], n[3], toOrigin[3], contact[3];
+
+    vsub(e1, v[1], v[0]);
+    vsub(e2, v[2], v[0]);
+    vcross(faceNormal, e1, e2);
+
+    // The face is hit first when the sphere touches the plane inside the triangle.
+    if (vnorm(faceNormal))
+    {
+        vcopy(n, faceNormal);
+
+        vsub(toOrigin, origin, v[0]);
+        float dist = vdot(toOrigin, n);
+        if (dist < 0)
+        {
+            n[0] = -n[0];
+            n[1] = -n[1];
+            n[2] = -n[2];
+            dist = -dist;
+        }
+
+        float hit = -1;
+        float denom = vdot(dir, n);
+
+        if (dist <= radius) hit = 0;
+        else if (denom < 0) hit = (dist - radius) / -denom;
+
+        if (hit >= 0)
+        {
+            vmadd(contact, origin, dir, hit);
+            vmadd(contact, contact, n, -(dist < radius ? dist : radius));
+
+            if (point_in_triangle(contact, v, faceNormal))
+            {
+                *t = hit;
+                vcopy(normal, n);
+                return 1;
+            }
+        }
+    }
+
+    // Otherwise the sphere can only touch an edge or a corner.
+    float best = -1, hit, along;
+    float center[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        const float *p = v[i];
+        const float *q = v[(i + 1) % 3];
+
+        if (ray_cylinder(origin, dir, p, q, radius, &hit, &along) && (best < 0 || hit < best))
+        {
+            float edge[3];
+            vsub(edge, q, p);
+            vmadd(contact, p, edge, along);
+            best = hit;
+        }
+
+        if (ray_sphere(origin, dir, p, radius, &hit) && (best < 0 || hit < best))
+        {
+            vcopy(contact, p);
+            best = hit;
+        }
+    }
+
+    if (best < 0) return 0;
+
+    vmadd(center, origin, dir, best);
+    vsub(normal, center, contact);
+    if (!vnorm(normal))
+    {
+        normal[0] = -dir[0];
+        normal[1] = -dir[1];
+        normal[2] = -dir[2];
+    }
+
+    *t = best;
+    return 1;
+}
+
+int bvh_cast(const mesh_bvh *bvh, vector3 origin, vector3 direction, float maxDistance, float radius, raycast_hit *hit)
+{
+    float o[3] = { origin.x, origin.y, origin.z };
+    float d[3] = { direction.x, direction.y, direction.z };
+    float invDir[3], normal[3], bestNormal[3], v[3][3];
+    float best = maxDistance, t;
+    int stack[BVH_STACK_SIZE];
+    int top = 0, found = 0;
+
+    if (bvh->nodeCount == 0 || !vnorm(d)) return 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        invDir[i] = fabs(d[i]) > BVH_EPSILON ? 1.0f / d[i] : 1e30f;
+    }
+
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const bvh_node *node = &bvh->nodes[stack[--top]];
+        float min[3], max[3];
+
+        node_bounds(bvh, node, min, max);
+        if (!ray_node(min, max, o, invDir, radius, best)) continue;
+
+        if (node->count == 0)
+        {
+            // Visit the child nearer the origin first so the best distance shrinks sooner.
+            const bvh_node *left = &bvh->nodes[node->start];
+            const bvh_node *right = &bvh->nodes[node->start + 1];
+            float order = 0;
+
+            for (int i = 0; i < 3; i++)
+            {
+                order += ((right->min[i] + right->max[i]) - (left->min[i] + left->max[i])) * bvh->scale[i] * d[i];
+            }
+
+            stack[top++] = order < 0 ? node->start : node->start + 1;
+            stack[top++] = order < 0 ? node->start + 1 : node->start;
+            continue;
+        }
+
+        for (int i = node->start; i < node->start + node->count; i++)
+        {
+            triangle_vertices(bvh, i, v);
+
+            int intersects = radius > 0 ? sphere_cast_triangle(o, d, radius, v, &t, normal)
+                : ray_triangle(o, d, v, &t, normal);
+
+            if (intersects && t <= best)
+            {
+                best = t;
+                vcopy(bestNormal, normal);
+                found = 1;
+            }
+        }
+    }
+
+    if (found && hit != NULL)
+    {
+        // Report the contact on the surface which for sphere casts sits one radius behind the center.
+        hit->distance = best;
+        hit->normal.x = bestNormal[0];
+        hit->normal.y = bestNormal[1];
+        hit->normal.z = bestNormal[2];
+        hit->point.x = o[0] + d[0] * best - bestNormal[0] * radius;
+        hit->point.y = o[1] + d[1] * best - bestNormal[1] * radius;
+        hit->point.z = o[2] + d[2] * best - bestNormal[2] * radius;
+    }
+
+    return found;
+}
+
+static int sphere_node(const float min[3], const float max[3], const float center[3], float radius)
+{
+    float dist = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (center[i] < min[i]) dist += (min[i] - center[i]) * (min[i] - center[i]);
+        else if (center[i] > max[i]) dist += (center[i] - max[i]) * (center[i] - max[i]);
+    }
+
+    return dist <= radius * radius;
+}
+
+static void closest_point_triangle(const float p[3], float v[3][3], float out[3])
+{
+    float ab[3], ac[3], ap[3], bp[3], cp[3];
+
+    vsub(ab, v[1], v[0]);
+    vsub(ac, v[2], v[0]);
+    vsub(ap, p, v[0]);
+
+    float d1 = vdot(ab, ap), d2 = vdot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        vcopy(out, v[0]);
+        return;
+    }
+
+    vsub(bp, p, v[1]);
+    float d3 = vdot(ab, bp), d4 = vdot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+    {
+        vcopy(out, v[1]);
+        return;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        vmadd(out, v[0], ab, d1 / (d1 - d3));
+        return;
+    }
+
+    vsub(cp, p, v[2]);
+    float d5 = vdot(ab, cp), d6 = vdot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        vcopy(out, v[2]);
+        return;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        vmadd(out, v[0], ac, d2 / (d2 - d6));
+        return;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        float bc[3];
+        vsub(bc, v[2], v[1]);
+        vmadd(out, v[1], bc, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        return;
+    }
+
+    // Inside the face so use the barycentric coordinates.
+    float denom = 1.0f / (va + vb + vc);
+    vmadd(out, v[0], ab, vb * denom);
+    vmadd(out, out, ac, vc * denom);
+}
+
+int bvh_overlap_sphere(const mesh_bvh *bvh, vector3 center, float radius)
+{
+    float c[3] = { center.x, center.y, center.z };
+    float closest[3], toCenter[3], v[3][3];
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+
+    if (bvh->nodeCount == 0) return 0;
+
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const bvh_node *node = &bvh->nodes[stack[--top]];
+        float min[3], max[3];
+
+        node_bounds(bvh, node, min, max);
+        if (!sphere_node(min, max, c, radius)) continue;
+
+        if (node->count == 0)
+        {
+            stack[top++] = node->start;
+            stack[top++] = node->start + 1;
+            continue;
+        }
+
+        for (int i = node->start; i < node->start + node->count; i++)
+        {
+            triangle_vertices(bvh, i, v);
+            closest_point_triangle(c, v, closest);
+            vsub(toCenter, c, closest);
+            if (vdot(toCenter, toCenter) <= radius * radius) return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int box_node(const float min[3], const float max[3], const float center[3], const float axes[3][3],
+    const float extents[3])
+{
+    float nodeCenter[3], half[3], toNode[3];
+
+    // The node's axes, which is the box's world bounds against the node.
+    for (int i = 0; i < 3; i++)
+    {
+        float r = extents[0] * fabs(axes[0][i]) + extents[1] * fabs(axes[1][i]) + extents[2] * fabs(axes[2][i]);
+        if (center[i] - r > max[i] || center[i] + r < min[i]) return 0;
+
+        nodeCenter[i] = (min[i] + max[i]) * 0.5f;
+        half[i] = (max[i] - min[i]) * 0.5f;
+    }
+
+    // Then the box's own axes which matter once it's rotated.
+    vsub(toNode, nodeCenter, center);
+    for (int i = 0; i < 3; i++)
+    {
+        float r = half[0] * fabs(axes[i][0]) + half[1] * fabs(axes[i][1]) + half[2] * fabs(axes[i][2]);
+        if (fabs(vdot(toNode, axes[i])) > extents[i] + r) return 0;
+    }
+
+    return 1;
+}
+
+static int axis_separates(const float axis[3], float p[3][3], const float extents[3])
+{
+    float r = extents[0] * fabs(axis[0]) + extents[1] * fabs(axis[1]) + extents[2] * fabs(axis[2]);
+    float a = vdot(p[0], axis), b = vdot(p[1], axis), c = vdot(p[2], axis);
+    float min = a < b ? (a < c ? a : c) : (b < c ? b : c);
+    float max = a > b ? (a > c ? a : c) : (b > c ? b : c);
+
+    return min > r || max < -r;
+}
+
+static int box_triangle(float v[3][3], const float center[3], const float axes[3][3], const float extents[3])
+{
+    float p[3][3], e[3][3], toVertex[3], axis[3];
+
+    // Move the triangle into the box's space where the box sits around the origin.
+    for (int i = 0; i < 3; i++)
+    {
+        vsub(toVertex, v[i], center);
+        for (int j = 0; j < 3; j++) p[i][j] = vdot(toVertex, axes[j]);
+    }
+
+    vsub(e[0], p[1], p[0]);
+    vsub(e[1], p[2], p[1]);
+    vsub(e[2], p[0], p[2]);
+
+    // Separating axis test on the box faces, the triangle's face and the nine edge pairs.
+    for (int i = 0; i < 3; i++)
+    {
+        float unit[3] = { 0, 0, 0 };
+        unit[i] = 1;
+        if (axis_separates(unit, p, extents)) return 0;
+    }
+
+    vcross(axis, e[0], e[1]);
+    if (axis_separates(axis, p, extents)) return 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            float unit[3] = { 0, 0, 0 };
+            unit[i] = 1;
+            vcross(axis, unit, e[j]);
+            if (axis_separates(axis, p, extents)) return 0;
+        }
+    }
+
+    return 1;
+}
+
+int bvh_overlap_box(const mesh_bvh *bvh, vector3 center, const vector3 axes[3], vector3 extents)
+{
+    float c[3] = { center.x, center.y, center.z };
+    float ext[3] = { extents.x, extents.y, extents.z };
+    float a[3][3], v[3][3];
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+
+    if (bvh->nodeCount == 0) return 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        a[i][0] = axes[i].x;
+        a[i][1] = axes[i].y;
+        a[i][2] = axes[i].z;
+    }
+
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const bvh_node *node = &bvh->nodes[stack[--top]];
+        float min[3], max[3];
+
+        node_bounds(bvh, node, min, max);
+        if (!box_node(min, max, c, a, ext)) continue;
+
+        if (node->count == 0)
+        {
+            stack[top++] = node->start;
+            stack[top++] = node->start + 1;
+            continue;
+        }
+
+        for (int i = node->start; i < node->start + node->count; i++)
+        {
+            triangle_vertices(bvh, i, v);
+            if (box_triangle(v, c, a, ext)) return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef _BVH_H_
+#define _BVH_H_
+
+#include "actor.h"
+
+typedef struct bvh_node
+{
+    unsigned short min[3];
+    unsigned short max[3];
+    unsigned short start;
+    unsigned short count;
+} bvh_node;
+
+typedef struct mesh_bvh
+{
+    float origin[3];
+    float scale[3];
+    int nodeCount;
+    int triangleCount;
+    const bvh_node *nodes;
+    const unsigned short *vertices;
+    const unsigned short *triangles;
+} mesh_bvh;
+
+typedef struct raycast_hit
+{
+    actor *target;
+    vector3 point;
+    vector3 normal;
+    float distance;
+} raycast_hit;
+
+mesh_bvh *bvh_load(void *romStart, void *romEnd);
+
+void bvh_bounds(const mesh_bvh *bvh, vector3 *min, vector3 *max);
+
+int bvh_cast(const mesh_bvh *bvh, vector3 origin, vector3 direction, float maxDistance, float radius, raycast_hit *hit);
+
+int bvh_overlap_sphere(const mesh_bvh *bvh, vector3 center, float radius);
+
+int bvh_overlap_box(const mesh_bvh *bvh, vector3 center, const vector3 axes[3], vector3 extents);
+
+#endif
@@ -1,6 +1,468 @@
+#include <string.h>
 #include "utilities.h"
+#include "arena.h"
 #include "collision.h"
 
+#define COLLIDER_IN_SWEEP 1
+#define COLLIDER_DESPAWNED 2
+
+static actor **world_actors = NULL;
+static int world_actor_count = 0;
+static const unsigned short *world_layers = NULL;
+static const unsigned short *world_masks = NULL;
+static aabb *world_bounds = NULL;
+static int *sweep_list = NULL;
+static int sweep_count = 0;
+static collision_pair *pair_list = NULL;
+static int pair_capacity = 0;
+static int *collider_slot = NULL;
+static unsigned char *pair_state = NULL;
+static unsigned char *pair_seen = NULL;
+static collision_pair *active_list = NULL;
+static int active_count = 0;
+static int active_capacity = 0;
+static unsigned char *collider_flags = NULL;
+static int sweep_dirty = 0;
+static collision_stats stats;
+
+void collision_init(actor **actors, int count, const unsigned short *layers, const unsigned short *masks)
+{
+    world_actors = actors;
+    world_actor_count = count;
+    world_layers = layers;
+    world_masks = masks;
+    world_bounds = (aabb *)level_alloc(count * sizeof(aabb), MemoryCollision);
+    sweep_list = (int *)level_alloc(count * sizeof(int), MemoryCollision);
+    collider_slot = (int *)level_alloc(count * sizeof(int), MemoryCollision);
+    collider_flags = (unsigned char *)level_alloc(count, MemoryCollision);
+    sweep_count = 0;
+    sweep_dirty = 0;
+
+    // Every collider gets a slot so pooled actors keep their pair bits while inactive,
+    // but only active actors with a collider take part in the sweep.
+    int colliderCount = 0;
+    for (int i = 0; i < count; i++)
+    {
+        collider_slot[i] = colliderCount;
+        collider_flags[i] = 0;
+        if (actors[i]->collider != None)
+        {
+            colliderCount++;
+
+            if (actors[i]->active)
+            {
+                sweep_list[sweep_count++] = i;
+                collider_flags[i] = COLLIDER_IN_SWEEP;
+            }
+        }
+    }
+
+    pair_capacity = colliderCount * 4;
+    pair_list = pair_capacity > 0
+        ? (collision_pair *)level_alloc(pair_capacity * sizeof(collision_pair), MemoryCollision) : NULL;
+    active_capacity = pair_capacity;
+    active_list = active_capacity > 0
+        ? (collision_pair *)level_alloc(active_capacity * sizeof(collision_pair), MemoryCollision) : NULL;
+    active_count = 0;
+
+    // One bit for every unique pair of colliders.
+    int stateBytes = ((colliderCount * (colliderCount - 1) / 2) + 7) / 8;
+    pair_state = (unsigned char *)level_alloc(stateBytes + 1, MemoryCollision);
+    pair_seen = (unsigned char *)level_alloc(stateBytes + 1, MemoryCollision);
+    memset(pair_state, 0, stateBytes + 1);
+    memset(pair_seen, 0, stateBytes + 1);
+
+    memset(&stats, 0, sizeof(stats));
+    stats.colliders = sweep_count;
+}
+
+void collision_enable(actor *a)
+{
+    // The sweep is rebuilt at the start of the next update rather than while pairs are being dispatched.
+    if (a->collider != None) sweep_dirty = 1;
+}
+
+void collision_disable(actor *a)
+{
+    if (a->collider == None) return;
+
+    collider_flags[a->index] |= COLLIDER_DESPAWNED;
+    sweep_dirty = 1;
+}
+
+static void compute_bounds(actor *a, aabb *bounds)
+{
+    float mat[4][4];
+    vector3 half;
+
+    // Mesh colliders are static and their tree is already in world space.
+    if (a->collider == Mesh)
+    {
+        bvh_bounds(a->bvh, &bounds->min, &bounds->max);
+        return;
+    }
+
+    vector3 center = vec3_add(*a->position, vec3_mul_mat3x3(*a->center, a->transform.rotation));
+
+    if (a->collider == Sphere)
+    {
+        half.x = half.y = half.z = a->radius;
+    }
+    else
+    {
+        // Project the oriented extents onto the world axes.
+        guMtxL2F(mat, &a->transform.rotation);
+        half.x = fabs(mat[0][0]) * a->extents->x + fabs(mat[1][0]) * a->extents->y + fabs(mat[2][0]) * a->extents->z;
+        half.y = fabs(mat[0][1]) * a->extents->x + fabs(mat[1][1]) * a->extents->y + fabs(mat[2][1]) * a->extents->z;
+        half.z = fabs(mat[0][2]) * a->extents->x + fabs(mat[1][2]) * a->extents->y + fabs(mat[2][2]) * a->extents->z;
+    }
+
+    bounds->min = vec3_sub(center, half);
+    bounds->max = vec3_add(center, half);
+}
+
+static int bounds_overlap(const aabb *a, const aabb *b)
+{
+    return a->min.x <= b->max.x && a->max.x >= b->min.x
+        && a->min.y <= b->max.y && a->max.y >= b->min.y
+        && a->min.z <= b->max.z && a->max.z >= b->min.z;
+}
+
+static int layers_interact(int a, int b)
+{
+    return (world_layers[a] & world_masks[b]) && (world_layers[b] & world_masks[a]);
+}
+
+static void grow_pairs(collision_pair **list, int *capacity)
+{
+    // The old list stays in the level arena until the next level. Doubling keeps that
+    // waste smaller than the final list.
+    int newCapacity = *capacity * 2;
+    collision_pair *newList = (collision_pair *)level_alloc(newCapacity * sizeof(collision_pair), MemoryCollision);
+    memcpy(newList, *list, *capacity * sizeof(collision_pair));
+    *list = newList;
+    *capacity = newCapacity;
+}
+
+static void add_pair(int a, int b)
+{
+    // Grow the pair list when a frame produces more pairs than ever before.
+    if (stats.candidatePairs == pair_capacity) grow_pairs(&pair_list, &pair_capacity);
+
+    // Keep the lower actor index first so dispatch order is stable.
+    pair_list[stats.candidatePairs].a = a < b ? a : b;
+    pair_list[stats.candidatePairs].b = a < b ? b : a;
+    stats.candidatePairs++;
+}
+
+int collision_broad_phase(collision_pair **pairs)
+{
+    stats.candidatePairs = 0;
+    stats.layerRejects = 0;
+    *pairs = pair_list;
+
+    for (int i = 0; i < sweep_count; i++)
+    {
+        compute_bounds(world_actors[sweep_list[i]], &world_bounds[sweep_list[i]]);
+    }
+
+    // Insertion sort on the min x bound. Actors move little between frames so
+    // the list stays nearly sorted and this runs in close to linear time.
+    for (int i = 1; i < sweep_count; i++)
+    {
+        int index = sweep_list[i];
+        float minX = world_bounds[index].min.x;
+        int j = i - 1;
+
+        while (j >= 0 && world_bounds[sweep_list[j]].min.x > minX)
+        {
+            sweep_list[j + 1] = sweep_list[j];
+            j--;
+        }
+
+        sweep_list[j + 1] = index;
+    }
+
+    // Sweep along x and only test the remaining axes for intervals that overlap.
+    for (int i = 0; i < sweep_count; i++)
+    {
+        aabb *a = &world_bounds[sweep_list[i]];
+
+        for (int j = i + 1; j < sweep_count; j++)
+        {
+            aabb *b = &world_bounds[sweep_list[j]];
+            if (b->min.x > a->max.x) break;
+
+            // Layers are cheaper to compare than bounds so reject on them first.
+            if (!layers_interact(sweep_list[i], sweep_list[j]))
+            {
+                stats.layerRejects++;
+                continue;
+            }
+
+            if (bounds_overlap(a, b)) add_pair(sweep_list[i], sweep_list[j]);
+        }
+    }
+
+    return stats.candidatePairs;
+}
+
+static int pair_bit(int a, int b)
+{
+    // Triangular index over collider slots where a is always the lower actor index.
+    int slotA = collider_slot[a];
+    int slotB = collider_slot[b];
+    return (slotB * (slotB - 1)) / 2 + slotA;
+}
+
+static int test_bit(const unsigned char *bits, int bit)
+{
+    return bits[bit >> 3] & (1 << (bit & 7));
+}
+
+static void set_bit(unsigned char *bits, int bit)
+{
+    bits[bit >> 3] |= (1 << (bit & 7));
+}
+
+static void clear_bit(unsigned char *bits, int bit)
+{
+    bits[bit >> 3] &= ~(1 << (bit & 7));
+}
+
+static void dispatch(const unsigned char *hooks, void (*onCollide)(int index, actor *other, enum collisionEvent event),
+    int a, int b, enum collisionEvent event)
+{
+    if (hooks[b] & event)
+    {
+        onCollide(b, world_actors[a], event);
+        stats.callbacks++;
+    }
+
+    if (hooks[a] & event)
+    {
+        onCollide(a, world_actors[b], event);
+        stats.callbacks++;
+    }
+}
+
+static void refresh_sweep(const unsigned char *hooks, void (*onCollide)(int index, actor *other, enum collisionEvent event))
+{
+    // Contacts with despawned actors end now. A slot respawned since then starts over with an enter.
+    int kept = 0;
+    for (int i = 0; i < active_count; i++)
+    {
+        int a = active_list[i].a;
+        int b = active_list[i].b;
+
+        if ((collider_flags[a] | collider_flags[b]) & COLLIDER_DESPAWNED)
+        {
+            clear_bit(pair_state, pair_bit(a, b));
+            stats.exits++;
+            dispatch(hooks, onCollide, a, b, Exit);
+        }
+        else
+        {
+            active_list[kept++] = active_list[i];
+        }
+    }
+
+    active_count = kept;
+
+    // Keep the surviving order so the insertion sort still starts from a nearly sorted list.
+    int count = 0;
+    for (int i = 0; i < sweep_count; i++)
+    {
+        int index = sweep_list[i];
+
+        if (world_actors[index]->active)
+            sweep_list[count++] = index;
+        else
+            collider_flags[index] &= ~COLLIDER_IN_SWEEP;
+    }
+
+    sweep_count = count;
+
+    for (int i = 0; i < world_actor_count; i++)
+    {
+        collider_flags[i] &= ~COLLIDER_DESPAWNED;
+
+        if (world_actors[i]->active && world_actors[i]->collider != None && !(collider_flags[i] & COLLIDER_IN_SWEEP))
+        {
+            sweep_list[sweep_count++] = i;
+            collider_flags[i] |= COLLIDER_IN_SWEEP;
+        }
+    }
+
+    stats.colliders = sweep_count;
+    sweep_dirty = 0;
+}
+
+void collision_update(const unsigned char *hooks, void (*onCollide)(int index, actor *other, enum collisionEvent event))
+{
+    collision_pair *pairs;
+
+    stats.narrowTests = 0;
+    stats.contacts = 0;
+    stats.enters = 0;
+    stats.exits = 0;
+    stats.callbacks = 0;
+
+    if (sweep_dirty) refresh_sweep(hooks, onCollide);
+
+    int pairCount = collision_broad_phase(&pairs);
+
+    for (int i = 0; i < pairCount; i++)
+    {
+        int a = pairs[i].a;
+        int b = pairs[i].b;
+
+        // Skip pairs where neither actor listens for collision events.
+        if (!hooks[a] && !hooks[b]) continue;
+
+        // Triggers only need their bounds to overlap which the broad phase already found.
+        if (!world_actors[a]->trigger && !world_actors[b]->trigger)
+        {
+            stats.narrowTests++;
+            if (!check_collision(world_actors[a], world_actors[b])) continue;
+        }
+
+        stats.contacts++;
+
+        int bit = pair_bit(a, b);
+        set_bit(pair_seen, bit);
+
+        if (test_bit(pair_state, bit))
+        {
+            dispatch(hooks, onCollide, a, b, Stay);
+        }
+        else
+        {
+            set_bit(pair_state, bit);
+
+            if (active_count == active_capacity) grow_pairs(&active_list, &active_capacity);
+            active_list[active_count++] = pairs[i];
+
+            stats.enters++;
+            dispatch(hooks, onCollide, a, b, Enter);
+        }
+    }
+
+    // Any active pair not seen this frame has separated.
+    int kept = 0;
+    for (int i = 0; i < active_count; i++)
+    {
+        int bit = pair_bit(active_list[i].a, active_list[i].b);
+
+        if (test_bit(pair_seen, bit))
+        {
+            clear_bit(pair_seen, bit);
+            active_list[kept++] = active_list[i];
+        }
+        else
+        {
+            clear_bit(pair_state, bit);
+            stats.exits++;
+            dispatch(hooks, onCollide, active_list[i].a, active_list[i].b, Exit);
+        }
+    }
+
+    active_count = kept;
+}
+
+collision_stats collision_get_stats()
+{
+    return stats;
+}
+
+static int overlap_query(actor *query, actor **results, int maxResults)
+{
+    int found = 0;
+    aabb queryBounds;
+
+    compute_bounds(query, &queryBounds);
+
+    // Bounds reflect the last collision pass and the list is sorted by min x.
+    for (int i = 0; i < sweep_count && found < maxResults; i++)
+    {
+        aabb *bounds = &world_bounds[sweep_list[i]];
+        if (bounds->min.x > queryBounds.max.x) break;
+
+        // Actors despawned since the last pass are still listed until the next update.
+        if (!world_actors[sweep_list[i]]->active) continue;
+
+        if (bounds_overlap(&queryBounds, bounds) && check_collision(query, world_actors[sweep_list[i]]))
+        {
+            results[found++] = world_actors[sweep_list[i]];
+        }
+    }
+
+    return found;
+}
+
+int overlap_sphere(vector3 center, float radius, actor **results, int maxResults)
+{
+    actor query;
+    vector3 origin = { 0, 0, 0 };
+
+    query.collider = Sphere;
+    query.position = &center;
+    query.center = &origin;
+    query.radius = radius;
+    guMtxIdent(&query.transform.rotation);
+
+    return overlap_query(&query, results, maxResults);
+}
+
+int overlap_box(vector3 center, vector3 extents, actor **results, int maxResults)
+{
+    actor query;
+    vector3 origin = { 0, 0, 0 };
+
+    query.collider = Box;
+    query.position = &center;
+    query.center = &origin;
+    query.extents = &extents;
+    guMtxIdent(&query.transform.rotation);
+
+    return overlap_query(&query, results, maxResults);
+}
+
+static int cast(vector3 origin, vector3 direction, float maxDistance, float radius, int mask, raycast_hit *hit)
+{
+    raycast_hit nearest;
+    int found = 0;
+
+    nearest.distance = maxDistance;
+
+    // Casts only run against mesh colliders which is what ground and wall checks use.
+    for (int i = 0; i < sweep_count; i++)
+    {
+        int index = sweep_list[i];
+        actor *target = world_actors[index];
+        if (target->collider != Mesh || !target->active || !(world_layers[index] & mask)) continue;
+
+        if (bvh_cast(target->bvh, origin, direction, nearest.distance, radius, &nearest))
+        {
+            nearest.target = target;
+            found = 1;
+        }
+    }
+
+    if (found && hit != NULL) *hit = nearest;
+    return found;
+}
+
+int raycast(vector3 origin, vector3 direction, float maxDistance, int mask, raycast_hit *hit)
+{
+    return cast(origin, direction, maxDistance, 0, mask, hit);
+}
+
+int sphere_cast(vector3 origin, float radius, vector3 direction, float maxDistance, int mask, raycast_hit *hit)
+{
+    return cast(origin, direction, maxDistance, radius, mask, hit);
+}
+
 int check_collision(actor *a, actor *b)
 {
     if (a->collider == Sphere && b->collider == Sphere)
@@ -11,6 +473,14 @@ int check_collision(actor *a, actor *b)
         return box_sphere_collision(b, a);
     else if (a->collider == Box && b->collider == Box)
         return box_box_collision(a, b);
+    else if (a->collider == Mesh && b->collider == Sphere)
+        return sphere_mesh_collision(a, b);
+    else if (a->collider == Sphere && b->collider == Mesh)
+        return sphere_mesh_collision(b, a);
+    else if (a->collider == Mesh && b->collider == Box)
+        return box_mesh_collision(a, b);
+    else if (a->collider == Box && b->collider == Mesh)
+        return box_mesh_collision(b, a);
     
     return 0;
 }
@@ -140,3 +610,22 @@ int box_sphere_collision(actor *a, actor *b)
     vector3 closestDir = vec3_sub(closestPoint, bPos);
     return vec3_dot(closestDir, closestDir) <= b->radius * b->radius;
 }
+
+int sphere_mesh_collision(actor *a, actor *b)
+{
+    vector3 bPos = vec3_add(*b->position, vec3_mul_mat3x3(*b->center, b->transform.rotation));
+    return bvh_overlap_sphere(a->bvh, bPos, b->radius);
+}
+
+int box_mesh_collision(actor *a, actor *b)
+{
+    vector3 bPos = vec3_add(*b->position, vec3_mul_mat3x3(*b->center, b->transform.rotation));
+
+    vector3 bAxis[3] = {
+        vec3_mul_mat3x3((vector3) { 1, 0, 0 }, b->transform.rotation),
+        vec3_mul_mat3x3((vector3) { 0, 1, 0 }, b->transform.rotation),
+        vec3_mul_mat3x3((vector3) { 0, 0, 1 }, b->transform.rotation)
+    };
+
+    return bvh_overlap_box(a->bvh, bPos, bAxis, *b->extents);
+}
@@ -2,6 +2,53 @@
 #define _COLLISION_H_
 
 #include "actor.h"
+#include "bvh.h"
+
+enum collisionEvent { Enter = 1, Stay = 2, Exit = 4 };
+
+typedef struct aabb
+{
+    vector3 min;
+    vector3 max;
+} aabb;
+
+typedef struct collision_pair
+{
+    int a;
+    int b;
+} collision_pair;
+
+typedef struct collision_stats
+{
+    int colliders;
+    int candidatePairs;
+    int layerRejects;
+    int narrowTests;
+    int contacts;
+    int enters;
+    int exits;
+    int callbacks;
+} collision_stats;
+
+void collision_init(actor **actors, int count, const unsigned short *layers, const unsigned short *masks);
+
+void collision_enable(actor *a);
+
+void collision_disable(actor *a);
+
+int collision_broad_phase(collision_pair **pairs);
+
+void collision_update(const unsigned char *hooks, void (*onCollide)(int index, actor *other, enum collisionEvent event));
+
+collision_stats collision_get_stats();
+
+int overlap_sphere(vector3 center, float radius, actor **results, int maxResults);
+
+int overlap_box(vector3 center, vector3 extents, actor **results, int maxResults);
+
+int raycast(vector3 origin, vector3 direction, float maxDistance, int mask, raycast_hit *hit);
+
+int sphere_cast(vector3 origin, float radius, vector3 direction, float maxDistance, int mask, raycast_hit *hit);
 
 int check_collision(actor *a, actor *b);
 
@@ -11,4 +58,8 @@ int box_box_collision(actor *a, actor *b);
 
 int box_sphere_collision(actor *a, actor *b);
 
+int sphere_mesh_collision(actor *a, actor *b);
+
+int box_mesh_collision(actor *a, actor *b);
+
 #endif
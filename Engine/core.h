@@ -2,18 +2,28 @@
 #define _CORE_H_
 
 #include "actor.h"
+#include "arena.h"
+#include "collision.h"
 #include "hashtable.h"
+#include "level.h"
+#include "pool.h"
+#include "profile.h"
+#include "stream.h"
 
 #define VECTOR3(X, Y, Z) &(vector3) { X, Y, Z }
 
-actor *FindActorByName(const char *name)
+// Generated into scripts.h after the calls it backs. Like everything else in the overlay
+// it's static since each level defines its own.
+static void _UER_Spawn(int prefab, actor *spawned);
+
+static actor *FindActorByName(const char *name)
 {
     nlist *np = lookup(name);
     if (np == NULL) return NULL;
     return _UER_Actors[np->gameObjectIndex];
 }
 
-void SetActiveCamera(actor *camera)
+static void SetActiveCamera(actor *camera)
 {
     if (camera != NULL && camera->type == Camera)
     {
@@ -21,4 +31,123 @@ void SetActiveCamera(actor *camera)
     }
 }
 
+static int OverlapSphere(vector3 *center, float radius, actor **results, int maxResults)
+{
+    return overlap_sphere(*center, radius, results, maxResults);
+}
+
+static int OverlapBox(vector3 *center, vector3 *extents, actor **results, int maxResults)
+{
+    return overlap_box(*center, *extents, results, maxResults);
+}
+
+static int Raycast(vector3 *origin, vector3 *direction, float maxDistance, int mask, raycast_hit *hit)
+{
+    return raycast(*origin, *direction, maxDistance, mask, hit);
+}
+
+static int SphereCast(vector3 *origin, float radius, vector3 *direction, float maxDistance, int mask, raycast_hit *hit)
+{
+    return sphere_cast(*origin, radius, *direction, maxDistance, mask, hit);
+}
+
+static collision_stats GetCollisionStats()
+{
+    return collision_get_stats();
+}
+
+static void *FrameAlloc(int size)
+{
+    return frame_alloc(size);
+}
+
+static memory_stats GetMemoryStats()
+{
+    return memory_get_stats();
+}
+
+static memory_category_stats GetMemoryCategoryStats(enum memoryCategory category)
+{
+    return memory_get_category_stats(category);
+}
+
+static void *HeapAlloc(int size)
+{
+    return heap_alloc(size, MemoryScript);
+}
+
+static void HeapFree(void *pointer)
+{
+    heap_free(pointer);
+}
+
+static asset_stats GetAssetStats()
+{
+    return asset_get_stats();
+}
+
+static int StreamRom(void *romStart, void *romEnd, void *destination, stream_callback callback, void *data)
+{
+    return stream_request(romStart, romEnd, destination, callback, data);
+}
+
+static int StreamsPending()
+{
+    return stream_pending();
+}
+
+static stream_stats GetStreamStats()
+{
+    return stream_get_stats();
+}
+
+static level_stats GetLevelStats()
+{
+    return level_get_stats();
+}
+
+static void LoadLevel(int index)
+{
+    // The switch waits for the main loop since this is running from the overlay it replaces.
+    level_request(index);
+}
+
+static actor *Spawn(actor *prefab, vector3 *position)
+{
+    if (prefab == NULL || prefab->pool == NULL) return NULL;
+
+    actor *spawned = pool_spawn(prefab->pool, *position);
+    if (spawned != NULL) _UER_Spawn(prefab->pool->prefab->index, spawned);
+    return spawned;
+}
+
+static void Despawn(actor *target)
+{
+    if (target != NULL) pool_despawn(target);
+}
+
+static pool_stats GetPoolStats(actor *prefab)
+{
+    return pool_get_stats(prefab != NULL ? prefab->pool : NULL);
+}
+
+static void SaveScriptCosts()
+{
+    // Profiled builds only write costs when asked or when the level changes since every EEPROM
+    // block stalls the game. Does nothing in other builds.
+#ifdef _UER_PROFILE_SCRIPTS
+    script_profile_save();
+#endif
+}
+
+static void SetProfilerOverlay(int enabled)
+{
+    profile_set_overlay(enabled);
+}
+
+static const profile_frame *GetProfileFrame(int framesAgo)
+{
+    return profile_get_frame(framesAgo);
+}
+
 #endif
@@ -1,8 +1,8 @@
 #ifndef _HASHTABLE_H_
 #define _HASHTABLE_H_
 
-#include <malloc.h>
 #include "n64sdk\ultra\GCC\MIPSE\INCLUDE\STRING.H"
+#include "arena.h"
 
 #define HASHSIZE 100
 
@@ -15,7 +15,7 @@ typedef struct nlist
 
 static nlist *hashtable[HASHSIZE];
 
-unsigned hash(const char *s)
+static unsigned hash(const char *s)
 {
     unsigned int hashval;
     for (hashval = 0; *s != '\0'; s++)
@@ -25,7 +25,7 @@ unsigned hash(const char *s)
     return hashval % HASHSIZE;
 }
 
-nlist *lookup(const char *s)
+static nlist *lookup(const char *s)
 {
     nlist *np;
     for (np = hashtable[hash(s)]; np != NULL; np = np->next)
@@ -38,13 +38,20 @@ nlist *lookup(const char *s)
     return NULL;
 }
 
-nlist *insert(const char *name, unsigned int index)
+static void clear_table()
+{
+    memset(hashtable, 0, sizeof(hashtable));
+}
+
+static nlist *insert(const char *name, unsigned int index)
 {
     nlist *np;
     if ((np = lookup(name)) == NULL)
     {
-        np = (nlist*)malloc(sizeof(*np));
-        if (np == NULL || (np->name = strdup(name)) == NULL) return NULL;
+        // Entries live in the level arena and are dropped with it.
+        np = (nlist*)level_alloc(sizeof(*np), MemoryScript);
+        if (np == NULL || (np->name = (char*)level_alloc(strlen(name) + 1, MemoryScript)) == NULL) return NULL;
+        strcpy(np->name, name);
         unsigned int hashval = hash(name);
         np->next = hashtable[hashval];
         hashtable[hashval] = np;
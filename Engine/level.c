@@ -0,0 +1,215 @@
+#include <string.h>
+#include "utilities.h"
+#include "arena.h"
+#include "bvh.h"
+#include "pool.h"
+#include "level.h"
+
+#define NO_SEGMENT -1
+
+typedef struct actor_table_header
+{
+    unsigned short actorCount;
+    unsigned short recordSize;
+} actor_table_header;
+
+// Segment fields index the generated segment table and are NO_SEGMENT when unused.
+typedef struct actor_record
+{
+    unsigned char type;
+    unsigned char collider;
+    unsigned char trigger;
+    unsigned char padding;
+    short mesh;
+    short texture;
+    short tree;
+    unsigned short textureWidth;
+    unsigned short textureHeight;
+    unsigned short poolSize;
+    float position[3];
+    float axis[3];
+    float angle;
+    float scale[3];
+    float center[3];
+    float radius;
+    float extents[3];
+} actor_record;
+
+static level_stats stats;
+static const level_overlay *levels = NULL;
+static int level_count = 0;
+static int requested_level = -1;
+static actor **draw_list = NULL;
+static int *draw_slot = NULL;
+static int draw_count = 0;
+
+void level_init(const level_overlay *overlays, int count)
+{
+    levels = overlays;
+    level_count = count;
+}
+
+void level_request(int index)
+{
+    if (index >= 0 && index < level_count) requested_level = index;
+}
+
+int level_requested()
+{
+    return requested_level;
+}
+
+const level_entry *level_overlay_load(int index)
+{
+    const level_overlay *overlay = &levels[index];
+    requested_level = -1;
+
+    // The previous level's code is overwritten in place so nothing may call into it while this runs.
+    rom_2_ram(overlay->romStart, overlay->textStart, overlay->romEnd - overlay->romStart);
+    osInvalICache(overlay->textStart, overlay->textEnd - overlay->textStart);
+
+    // Zeroing BSS also drops whatever state the last level's scripts left behind.
+    memset(overlay->bssStart, 0, overlay->bssEnd - overlay->bssStart);
+
+    stats.codeBytes = overlay->textEnd - overlay->textStart;
+    stats.dataBytes = overlay->dataEnd - overlay->dataStart;
+    stats.bssBytes = overlay->bssEnd - overlay->bssStart;
+    stats.loads++;
+
+    return overlay->entry;
+}
+
+level_stats level_get_stats()
+{
+    return stats;
+}
+
+static actor *create_actor(const actor_record *record, void *const segments[][2])
+{
+    if (record->type == Camera)
+    {
+        return createCamera(record->position[0], record->position[1], record->position[2],
+            record->axis[0], record->axis[1], record->axis[2], record->angle,
+            record->center[0], record->center[1], record->center[2], record->radius,
+            record->extents[0], record->extents[1], record->extents[2], record->collider, record->trigger);
+    }
+
+    void *const *mesh = segments[record->mesh];
+    actor *model;
+
+    if (record->texture != NO_SEGMENT)
+    {
+        void *const *texture = segments[record->texture];
+        model = streamTexturedModel(mesh[0], mesh[1], texture[0], texture[1],
+            record->textureWidth, record->textureHeight,
+            record->position[0], record->position[1], record->position[2],
+            record->axis[0], record->axis[1], record->axis[2], record->angle,
+            record->scale[0], record->scale[1], record->scale[2],
+            record->center[0], record->center[1], record->center[2], record->radius,
+            record->extents[0], record->extents[1], record->extents[2], record->collider, record->trigger);
+    }
+    else
+    {
+        model = streamModel(mesh[0], mesh[1],
+            record->position[0], record->position[1], record->position[2],
+            record->axis[0], record->axis[1], record->axis[2], record->angle,
+            record->scale[0], record->scale[1], record->scale[2],
+            record->center[0], record->center[1], record->center[2], record->radius,
+            record->extents[0], record->extents[1], record->extents[2], record->collider, record->trigger);
+    }
+
+    if (record->tree != NO_SEGMENT)
+    {
+        model->bvh = bvh_load(segments[record->tree][0], segments[record->tree][1]);
+    }
+
+    return model;
+}
+
+int level_load_actors(void *tableStart, void *tableEnd, void *const segments[][2], actor **actors, int maxActors)
+{
+    int size = tableEnd - tableStart;
+    unsigned char *table = (unsigned char *)heap_alloc(size, MemoryActor);
+    if (table == NULL) return 0;
+
+    // The editor writes the table big endian so the records are used straight from the DMA buffer.
+    rom_2_ram(tableStart, table, size);
+    const actor_table_header *header = (const actor_table_header *)table;
+    const actor_record *records = (const actor_record *)(table + sizeof(actor_table_header));
+
+    // A table from another editor version can't be read safely so leave the level empty.
+    int recordCount = header->recordSize == sizeof(actor_record) ? header->actorCount : 0;
+    int count = 0;
+
+    pool_reset();
+
+    for (int i = 0; i < recordCount; i++)
+    {
+        const actor_record *record = &records[i];
+        int instances = record->type == Model ? record->poolSize : 0;
+        if (count + 1 + instances > maxActors) break;
+
+        actors[count] = create_actor(record, segments);
+        actors[count]->index = count;
+
+        if (instances > 0)
+        {
+            // Instances share the prefab's assets so they only cost their actor. Collision trees are
+            // baked where the prefab sits so the editor refuses mesh colliders on pooled actors.
+            actor_record instance = *record;
+            instance.tree = NO_SEGMENT;
+
+            for (int j = 1; j <= instances; j++)
+            {
+                actors[count + j] = create_actor(&instance, segments);
+                actors[count + j]->index = count + j;
+            }
+
+            pool_create(actors + count, instances);
+        }
+
+        count += 1 + instances;
+    }
+
+    heap_free(table);
+
+    draw_list = (actor **)level_alloc(count * sizeof(actor *), MemoryActor);
+    draw_slot = (int *)level_alloc(count * sizeof(int), MemoryActor);
+    draw_count = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        draw_slot[i] = -1;
+        if (actors[i]->active) level_show(actors[i]);
+    }
+
+    return count;
+}
+
+void level_show(actor *target)
+{
+    if (target->type != Model || draw_slot[target->index] != -1) return;
+
+    draw_slot[target->index] = draw_count;
+    draw_list[draw_count++] = target;
+}
+
+void level_hide(actor *target)
+{
+    int slot = draw_slot[target->index];
+    if (slot == -1) return;
+
+    // Swap the last model into the gap. Order doesn't matter with the depth buffer on.
+    actor *last = draw_list[--draw_count];
+    draw_list[slot] = last;
+    draw_slot[last->index] = slot;
+    draw_slot[target->index] = -1;
+}
+
+void level_draw(Gfx **displayList)
+{
+    for (int i = 0; i < draw_count; i++)
+    {
+        modelDraw(draw_list[i], displayList);
+    }
+}
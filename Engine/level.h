@@ -0,0 +1,70 @@
+#ifndef _LEVEL_H_
+#define _LEVEL_H_
+
+#include <nusys.h>
+#include "actor.h"
+
+// What a level's overlay hands the resident code. Everything else generated for a level is
+// static to it since every level is built from the same names.
+typedef struct level_entry
+{
+    const int *actorCount;
+    actor **actors;
+    actor **activeCamera;
+    const int *backgroundColor;
+    const int *tickRate;
+    const unsigned short *collisionLayers;
+    const unsigned short *collisionMasks;
+    void (*load)();
+    void (*draw)(Gfx **display_list);
+    void (*mappings)();
+    void (*start)();
+    void (*update)(float delta);
+    void (*input)(NUContData gamepads[4]);
+    void (*collide)();
+} level_entry;
+
+// Linker placement of a level's overlay segment. Every level is linked at the same address
+// after the resident code so only one is in RAM at a time and its entry is only valid then.
+typedef struct level_overlay
+{
+    void *romStart;
+    void *romEnd;
+    void *textStart;
+    void *textEnd;
+    void *dataStart;
+    void *dataEnd;
+    void *bssStart;
+    void *bssEnd;
+    const level_entry *entry;
+} level_overlay;
+
+typedef struct level_stats
+{
+    int codeBytes;
+    int dataBytes;
+    int bssBytes;
+    int loads;
+} level_stats;
+
+void level_init(const level_overlay *overlays, int count);
+
+// Only records the level to switch to. The main loop loads it once nothing is running from
+// the current overlay and the last frame drawn from it is done.
+void level_request(int index);
+
+int level_requested();
+
+const level_entry *level_overlay_load(int index);
+
+level_stats level_get_stats();
+
+int level_load_actors(void *tableStart, void *tableEnd, void *const segments[][2], actor **actors, int maxActors);
+
+void level_show(actor *target);
+
+void level_hide(actor *target);
+
+void level_draw(Gfx **displayList);
+
+#endif
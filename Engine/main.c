@@ -1,29 +1,41 @@
 #include <nusys.h>
 #include <math.h>
 #include "utilities.h"
-#include "hashtable.h"
+#include "arena.h"
+#include "stream.h"
+#include "level.h"
+#include "profile.h"
 #include "actor.h"
 #include "collision.h"
-#include "scene.h"
 
 // Generated includes.
 #include "definitions.h"
-#include "segments.h"
-#include "actors.h"
-#include "mappings.h"
-#include "core.h"
-#include "scripts.h"
-#include "collisions.h"
+#include "levels.h"
 
 #define SCREEN_WD 320
 #define SCREEN_HT 240
 #define GFX_GLIST_LEN 2048
 
-char mem_heep[1024 * 512];
+// Ticks that can't be caught up within this many steps are dropped so a long stall
+// doesn't turn into a burst of updates.
+#define MAX_TICKS_PER_FRAME 4
+
+// Level data and per frame scratch come out of their own arenas. The heap is only
+// left for short lived allocations such as texture decoding.
+char mem_heep[1024 * 128];
+char level_memory[1024 * 368];
+char frame_memory[1024 * 16];
 Gfx *glistp;
 Gfx gfx_glist[GFX_GLIST_LEN];
 transform world;
 NUContData contdata[4];
+OSTime tick_cycles;
+OSTime tick_accumulator;
+OSTime last_tick_time;
+float tick_delta;
+
+// Entry of whichever level overlay is in RAM.
+static const level_entry *current_level = NULL;
 
 static Vp view_port =
 {
@@ -58,8 +70,8 @@ void rcp_init()
 
 void clear_frame_buffer()
 {
-    unsigned int backgroundColor = GPACK_RGBA5551(_UER_SceneBackgroundColor[0],
-        _UER_SceneBackgroundColor[1], _UER_SceneBackgroundColor[2], 1);
+    const int *color = current_level->backgroundColor;
+    unsigned int backgroundColor = GPACK_RGBA5551(color[0], color[1], color[2], 1);
 
     gDPSetDepthImage(glistp++, OS_K0_TO_PHYSICAL(nuGfxZBuffer));
     gDPSetCycleType(glistp++, G_CYC_FILL);
@@ -100,63 +112,166 @@ void setup_world_matrix(Gfx **display_list)
 
 void create_display_list()
 {
+    profile_begin(ProfileDisplayList);
     glistp = gfx_glist;
     rcp_init();
     clear_frame_buffer();
     setup_world_matrix(&glistp);
-    _UER_Draw(&glistp);
+    current_level->draw(&glistp);
+    profile_draw(&glistp, SCREEN_WD, *current_level->tickRate);
     gDPFullSync(glistp++);
     gSPEndDisplayList(glistp++);
+    profile_end(ProfileDisplayList);
+
+    profile_begin(ProfileSubmit);
+    profile_task_start();
     nuGfxTaskStart(gfx_glist, (s32)(glistp - gfx_glist) * sizeof(Gfx),
         NU_GFX_UCODE_F3DEX, NU_SC_SWAPBUFFER);
+    profile_end(ProfileSubmit);
+    profile_frame_end();
+}
+
+void gfx_task_end(NUScTask *task)
+{
+    profile_task_end();
 }
 
 void check_inputs()
 {
+    profile_begin(ProfileInput);
     nuContDataGetEx(contdata, 0);
-    _UER_Input(contdata);
+    current_level->input(contdata);
+    profile_end(ProfileInput);
 }
 
 void update_camera()
 {
-    actor *camera = _UER_ActiveCamera;
+    actor *camera = *current_level->activeCamera;
     if (camera != NULL)
     {
-        guTranslate(&world.translation, -camera->position->x, -camera->position->y, camera->position->z);
-        guRotate(&world.rotation, camera->rotationAngle, camera->rotationAxis->x, camera->rotationAxis->y,
-            -camera->rotationAxis->z);
+        vector3 position, rotationAxis;
+        double rotationAngle;
+        actor_interpolate(camera, &position, &rotationAxis, &rotationAngle, NULL);
+
+        guTranslate(&world.translation, -position.x, -position.y, position.z);
+        guRotate(&world.rotation, rotationAngle, rotationAxis.x, rotationAxis.y, -rotationAxis.z);
     }
 }
 
-void gfx_callback(int pendingGfx)
+void init_ticks()
 {
-    if (pendingGfx < 1)
+    int rate = *current_level->tickRate > 0 ? *current_level->tickRate : 30;
+    tick_cycles = OS_USEC_TO_CYCLES(1000000 / rate);
+    tick_delta = 1.0f / rate;
+    tick_accumulator = 0;
+    last_tick_time = osGetTime();
+}
+
+void run_ticks()
+{
+    OSTime now = osGetTime();
+    tick_accumulator += now - last_tick_time;
+    last_tick_time = now;
+
+    for (int ticks = 0; ticks < MAX_TICKS_PER_FRAME && tick_accumulator >= tick_cycles; ticks++)
     {
-        create_display_list();
+        for (int i = 0; i < *current_level->actorCount; i++)
+        {
+            actor_snapshot(current_level->actors[i]);
+        }
+
         check_inputs();
-        update_camera();
-        _UER_Update();
-        _UER_Collide();
+
+        profile_begin(ProfileUpdate);
+        current_level->update(tick_delta);
+        profile_end(ProfileUpdate);
+
+        profile_begin(ProfileCollide);
+        current_level->collide();
+        profile_end(ProfileCollide);
+
+        profile_tick();
+#ifdef _UER_PROFILE_SCRIPTS
+        script_profile_tick();
+#endif
+        tick_accumulator -= tick_cycles;
     }
+
+    // Whatever is still owed past the budget is dropped rather than carried into the next frame.
+    if (tick_accumulator >= tick_cycles) tick_accumulator %= tick_cycles;
 }
 
 int init_heap_memory()
 {
-    return InitHeap(mem_heep, sizeof(mem_heep));
+    memory_init(level_memory, sizeof(level_memory), frame_memory, sizeof(frame_memory));
+    return heap_init(mem_heep, sizeof(mem_heep));
 }
 
 void set_default_camera()
 {
-    for (int i = 0; i < _UER_ActorCount; i++)
+    for (int i = 0; i < *current_level->actorCount; i++)
     {
-        if (_UER_Actors[i]->type == Camera)
+        if (current_level->actors[i]->type == Camera)
         {
-            _UER_ActiveCamera = _UER_Actors[i];
+            *current_level->activeCamera = current_level->actors[i];
             break;
         }
     }
 }
 
+void load_level(int index)
+{
+#ifdef _UER_PROFILE_SCRIPTS
+    // The costs of the level being left go out before the arena holding them is reset.
+    script_profile_save();
+#endif
+
+    // Everything a level allocates lives in the level arena so dropping the previous one is a reset.
+    // Transfers still in flight land in that memory so they have to finish first.
+    stream_flush();
+    level_reset();
+    asset_cache_reset();
+
+    // Scripts, actor tables and the name lookup all live in the overlay. The first one has to be
+    // loaded before the graphics callback is installed since that calls straight into it.
+    current_level = level_overlay_load(index);
+    current_level->load();
+    collision_init(current_level->actors, *current_level->actorCount,
+        current_level->collisionLayers, current_level->collisionMasks);
+    set_default_camera();
+    current_level->mappings();
+#ifdef _UER_PROFILE_SCRIPTS
+    script_profile_init(index, *current_level->actorCount);
+#endif
+    current_level->start();
+    init_ticks();
+}
+
+void gfx_callback(int pendingGfx)
+{
+    // Simulation runs on its own clock every retrace. Rendering only happens when the last
+    // frame is done so it can drop frames under load without slowing gameplay down.
+    frame_reset();
+    stream_update();
+
+    // Scripts only ask for a level switch. It happens here once the RCP is done with the last
+    // frame since its display list still points into the level's memory.
+    if (level_requested() != -1 && pendingGfx < 1)
+    {
+        load_level(level_requested());
+        return;
+    }
+
+    run_ticks();
+
+    if (pendingGfx < 1)
+    {
+        actor_set_interpolation((float)tick_accumulator / tick_cycles);
+        update_camera();
+        create_display_list();
+    }
+}
+
 void mainproc()
 {
     nuGfxInit();
@@ -169,13 +284,13 @@ void mainproc()
 
     if (init_heap_memory() > -1)
     {
-        _UER_Load();
-        set_default_camera();
-        _UER_Mappings();
-        _UER_Start();
+        stream_init();
+        level_init(_UER_Levels, sizeof(_UER_Levels) / sizeof(_UER_Levels[0]));
+        load_level(0);
     }
 
     nuGfxFuncSet((NUGfxFunc)gfx_callback);
+    nuGfxTaskEndFuncSet(gfx_task_end);
     nuGfxDisplayOn();
 
     while (1) { }
@@ -0,0 +1,97 @@
+#include <string.h>
+#include "arena.h"
+#include "collision.h"
+#include "level.h"
+#include "pool.h"
+
+static pool_stats totals;
+
+void pool_reset()
+{
+    memset(&totals, 0, sizeof(totals));
+}
+
+actor_pool *pool_create(actor **actors, int capacity)
+{
+    actor_pool *pool = (actor_pool *)level_alloc(sizeof(actor_pool), MemoryActor);
+    unsigned short *freeSlots = (unsigned short *)level_alloc(capacity * sizeof(unsigned short), MemoryActor);
+    if (pool == NULL || freeSlots == NULL) return NULL;
+
+    pool->prefab = actors[0];
+    pool->instances = actors + 1;
+    pool->freeSlots = freeSlots;
+    pool->freeCount = capacity;
+    memset(&pool->stats, 0, sizeof(pool->stats));
+    pool->stats.pools = 1;
+    pool->stats.capacity = capacity;
+
+    pool->prefab->active = 0;
+    pool->prefab->pool = pool;
+
+    for (int i = 0; i < capacity; i++)
+    {
+        actor *instance = pool->instances[i];
+        instance->active = 0;
+        instance->pool = pool;
+        instance->poolSlot = i;
+
+        // Stacked in reverse so the first spawn takes the first instance.
+        freeSlots[i] = capacity - 1 - i;
+    }
+
+    totals.pools++;
+    totals.capacity += capacity;
+    return pool;
+}
+
+actor *pool_spawn(actor_pool *pool, vector3 position)
+{
+    if (pool->freeCount == 0)
+    {
+        pool->stats.failures++;
+        totals.failures++;
+        return NULL;
+    }
+
+    actor *instance = pool->instances[pool->freeSlots[--pool->freeCount]];
+    actor *prefab = pool->prefab;
+
+    // Start from the prefab's transform so nothing carries over from the slot's last use.
+    *instance->position = position;
+    *instance->rotationAxis = *prefab->rotationAxis;
+    *instance->scale = *prefab->scale;
+    instance->rotationAngle = prefab->rotationAngle;
+    actor_snapshot(instance);
+
+    instance->active = 1;
+    level_show(instance);
+    collision_enable(instance);
+
+    pool->stats.spawns++;
+    if (++pool->stats.active > pool->stats.peak) pool->stats.peak = pool->stats.active;
+    totals.spawns++;
+    if (++totals.active > totals.peak) totals.peak = totals.active;
+
+    return instance;
+}
+
+void pool_despawn(actor *instance)
+{
+    actor_pool *pool = instance->pool;
+    if (pool == NULL || !instance->active || instance == pool->prefab) return;
+
+    instance->active = 0;
+    level_hide(instance);
+    collision_disable(instance);
+    pool->freeSlots[pool->freeCount++] = instance->poolSlot;
+
+    pool->stats.active--;
+    pool->stats.despawns++;
+    totals.active--;
+    totals.despawns++;
+}
+
+pool_stats pool_get_stats(const actor_pool *pool)
+{
+    return pool != NULL ? pool->stats : totals;
+}
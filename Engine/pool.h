@@ -0,0 +1,38 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include "actor.h"
+
+typedef struct pool_stats
+{
+    int pools;
+    int capacity;
+    int active;
+    int peak;
+    int spawns;
+    int despawns;
+    int failures;
+} pool_stats;
+
+// The prefab is the template actor and never spawns itself. Its instances follow it in the
+// actor list and free slots are kept on a stack so spawning and despawning are constant time.
+typedef struct actor_pool
+{
+    actor *prefab;
+    actor **instances;
+    unsigned short *freeSlots;
+    int freeCount;
+    pool_stats stats;
+} actor_pool;
+
+void pool_reset();
+
+actor_pool *pool_create(actor **actors, int capacity);
+
+actor *pool_spawn(actor_pool *pool, vector3 position);
+
+void pool_despawn(actor *instance);
+
+pool_stats pool_get_stats(const actor_pool *pool);
+
+#endif
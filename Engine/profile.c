@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <string.h>
+#include "profile.h"
+#include "arena.h"
+
+#ifdef PROFILE_HOST
+#include <time.h>
+
+// Host builds time with the process clock in place of the CPU counter.
+typedef unsigned int u32;
+#define PROFILE_NOW() ((u32)clock())
+#define PROFILE_TO_USEC(t) ((int)((double)(t) * 1000000.0 / CLOCKS_PER_SEC))
+#else
+// Only the low word of the counter is kept. Deltas stay correct across a wrap and it can be
+// read in one access from the task end callback's thread.
+#define PROFILE_NOW() ((u32)osGetTime())
+#define PROFILE_TO_USEC(t) ((int)OS_CYCLES_TO_USEC((u64)(t)))
+
+// RDP counters tick at the 62.5 MHz RCP clock.
+#define RDP_TO_USEC(c) ((int)((c) * 2 / 125))
+#define OVERLAY_LEFT 16
+#define OVERLAY_TOP 16
+#define OVERLAY_BAR_HEIGHT 4
+#define OVERLAY_MEMORY_TOP (OVERLAY_TOP + (OVERLAY_BAR_HEIGHT + 2) * 3 + 4)
+#endif
+
+static profile_frame history[PROFILE_HISTORY];
+static int history_head = 0;
+static int history_count = 0;
+static u32 section_start[ProfileSectionCount];
+static u32 section_cycles[ProfileSectionCount];
+static int frame_ticks = 0;
+
+// Written on the game thread when a task is submitted and read back when it ends.
+static volatile int task_slot = -1;
+static volatile u32 task_start = 0;
+
+void profile_begin(enum profileSection section)
+{
+    section_start[section] = PROFILE_NOW();
+}
+
+void profile_end(enum profileSection section)
+{
+    section_cycles[section] += PROFILE_NOW() - section_start[section];
+}
+
+void profile_tick()
+{
+    frame_ticks++;
+}
+
+void profile_task_start()
+{
+    // The task results go into the frame being built, which profile_frame_end finishes.
+    history[history_head].usec[ProfileTask] = 0;
+    history[history_head].usec[ProfileRdp] = 0;
+
+#ifndef PROFILE_HOST
+    osDpSetStatus(DPC_CLR_CLOCK_CTR | DPC_CLR_CMD_CTR | DPC_CLR_PIPE_CTR | DPC_CLR_TMEM_CTR);
+#endif
+
+    task_start = PROFILE_NOW();
+    task_slot = history_head;
+}
+
+void profile_frame_end()
+{
+    profile_frame *frame = &history[history_head];
+
+    // Ticks run every retrace but frames only when the last one is done, so a frame owns
+    // every tick since the one before it. The task sections are left to the task end callback
+    // since it can run before this does.
+    for (int i = 0; i < ProfileTask; i++)
+    {
+        frame->usec[i] = PROFILE_TO_USEC(section_cycles[i]);
+        section_cycles[i] = 0;
+    }
+
+    frame->ticks = frame_ticks;
+    frame_ticks = 0;
+
+    history_head = (history_head + 1) % PROFILE_HISTORY;
+    if (history_count < PROFILE_HISTORY) history_count++;
+}
+
+void profile_task_end()
+{
+    int slot = task_slot;
+    if (slot < 0) return;
+
+    history[slot].usec[ProfileTask] = PROFILE_TO_USEC(PROFILE_NOW() - task_start);
+
+#ifndef PROFILE_HOST
+    u32 counters[4];
+    osDpGetCounters(counters);
+    history[slot].usec[ProfileRdp] = RDP_TO_USEC(counters[2]);
+#endif
+
+    task_slot = -1;
+}
+
+const profile_frame *profile_get_frame(int framesAgo)
+{
+    if (framesAgo < 0 || framesAgo >= history_count) return NULL;
+    return &history[(history_head - 1 - framesAgo + PROFILE_HISTORY) % PROFILE_HISTORY];
+}
+
+int profile_format_csv(char *buffer, int framesAgo)
+{
+    const profile_frame *frame = profile_get_frame(framesAgo);
+
+    if (frame == NULL)
+    {
+        return sprintf(buffer, "ticks,input,update,collide,display_list,submit,task,rdp\n");
+    }
+
+    return sprintf(buffer, "%i,%i,%i,%i,%i,%i,%i,%i\n", frame->ticks,
+        frame->usec[ProfileInput], frame->usec[ProfileUpdate], frame->usec[ProfileCollide],
+        frame->usec[ProfileDisplayList], frame->usec[ProfileSubmit], frame->usec[ProfileTask],
+        frame->usec[ProfileRdp]);
+}
+
+#ifdef PROFILE_HOST
+void profile_write_csv(FILE *file)
+{
+    char line[PROFILE_CSV_LINE];
+
+    // Oldest frame first after the header row.
+    profile_format_csv(line, -1);
+    fputs(line, file);
+
+    for (int i = history_count - 1; i >= 0; i--)
+    {
+        profile_format_csv(line, i);
+        fputs(line, file);
+    }
+}
+#else
+static int overlay_enabled = 0;
+
+void profile_set_overlay(int enabled)
+{
+    overlay_enabled = enabled;
+}
+
+static void fill_rect(Gfx **displayList, int left, int top, int width, int height, int r, int g, int b)
+{
+    if (width <= 0) return;
+
+    unsigned int color = GPACK_RGBA5551(r, g, b, 1);
+    gDPSetFillColor((*displayList)++, color << 16 | color);
+    gDPFillRectangle((*displayList)++, left, top, left + width - 1, top + height - 1);
+}
+
+static void draw_memory_bar(Gfx **displayList, int top, int width, int size, int highWater, int heap)
+{
+    static const unsigned char colors[MemoryCategoryCount][3] = {
+        { 0, 128, 255 }, { 255, 0, 255 }, { 0, 255, 0 }, { 255, 128, 0 }, { 255, 255, 0 }
+    };
+
+    if (size <= 0) return;
+
+    // Categories stack over a grey bar for the whole size. Bytes are scaled as floats since
+    // sizes times the width can overflow.
+    fill_rect(displayList, OVERLAY_LEFT, top, width, OVERLAY_BAR_HEIGHT, 64, 64, 64);
+
+    int left = OVERLAY_LEFT;
+    for (int i = 0; i < MemoryCategoryCount; i++)
+    {
+        memory_category_stats stats = memory_get_category_stats(i);
+        int length = (int)((float)(heap ? stats.heapBytes : stats.levelBytes) / size * width);
+        if (left + length > OVERLAY_LEFT + width) length = OVERLAY_LEFT + width - left;
+        fill_rect(displayList, left, top, length, OVERLAY_BAR_HEIGHT, colors[i][0], colors[i][1], colors[i][2]);
+        left += length > 0 ? length : 0;
+    }
+
+    int mark = (int)((float)highWater / size * width);
+    if (mark > width - 1) mark = width - 1;
+    fill_rect(displayList, OVERLAY_LEFT + mark, top - 1, 1, OVERLAY_BAR_HEIGHT + 2, 255, 255, 255);
+}
+
+static void draw_memory(Gfx **displayList, int width)
+{
+    // Level arena then heap, each against its size with a tick at its high-water mark.
+    memory_stats stats = memory_get_stats();
+    draw_memory_bar(displayList, OVERLAY_MEMORY_TOP, width, stats.levelSize, stats.levelHighWater, 0);
+    draw_memory_bar(displayList, OVERLAY_MEMORY_TOP + OVERLAY_BAR_HEIGHT + 2, width, stats.heapSize,
+        stats.heapHighWater, 1);
+}
+
+void profile_draw(Gfx **displayList, int screenWidth, int tickRate)
+{
+    static const unsigned char colors[ProfileSectionCount][3] = {
+        { 255, 255, 0 }, { 0, 255, 0 }, { 255, 128, 0 }, { 0, 128, 255 },
+        { 255, 0, 255 }, { 255, 255, 255 }, { 255, 0, 0 }
+    };
+
+    const profile_frame *frame = profile_get_frame(0);
+    if (!overlay_enabled || frame == NULL) return;
+
+    // One tick's budget spans half the screen so overruns stay visible.
+    int budget = 1000000 / (tickRate > 0 ? tickRate : 30);
+    int width = screenWidth / 2;
+
+    gDPPipeSync((*displayList)++);
+    gDPSetCycleType((*displayList)++, G_CYC_FILL);
+    gDPSetRenderMode((*displayList)++, G_RM_NOOP, G_RM_NOOP2);
+
+    // CPU sections stack on the first bar, the task and RDP get one each below it.
+    int left = OVERLAY_LEFT;
+    for (int i = ProfileInput; i <= ProfileSubmit; i++)
+    {
+        int length = frame->usec[i] * width / budget;
+        if (left + length > screenWidth - OVERLAY_LEFT) length = screenWidth - OVERLAY_LEFT - left;
+        fill_rect(displayList, left, OVERLAY_TOP, length, OVERLAY_BAR_HEIGHT, colors[i][0], colors[i][1], colors[i][2]);
+        left += length > 0 ? length : 0;
+    }
+
+    for (int i = ProfileTask; i <= ProfileRdp; i++)
+    {
+        int top = OVERLAY_TOP + (i - ProfileTask + 1) * (OVERLAY_BAR_HEIGHT + 2);
+        int length = frame->usec[i] * width / budget;
+        if (length > screenWidth - OVERLAY_LEFT * 2) length = screenWidth - OVERLAY_LEFT * 2;
+        fill_rect(displayList, OVERLAY_LEFT, top, length, OVERLAY_BAR_HEIGHT, colors[i][0], colors[i][1], colors[i][2]);
+    }
+
+    // Budget marker through all three bars.
+    fill_rect(displayList, OVERLAY_LEFT + width, OVERLAY_TOP - 2, 1, (OVERLAY_BAR_HEIGHT + 2) * 3 + 2, 255, 255, 255);
+
+    draw_memory(displayList, screenWidth - OVERLAY_LEFT * 2);
+    gDPPipeSync((*displayList)++);
+}
+#endif
+
+#ifdef _UER_PROFILE_SCRIPTS
+// The player saves a 16 Kbit EEPROM to a file the editor reads back. Block zero is a header
+// naming the level the costs are for and every actor slot after it gets a block.
+#define SCRIPT_BLOCK_SIZE 8
+#define SCRIPT_MAX_SLOTS 255
+
+// Each EEPROM block takes around 15 ms to write and blocks the game while it does, so costs are
+// only written when the level is left or a script asks, and then only the blocks that changed.
+
+typedef struct script_cost
+{
+    u64 cycles[ScriptEventCount];
+} script_cost;
+
+static script_cost *script_costs = NULL;
+static int script_slots = 0;
+static int script_level = 0;
+static u32 script_ticks = 0;
+static int eeprom_state = -1;
+
+// What the EEPROM holds from the last save, kept across levels.
+static u8 script_image[(SCRIPT_MAX_SLOTS + 1) * SCRIPT_BLOCK_SIZE];
+static int script_image_blocks = 0;
+
+static void put_short(u8 *buffer, u64 value)
+{
+    if (value > 0xFFFF) value = 0xFFFF;
+    buffer[0] = (u8)(value >> 8);
+    buffer[1] = (u8)(value & 0xFF);
+}
+
+void script_profile_init(int level, int actorCount)
+{
+    if (eeprom_state < 0) eeprom_state = nuEepromMgrInit() == EEPROM_TYPE_16K;
+
+    // The table lives in the level arena so it's dropped along with the level.
+    script_slots = actorCount < SCRIPT_MAX_SLOTS ? actorCount : SCRIPT_MAX_SLOTS;
+    script_costs = level_alloc(script_slots * sizeof(script_cost), MemoryScript);
+    if (script_costs == NULL) script_slots = 0;
+    else memset(script_costs, 0, script_slots * sizeof(script_cost));
+
+    script_level = level;
+    script_ticks = 0;
+}
+
+void script_profile_add(int slot, enum scriptEvent event, u32 cycles)
+{
+    if (slot >= 0 && slot < script_slots) script_costs[slot].cycles[event] += cycles;
+}
+
+void script_profile_tick()
+{
+    script_ticks++;
+}
+
+static void save_block(int index, const u8 *block)
+{
+    u8 *saved = &script_image[index * SCRIPT_BLOCK_SIZE];
+    if (index < script_image_blocks && memcmp(saved, block, SCRIPT_BLOCK_SIZE) == 0) return;
+
+    memcpy(saved, block, SCRIPT_BLOCK_SIZE);
+    nuEepromWrite(index, saved, SCRIPT_BLOCK_SIZE);
+}
+
+void script_profile_save()
+{
+    u8 block[SCRIPT_BLOCK_SIZE];
+
+    if (eeprom_state != 1 || script_costs == NULL) return;
+
+    memcpy(block, "UER", 3);
+    block[3] = (u8)script_level;
+    put_short(&block[4], script_slots);
+    put_short(&block[6], script_ticks);
+    save_block(0, block);
+
+    // Start is the total for the run and the rest are tenths of a microsecond per tick.
+    u32 ticks = script_ticks > 0 ? script_ticks : 1;
+    for (int i = 0; i < script_slots; i++)
+    {
+        const script_cost *cost = &script_costs[i];
+        put_short(&block[0], OS_CYCLES_TO_USEC(cost->cycles[ScriptStart]));
+        put_short(&block[2], OS_CYCLES_TO_USEC(cost->cycles[ScriptUpdate]) * 10 / ticks);
+        put_short(&block[4], OS_CYCLES_TO_USEC(cost->cycles[ScriptInput]) * 10 / ticks);
+        put_short(&block[6], OS_CYCLES_TO_USEC(cost->cycles[ScriptCollide]) * 10 / ticks);
+        save_block(i + 1, block);
+    }
+
+    if (script_slots + 1 > script_image_blocks) script_image_blocks = script_slots + 1;
+}
+#endif
@@ -0,0 +1,76 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#ifndef PROFILE_HOST
+#include <nusys.h>
+#include "definitions.h"
+#else
+#include <stdio.h>
+#endif
+
+#define PROFILE_HISTORY 64
+
+// Longest row profile_format_csv writes, including the terminator.
+#define PROFILE_CSV_LINE 128
+
+// CPU sections are timed with osGetTime. Task is the wall time from submitting the display
+// list to the end of the task and RDP is the time the RDP pipeline was busy during it.
+enum profileSection { ProfileInput, ProfileUpdate, ProfileCollide, ProfileDisplayList,
+    ProfileSubmit, ProfileTask, ProfileRdp, ProfileSectionCount };
+
+typedef struct profile_frame
+{
+    int usec[ProfileSectionCount];
+    int ticks;
+} profile_frame;
+
+void profile_begin(enum profileSection section);
+
+void profile_end(enum profileSection section);
+
+void profile_tick();
+
+// Called right before the display list is submitted so nothing the task does lands before
+// the RDP counters are cleared and its start time is taken.
+void profile_task_start();
+
+void profile_frame_end();
+
+void profile_task_end();
+
+const profile_frame *profile_get_frame(int framesAgo);
+
+// Passing a frame that isn't in the history writes the header row instead.
+int profile_format_csv(char *buffer, int framesAgo);
+
+// Script calls are charged to the actor slot they ran as. Start, update and input are per actor
+// calls and collide covers every collision callback.
+enum scriptEvent { ScriptStart, ScriptUpdate, ScriptInput, ScriptCollide, ScriptEventCount };
+
+#ifdef _UER_PROFILE_SCRIPTS
+#define SCRIPT_PROFILE(slot, event, ...) do { u32 scriptStart = (u32)osGetTime(); __VA_ARGS__; \
+    script_profile_add(slot, event, (u32)osGetTime() - scriptStart); } while (0)
+
+void script_profile_init(int level, int actorCount);
+
+void script_profile_add(int slot, enum scriptEvent event, u32 cycles);
+
+void script_profile_tick();
+
+// Writes whichever of the costs changed since the last save. Called when a level is left and
+// when a script asks with SaveScriptCosts.
+void script_profile_save();
+#else
+// Release builds call scripts directly with nothing left behind.
+#define SCRIPT_PROFILE(slot, event, ...) __VA_ARGS__
+#endif
+
+#ifndef PROFILE_HOST
+void profile_set_overlay(int enabled);
+
+void profile_draw(Gfx **displayList, int screenWidth, int tickRate);
+#else
+void profile_write_csv(FILE *file);
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#include <nusys.h>
+#include "utilities.h"
+#include "arena.h"
+#include "stream.h"
+#include "level.h"
+#include "hashtable.h"
+#include "actor.h"
+#include "collision.h"
+#include "profile.h"
+
+// Everything generated for a level is built into its overlay rather than the resident code.
+// Each level compiles this file against its own directory of generated headers.
+#include "scene.h"
+#include "segments.h"
+#include "actors.h"
+#include "mappings.h"
+#include "core.h"
+#include "scripts.h"
+#include "collisions.h"
+
+// The only symbol a level exports. Its name comes from scene.h so every level's is unique.
+const level_entry _UER_LEVEL_ENTRY =
+{
+    &_UER_ActorCount,
+    _UER_Actors,
+    &_UER_ActiveCamera,
+    _UER_SceneBackgroundColor,
+    &_UER_SceneTickRate,
+    _UER_CollisionLayers,
+    _UER_CollisionMasks,
+    _UER_Load,
+    _UER_Draw,
+    _UER_Mappings,
+    _UER_Start,
+    _UER_Update,
+    _UER_Input,
+    _UER_Collide
+};
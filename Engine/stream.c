@@ -0,0 +1,150 @@
+#include <nusys.h>
+#include "stream.h"
+#include "utilities.h"
+
+// Requests past this many in flight are rejected and callers load them blocking instead.
+#define STREAM_QUEUE_SIZE 64
+
+// Decoding dynamic png blocks keeps a few Huffman tables on the stack.
+#define STREAM_STACK_SIZE 0x4000
+#define STREAM_THREAD_ID 8
+
+// The main thread spins once the game is running so the loader sits just above it to get
+// any time at all, while staying below every nusys manager thread.
+#define STREAM_THREAD_PRI (NU_MAIN_THREAD_PRI + 1)
+
+typedef struct stream_job
+{
+    void *romStart;
+    void *destination;
+    int size;
+    stream_callback process;
+    stream_callback callback;
+    void *data;
+    int active;
+} stream_job;
+
+static stream_job jobs[STREAM_QUEUE_SIZE];
+static int nextJob = 0;
+static stream_stats stats;
+
+static OSMesg requestMessages[STREAM_QUEUE_SIZE];
+static OSMesg doneMessages[STREAM_QUEUE_SIZE];
+static OSMesgQueue requestQueue;
+static OSMesgQueue doneQueue;
+static OSThread streamThread;
+static u64 streamStack[STREAM_STACK_SIZE / sizeof(u64)];
+
+static void stream_thread(void *arg)
+{
+    OSMesg message;
+
+    while (1)
+    {
+        osRecvMesg(&requestQueue, &message, OS_MESG_BLOCK);
+        stream_job *job = (stream_job *)message;
+
+        // Only this thread waits on the PI so frames keep rendering during the transfer.
+        rom_2_ram(job->romStart, job->destination, job->size);
+        if (job->process != NULL) job->process(job->destination, job->size, job->data);
+        osSendMesg(&doneQueue, message, OS_MESG_BLOCK);
+    }
+}
+
+void stream_init()
+{
+    osCreateMesgQueue(&requestQueue, requestMessages, STREAM_QUEUE_SIZE);
+    osCreateMesgQueue(&doneQueue, doneMessages, STREAM_QUEUE_SIZE);
+    osCreateThread(&streamThread, STREAM_THREAD_ID, stream_thread, NULL,
+        streamStack + STREAM_STACK_SIZE / sizeof(u64), STREAM_THREAD_PRI);
+    osStartThread(&streamThread);
+}
+
+int stream_request(void *romStart, void *romEnd, void *destination, stream_callback callback, void *data)
+{
+    return stream_request_process(romStart, romEnd, destination, NULL, callback, data);
+}
+
+int stream_request_process(void *romStart, void *romEnd, void *destination, stream_callback process,
+    stream_callback callback, void *data)
+{
+    int size = romEnd - romStart;
+    stream_job *job = NULL;
+
+    // Jobs are only claimed and released on the game thread so the slots need no locking.
+    for (int i = 0; i < STREAM_QUEUE_SIZE && job == NULL; i++)
+    {
+        stream_job *candidate = &jobs[(nextJob + i) % STREAM_QUEUE_SIZE];
+        if (!candidate->active) job = candidate;
+    }
+
+    if (job == NULL || size <= 0 || destination == NULL)
+    {
+        stats.rejected++;
+        return 0;
+    }
+
+    nextJob = (job - jobs + 1) % STREAM_QUEUE_SIZE;
+    job->romStart = romStart;
+    job->destination = destination;
+    job->size = size;
+    job->process = process;
+    job->callback = callback;
+    job->data = data;
+    job->active = 1;
+
+    stats.queued++;
+    stats.pending++;
+
+    // Both queues hold every slot so neither send can block.
+    osSendMesg(&requestQueue, (OSMesg)job, OS_MESG_NOBLOCK);
+    return 1;
+}
+
+static void complete_job(stream_job *job)
+{
+    stream_callback callback = job->callback;
+    void *destination = job->destination;
+    void *data = job->data;
+    int size = job->size;
+
+    // Release the slot first so the callback can queue follow up requests.
+    job->active = 0;
+    stats.pending--;
+    stats.completed++;
+    stats.bytesRead += size;
+
+    if (callback != NULL) callback(destination, size, data);
+}
+
+void stream_update()
+{
+    OSMesg message;
+
+    while (osRecvMesg(&doneQueue, &message, OS_MESG_NOBLOCK) != -1)
+    {
+        complete_job((stream_job *)message);
+    }
+}
+
+void stream_flush()
+{
+    OSMesg message;
+
+    // Callbacks may queue more work so keep going until nothing is left in flight.
+    while (stats.pending > 0)
+    {
+        osRecvMesg(&doneQueue, &message, OS_MESG_BLOCK);
+        complete_job((stream_job *)message);
+    }
+}
+
+int stream_pending()
+{
+    return stats.pending;
+}
+
+stream_stats stream_get_stats()
+{
+    return stats;
+}
@@ -0,0 +1,32 @@
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+// Called on the game thread once the data has landed in RAM. Processing callbacks run before
+// it on the stream thread so they can only touch the data and the level arena and heap.
+typedef void (*stream_callback)(void *destination, int size, void *data);
+
+typedef struct stream_stats
+{
+    int queued;
+    int completed;
+    int pending;
+    int rejected;
+    int bytesRead;
+} stream_stats;
+
+void stream_init();
+
+int stream_request(void *romStart, void *romEnd, void *destination, stream_callback callback, void *data);
+
+int stream_request_process(void *romStart, void *romEnd, void *destination, stream_callback process,
+    stream_callback callback, void *data);
+
+void stream_update();
+
+void stream_flush();
+
+int stream_pending();
+
+stream_stats stream_get_stats();
+
+#endif
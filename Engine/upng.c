@@ -31,6 +31,11 @@ freely, subject to the following restrictions:
 #include <malloc.h>
 
 #include "upng.h"
+#include "arena.h"
+
+/* Decoding buffers are charged to textures in the engine's heap tracking. */
+#define malloc(size) heap_alloc(size, MemoryTexture)
+#define free(pointer) heap_free(pointer)
 
 #define MAKE_BYTE(b) ((b) & 0xFF)
 #define MAKE_DWORD(a,b,c,d) ((MAKE_BYTE(a) << 24) | (MAKE_BYTE(b) << 16) | (MAKE_BYTE(c) << 8) | MAKE_BYTE(d))
@@ -48,14 +53,12 @@ freely, subject to the following restrictions:
 #define NUM_CODE_LENGTH_CODES 19	/*the code length codes. 0-15: code lengths, 16: copy previous 3-6 times, 17: 3-10 zeros, 18: 11-138 zeros */
 #define MAX_SYMBOLS 288 /* largest number of symbols used by any tree type */
 
-#define DEFLATE_CODE_BITLEN 15
-#define DISTANCE_BITLEN 15
-#define CODE_LENGTH_BITLEN 7
 #define MAX_BIT_LENGTH 15 /* largest bitlen used by any tree type */
 
-#define DEFLATE_CODE_BUFFER_SIZE (NUM_DEFLATE_CODE_SYMBOLS * 2)
-#define DISTANCE_BUFFER_SIZE (NUM_DISTANCE_SYMBOLS * 2)
-#define CODE_LENGTH_BUFFER_SIZE (NUM_DISTANCE_SYMBOLS * 2)
+#define HUFFMAN_FAST_BITS 9	/*codes up to this length decode with a single table lookup */
+#define HUFFMAN_FAST_SIZE (1 << HUFFMAN_FAST_BITS)
+
+#define BIT_READER_REFILL 24	/*the bit buffer is topped up until it holds more bits than this */
 
 #define SET_ERROR(upng,code) do { (upng)->error = (code); (upng)->error_line = __LINE__; } while (0)
 
@@ -101,11 +104,23 @@ struct upng_t {
 	upng_source		source;
 };
 
-typedef struct huffman_tree {
-	unsigned* tree2d;
-	unsigned maxbitlen;	/*maximum number of bits a single code can get */
-	unsigned numcodes;	/*number of symbols in the alphabet = number of codes */
-} huffman_tree;
+typedef struct bit_reader {
+	const unsigned char* in;
+	unsigned long	size;	/*number of bytes in the input */
+	unsigned long	pos;	/*next byte to load, may run past size once the input is exhausted */
+	unsigned long	buffer;	/*pending bits, the next bit to read is the lsb */
+	unsigned		count;	/*number of valid bits in buffer */
+} bit_reader;
+
+typedef struct huffman_table {
+	unsigned short	fast[HUFFMAN_FAST_SIZE];	/*indexed by the next HUFFMAN_FAST_BITS of input: (length << HUFFMAN_FAST_BITS) | symbol, 0 if the code is longer */
+	unsigned short	firstcode[MAX_BIT_LENGTH + 1];	/*first canonical code of each length */
+	unsigned short	firstsymbol[MAX_BIT_LENGTH + 1];	/*index in symbols[] of the first code of each length */
+	unsigned long	limit[MAX_BIT_LENGTH + 2];	/*codes of each length are below this value when left aligned to 16 bits */
+	unsigned short	symbols[MAX_SYMBOLS];	/*symbols sorted by code */
+	unsigned char	lengths[MAX_SYMBOLS];	/*code length of each entry in symbols[] */
+	unsigned		numsymbols;
+} huffman_table;
 
 static const unsigned LENGTH_BASE[29] = {	/*the base lengths represented by codes 257-285 */
 	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
@@ -130,204 +145,222 @@ static const unsigned DISTANCE_EXTRA[30] = {	/*the extra bits of backwards dista
 static const unsigned CLCL[NUM_CODE_LENGTH_CODES]	/*the order in which "code length alphabet code lengths" are stored, out of this the huffman tree of the dynamic huffman tree lengths is generated */
 = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
 
-static const unsigned FIXED_DEFLATE_CODE_TREE[NUM_DEFLATE_CODE_SYMBOLS * 2] = {
-	289, 370, 290, 307, 546, 291, 561, 292, 293, 300, 294, 297, 295, 296, 0, 1,
-	2, 3, 298, 299, 4, 5, 6, 7, 301, 304, 302, 303, 8, 9, 10, 11, 305, 306, 12,
-	13, 14, 15, 308, 339, 309, 324, 310, 317, 311, 314, 312, 313, 16, 17, 18,
-	19, 315, 316, 20, 21, 22, 23, 318, 321, 319, 320, 24, 25, 26, 27, 322, 323,
-	28, 29, 30, 31, 325, 332, 326, 329, 327, 328, 32, 33, 34, 35, 330, 331, 36,
-	37, 38, 39, 333, 336, 334, 335, 40, 41, 42, 43, 337, 338, 44, 45, 46, 47,
-	340, 355, 341, 348, 342, 345, 343, 344, 48, 49, 50, 51, 346, 347, 52, 53,
-	54, 55, 349, 352, 350, 351, 56, 57, 58, 59, 353, 354, 60, 61, 62, 63, 356,
-	363, 357, 360, 358, 359, 64, 65, 66, 67, 361, 362, 68, 69, 70, 71, 364,
-	367, 365, 366, 72, 73, 74, 75, 368, 369, 76, 77, 78, 79, 371, 434, 372,
-	403, 373, 388, 374, 381, 375, 378, 376, 377, 80, 81, 82, 83, 379, 380, 84,
-	85, 86, 87, 382, 385, 383, 384, 88, 89, 90, 91, 386, 387, 92, 93, 94, 95,
-	389, 396, 390, 393, 391, 392, 96, 97, 98, 99, 394, 395, 100, 101, 102, 103,
-	397, 400, 398, 399, 104, 105, 106, 107, 401, 402, 108, 109, 110, 111, 404,
-	419, 405, 412, 406, 409, 407, 408, 112, 113, 114, 115, 410, 411, 116, 117,
-	118, 119, 413, 416, 414, 415, 120, 121, 122, 123, 417, 418, 124, 125, 126,
-	127, 420, 427, 421, 424, 422, 423, 128, 129, 130, 131, 425, 426, 132, 133,
-	134, 135, 428, 431, 429, 430, 136, 137, 138, 139, 432, 433, 140, 141, 142,
-	143, 435, 483, 436, 452, 568, 437, 438, 445, 439, 442, 440, 441, 144, 145,
-	146, 147, 443, 444, 148, 149, 150, 151, 446, 449, 447, 448, 152, 153, 154,
-	155, 450, 451, 156, 157, 158, 159, 453, 468, 454, 461, 455, 458, 456, 457,
-	160, 161, 162, 163, 459, 460, 164, 165, 166, 167, 462, 465, 463, 464, 168,
-	169, 170, 171, 466, 467, 172, 173, 174, 175, 469, 476, 470, 473, 471, 472,
-	176, 177, 178, 179, 474, 475, 180, 181, 182, 183, 477, 480, 478, 479, 184,
-	185, 186, 187, 481, 482, 188, 189, 190, 191, 484, 515, 485, 500, 486, 493,
-	487, 490, 488, 489, 192, 193, 194, 195, 491, 492, 196, 197, 198, 199, 494,
-	497, 495, 496, 200, 201, 202, 203, 498, 499, 204, 205, 206, 207, 501, 508,
-	502, 505, 503, 504, 208, 209, 210, 211, 506, 507, 212, 213, 214, 215, 509,
-	512, 510, 511, 216, 217, 218, 219, 513, 514, 220, 221, 222, 223, 516, 531,
-	517, 524, 518, 521, 519, 520, 224, 225, 226, 227, 522, 523, 228, 229, 230,
-	231, 525, 528, 526, 527, 232, 233, 234, 235, 529, 530, 236, 237, 238, 239,
-	532, 539, 533, 536, 534, 535, 240, 241, 242, 243, 537, 538, 244, 245, 246,
-	247, 540, 543, 541, 542, 248, 249, 250, 251, 544, 545, 252, 253, 254, 255,
-	547, 554, 548, 551, 549, 550, 256, 257, 258, 259, 552, 553, 260, 261, 262,
-	263, 555, 558, 556, 557, 264, 265, 266, 267, 559, 560, 268, 269, 270, 271,
-	562, 565, 563, 564, 272, 273, 274, 275, 566, 567, 276, 277, 278, 279, 569,
-	572, 570, 571, 280, 281, 282, 283, 573, 574, 284, 285, 286, 287, 0, 0
+/*code lengths of the fixed trees (btype 1) as given by the deflate spec */
+static const unsigned char FIXED_CODE_LENGTH_RUNS[4][2] = {
+	{ 144, 8 }, { 112, 9 }, { 24, 7 }, { 8, 8 }
 };
 
-static const unsigned FIXED_DISTANCE_TREE[NUM_DISTANCE_SYMBOLS * 2] = {
-	33, 48, 34, 41, 35, 38, 36, 37, 0, 1, 2, 3, 39, 40, 4, 5, 6, 7, 42, 45, 43,
-	44, 8, 9, 10, 11, 46, 47, 12, 13, 14, 15, 49, 56, 50, 53, 51, 52, 16, 17,
-	18, 19, 54, 55, 20, 21, 22, 23, 57, 60, 58, 59, 24, 25, 26, 27, 61, 62, 28,
-	29, 30, 31, 0, 0
-};
+#define FIXED_DISTANCE_LENGTH 5
+
+static huffman_table fixed_code_table;
+static huffman_table fixed_distance_table;
+static int fixed_tables_ready = 0;
 
-static unsigned char read_bit(unsigned long *bitpointer, const unsigned char *bitstream)
+static void bit_reader_init(bit_reader* br, const unsigned char* in, unsigned long size)
 {
-	unsigned char result = (unsigned char)((bitstream[(*bitpointer) >> 3] >> ((*bitpointer) & 0x7)) & 1);
-	(*bitpointer)++;
-	return result;
+	br->in = in;
+	br->size = size;
+	br->pos = 0;
+	br->buffer = 0;
+	br->count = 0;
 }
 
-static unsigned read_bits(unsigned long *bitpointer, const unsigned char *bitstream, unsigned long nbits)
+/*top up the buffer a byte at a time, feeding zeros once the input is exhausted so the hot paths never bounds check */
+static void bit_reader_refill(bit_reader* br)
 {
-	unsigned result = 0, i;
-	for (i = 0; i < nbits; i++)
-		result |= ((unsigned)read_bit(bitpointer, bitstream)) << i;
-	return result;
+	while (br->count <= BIT_READER_REFILL) {
+		unsigned long byte = br->pos < br->size ? br->in[br->pos] : 0;
+		br->buffer |= byte << br->count;
+		br->count += 8;
+		br->pos++;
+	}
 }
 
-/* the buffer must be numcodes*2 in size! */
-static void huffman_tree_init(huffman_tree* tree, unsigned* buffer, unsigned numcodes, unsigned maxbitlen)
+/*true once bits past the end of the input have been consumed */
+static int bit_reader_overrun(const bit_reader* br)
 {
-	tree->tree2d = buffer;
+	return br->pos * 8 - br->count > br->size * 8;
+}
+
+static unsigned read_bits(bit_reader* br, unsigned nbits)
+{
+	unsigned result;
 
-	tree->numcodes = numcodes;
-	tree->maxbitlen = maxbitlen;
+	if (br->count < nbits) {
+		bit_reader_refill(br);
+	}
+
+	result = (unsigned)(br->buffer & ((1UL << nbits) - 1));
+	br->buffer >>= nbits;
+	br->count -= nbits;
+	return result;
 }
 
-/*given the code lengths (as stored in the PNG file), generate the tree as defined by Deflate. maxbitlen is the maximum bits that a code in the tree can have. return value is error.*/
-static void huffman_tree_create_lengths(upng_t* upng, huffman_tree* tree, const unsigned *bitlen)
+static unsigned reverse_bits(unsigned code, unsigned nbits)
 {
-	unsigned tree1d[MAX_SYMBOLS];
-	unsigned blcount[MAX_BIT_LENGTH];
-	unsigned nextcode[MAX_BIT_LENGTH+1];
-	unsigned bits, n, i;
-	unsigned nodefilled = 0;	/*up to which node it is filled */
-	unsigned treepos = 0;	/*position in the tree (1 of the numcodes columns) */
-
-	/* initialize local vectors */
+	/* swap progressively larger groups, then drop the bits past nbits */
+	code = ((code & 0xAAAA) >> 1) | ((code & 0x5555) << 1);
+	code = ((code & 0xCCCC) >> 2) | ((code & 0x3333) << 2);
+	code = ((code & 0xF0F0) >> 4) | ((code & 0x0F0F) << 4);
+	code = ((code & 0xFF00) >> 8) | ((code & 0x00FF) << 8);
+	return code >> (16 - nbits);
+}
+
+/*given the code lengths (as stored in the PNG file), generate the canonical codes as defined by Deflate and the lookup tables to decode them*/
+static void huffman_table_create_lengths(upng_t* upng, huffman_table* table, const unsigned *bitlen, unsigned numcodes)
+{
+	unsigned blcount[MAX_BIT_LENGTH + 1];
+	unsigned nextcode[MAX_BIT_LENGTH + 1];
+	unsigned code = 0, symbols = 0;
+	unsigned bits, n;
+
 	memset(blcount, 0, sizeof(blcount));
-	memset(nextcode, 0, sizeof(nextcode));
+	memset(table->fast, 0, sizeof(table->fast));
 
 	/*step 1: count number of instances of each code length */
-	for (bits = 0; bits < tree->numcodes; bits++) {
-		blcount[bitlen[bits]]++;
+	for (n = 0; n < numcodes; n++) {
+		blcount[bitlen[n]]++;
 	}
+	blcount[0] = 0;
 
-	/*step 2: generate the nextcode values */
-	for (bits = 1; bits <= tree->maxbitlen; bits++) {
-		nextcode[bits] = (nextcode[bits - 1] + blcount[bits - 1]) << 1;
-	}
+	/*step 2: generate the first code of each length, rejecting oversubscribed lengths */
+	for (bits = 1; bits <= MAX_BIT_LENGTH; bits++) {
+		nextcode[bits] = code;
+		table->firstcode[bits] = (unsigned short)code;
+		table->firstsymbol[bits] = (unsigned short)symbols;
 
-	/*step 3: generate all the codes */
-	for (n = 0; n < tree->numcodes; n++) {
-		if (bitlen[n] != 0) {
-			tree1d[n] = nextcode[bitlen[n]]++;
+		code += blcount[bits];
+		if (code > (1U << bits)) {
+			SET_ERROR(upng, UPNG_EMALFORMED);
+			return;
 		}
-	}
 
-	/*convert tree1d[] to tree2d[][]. In the 2D array, a value of 32767 means uninited, a value >= numcodes is an address to another bit, a value < numcodes is a code. The 2 rows are the 2 possible bit values (0 or 1), there are as many columns as codes - 1
-	   a good huffmann tree has N * 2 - 1 nodes, of which N - 1 are internal nodes. Here, the internal nodes are stored (what their 0 and 1 option point to). There is only memory for such good tree currently, if there are more nodes (due to too long length codes), error 55 will happen */
-	for (n = 0; n < tree->numcodes * 2; n++) {
-		tree->tree2d[n] = 32767;	/*32767 here means the tree2d isn't filled there yet */
+		table->limit[bits] = (unsigned long)code << (16 - bits);
+		symbols += blcount[bits];
+		code <<= 1;
 	}
+	table->limit[MAX_BIT_LENGTH + 1] = 0x10000;	/*sentinel, no 16 bit value reaches it */
+	table->numsymbols = symbols;
 
-	for (n = 0; n < tree->numcodes; n++) {	/*the codes */
-		for (i = 0; i < bitlen[n]; i++) {	/*the bits for this code */
-			unsigned char bit = (unsigned char)((tree1d[n] >> (bitlen[n] - i - 1)) & 1);
-			/* check if oversubscribed */
-			if (treepos > tree->numcodes - 2) {
-				SET_ERROR(upng, UPNG_EMALFORMED);
-				return;
-			}
+	/*step 3: assign the codes; short ones are replicated through every fast slot that starts with them (lsb first) */
+	for (n = 0; n < numcodes; n++) {
+		unsigned length = bitlen[n];
+		unsigned index;
 
-			if (tree->tree2d[2 * treepos + bit] == 32767) {	/*not yet filled in */
-				if (i + 1 == bitlen[n]) {	/*last bit */
-					tree->tree2d[2 * treepos + bit] = n;	/*put the current code in it */
-					treepos = 0;
-				} else {	/*put address of the next step in here, first that address has to be found of course (it's just nodefilled + 1)... */
-					nodefilled++;
-					tree->tree2d[2 * treepos + bit] = nodefilled + tree->numcodes;	/*addresses encoded with numcodes added to it */
-					treepos = nodefilled;
-				}
-			} else {
-				treepos = tree->tree2d[2 * treepos + bit] - tree->numcodes;
+		if (length == 0) {
+			continue;
+		}
+
+		index = table->firstsymbol[length] + nextcode[length] - table->firstcode[length];
+		table->symbols[index] = (unsigned short)n;
+		table->lengths[index] = (unsigned char)length;
+
+		if (length <= HUFFMAN_FAST_BITS) {
+			unsigned slot;
+			for (slot = reverse_bits(nextcode[length], length); slot < HUFFMAN_FAST_SIZE; slot += 1U << length) {
+				table->fast[slot] = (unsigned short)((length << HUFFMAN_FAST_BITS) | n);
 			}
 		}
+
+		nextcode[length]++;
 	}
+}
 
-	for (n = 0; n < tree->numcodes * 2; n++) {
-		if (tree->tree2d[n] == 32767) {
-			tree->tree2d[n] = 0;	/*remove possible remaining 32767's */
+static void huffman_create_fixed_tables(upng_t* upng)
+{
+	unsigned bitlen[NUM_DEFLATE_CODE_SYMBOLS];
+	unsigned n = 0, run, i;
+
+	for (run = 0; run < 4; run++) {
+		for (i = 0; i < FIXED_CODE_LENGTH_RUNS[run][0]; i++) {
+			bitlen[n++] = FIXED_CODE_LENGTH_RUNS[run][1];
 		}
 	}
+	huffman_table_create_lengths(upng, &fixed_code_table, bitlen, NUM_DEFLATE_CODE_SYMBOLS);
+
+	for (n = 0; n < NUM_DISTANCE_SYMBOLS; n++) {
+		bitlen[n] = FIXED_DISTANCE_LENGTH;
+	}
+	huffman_table_create_lengths(upng, &fixed_distance_table, bitlen, NUM_DISTANCE_SYMBOLS);
+
+	fixed_tables_ready = upng->error == UPNG_EOK;
 }
 
-static unsigned huffman_decode_symbol(upng_t *upng, const unsigned char *in, unsigned long *bp, const huffman_tree* codetree, unsigned long inlength)
+static unsigned huffman_decode_symbol(upng_t *upng, bit_reader* br, const huffman_table* table)
 {
-	unsigned treepos = 0, ct;
-	unsigned char bit;
-	for (;;) {
+	unsigned entry, code, length, index;
+
+	if (br->count < MAX_BIT_LENGTH) {
+		bit_reader_refill(br);
+
 		/* error: end of input memory reached without endcode */
-		if (((*bp) & 0x07) == 0 && ((*bp) >> 3) > inlength) {
+		if (bit_reader_overrun(br)) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
 			return 0;
 		}
+	}
 
-		bit = read_bit(bp, in);
+	/* most codes resolve with a single lookup */
+	entry = table->fast[br->buffer & (HUFFMAN_FAST_SIZE - 1)];
+	if (entry != 0) {
+		length = entry >> HUFFMAN_FAST_BITS;
+		br->buffer >>= length;
+		br->count -= length;
+		return entry & (HUFFMAN_FAST_SIZE - 1);
+	}
 
-		ct = codetree->tree2d[(treepos << 1) | bit];
-		if (ct < codetree->numcodes) {
-			return ct;
-		}
+	/* longer codes: find the length whose range holds the next 16 bits read msb first */
+	code = reverse_bits((unsigned)(br->buffer & 0xFFFF), 16);
+	for (length = HUFFMAN_FAST_BITS + 1; code >= table->limit[length]; length++)
+		;
 
-		treepos = ct - codetree->numcodes;
-		if (treepos >= codetree->numcodes) {
-			SET_ERROR(upng, UPNG_EMALFORMED);
-			return 0;
-		}
+	if (length > MAX_BIT_LENGTH) {
+		SET_ERROR(upng, UPNG_EMALFORMED);
+		return 0;
 	}
+
+	index = (code >> (16 - length)) - table->firstcode[length] + table->firstsymbol[length];
+	if (index >= table->numsymbols || table->lengths[index] != length) {
+		SET_ERROR(upng, UPNG_EMALFORMED);
+		return 0;
+	}
+
+	br->buffer >>= length;
+	br->count -= length;
+	return table->symbols[index];
 }
 
 /* get the tree of a deflated block with dynamic tree, the tree itself is also Huffman compressed with a known tree*/
-static void get_tree_inflate_dynamic(upng_t* upng, huffman_tree* codetree, huffman_tree* codetreeD, huffman_tree* codelengthcodetree, const unsigned char *in, unsigned long *bp, unsigned long inlength)
+static void get_tree_inflate_dynamic(upng_t* upng, huffman_table* codetable, huffman_table* codetableD, bit_reader* br)
 {
+	huffman_table codelengthcodetable;
 	unsigned codelengthcode[NUM_CODE_LENGTH_CODES];
 	unsigned bitlen[NUM_DEFLATE_CODE_SYMBOLS];
 	unsigned bitlenD[NUM_DISTANCE_SYMBOLS];
 	unsigned n, hlit, hdist, hclen, i;
 
-	/*make sure that length values that aren't filled in will be 0, or a wrong tree will be generated */
-	/*C-code note: use no "return" between ctor and dtor of an uivector! */
-	if ((*bp) >> 3 >= inlength - 2) {
-		SET_ERROR(upng, UPNG_EMALFORMED);
-		return;
-	}
-
-	/* clear bitlen arrays */
+	/* clear bitlen arrays so that length values that aren't filled in will be 0, or a wrong tree will be generated */
 	memset(bitlen, 0, sizeof(bitlen));
 	memset(bitlenD, 0, sizeof(bitlenD));
 
-	/*the bit pointer is or will go past the memory */
-	hlit = read_bits(bp, in, 5) + 257;	/*number of literal/length codes + 257. Unlike the spec, the value 257 is added to it here already */
-	hdist = read_bits(bp, in, 5) + 1;	/*number of distance codes. Unlike the spec, the value 1 is added to it here already */
-	hclen = read_bits(bp, in, 4) + 4;	/*number of code length codes. Unlike the spec, the value 4 is added to it here already */
+	hlit = read_bits(br, 5) + 257;	/*number of literal/length codes + 257. Unlike the spec, the value 257 is added to it here already */
+	hdist = read_bits(br, 5) + 1;	/*number of distance codes. Unlike the spec, the value 1 is added to it here already */
+	hclen = read_bits(br, 4) + 4;	/*number of code length codes. Unlike the spec, the value 4 is added to it here already */
+
+	if (hlit > NUM_DEFLATE_CODE_SYMBOLS || hdist > NUM_DISTANCE_SYMBOLS) {
+		SET_ERROR(upng, UPNG_EMALFORMED);
+		return;
+	}
 
 	for (i = 0; i < NUM_CODE_LENGTH_CODES; i++) {
 		if (i < hclen) {
-			codelengthcode[CLCL[i]] = read_bits(bp, in, 3);
+			codelengthcode[CLCL[i]] = read_bits(br, 3);
 		} else {
 			codelengthcode[CLCL[i]] = 0;	/*if not, it must stay 0 */
 		}
 	}
 
-	huffman_tree_create_lengths(upng, codelengthcodetree, codelengthcode);
+	huffman_table_create_lengths(upng, &codelengthcodetable, codelengthcode, NUM_CODE_LENGTH_CODES);
 
 	/* bail now if we encountered an error earlier */
 	if (upng->error != UPNG_EOK) {
@@ -337,7 +370,9 @@ static void get_tree_inflate_dynamic(upng_t* upng, huffman_tree* codetree, huffm
 	/*now we can use this tree to read the lengths for the tree that this function will return */
 	i = 0;
 	while (i < hlit + hdist) {	/*i is the current symbol we're reading in the part that contains the code lengths of lit/len codes and dist codes */
-		unsigned code = huffman_decode_symbol(upng, in, bp, codelengthcodetree, inlength);
+		unsigned code = huffman_decode_symbol(upng, br, &codelengthcodetable);
+		unsigned replength, value;
+
 		if (upng->error != UPNG_EOK) {
 			break;
 		}
@@ -349,142 +384,98 @@ static void get_tree_inflate_dynamic(upng_t* upng, huffman_tree* codetree, huffm
 				bitlenD[i - hlit] = code;
 			}
 			i++;
-		} else if (code == 16) {	/*repeat previous */
-			unsigned replength = 3;	/*read in the 2 bits that indicate repeat length (3-6) */
-			unsigned value;	/*set value to the previous code */
+			continue;
+		}
 
-			if ((*bp) >> 3 >= inlength) {
+		if (code == 16) {	/*repeat previous 3-6 times */
+			/* error: there is no previous length */
+			if (i == 0) {
 				SET_ERROR(upng, UPNG_EMALFORMED);
 				break;
 			}
-			/*error, bit pointer jumps past memory */
-			replength += read_bits(bp, in, 2);
 
-			if ((i - 1) < hlit) {
-				value = bitlen[i - 1];
-			} else {
-				value = bitlenD[i - hlit - 1];
-			}
-
-			/*repeat this value in the next lengths */
-			for (n = 0; n < replength; n++) {
-				/* i is larger than the amount of codes */
-				if (i >= hlit + hdist) {
-					SET_ERROR(upng, UPNG_EMALFORMED);
-					break;
-				}
-
-				if (i < hlit) {
-					bitlen[i] = value;
-				} else {
-					bitlenD[i - hlit] = value;
-				}
-				i++;
-			}
+			replength = 3 + read_bits(br, 2);
+			value = (i - 1) < hlit ? bitlen[i - 1] : bitlenD[i - hlit - 1];
 		} else if (code == 17) {	/*repeat "0" 3-10 times */
-			unsigned replength = 3;	/*read in the bits that indicate repeat length */
-			if ((*bp) >> 3 >= inlength) {
-				SET_ERROR(upng, UPNG_EMALFORMED);
-				break;
-			}
-
-			/*error, bit pointer jumps past memory */
-			replength += read_bits(bp, in, 3);
-
-			/*repeat this value in the next lengths */
-			for (n = 0; n < replength; n++) {
-				/* error: i is larger than the amount of codes */
-				if (i >= hlit + hdist) {
-					SET_ERROR(upng, UPNG_EMALFORMED);
-					break;
-				}
-
-				if (i < hlit) {
-					bitlen[i] = 0;
-				} else {
-					bitlenD[i - hlit] = 0;
-				}
-				i++;
-			}
+			replength = 3 + read_bits(br, 3);
+			value = 0;
 		} else if (code == 18) {	/*repeat "0" 11-138 times */
-			unsigned replength = 11;	/*read in the bits that indicate repeat length */
-			/* error, bit pointer jumps past memory */
-			if ((*bp) >> 3 >= inlength) {
-				SET_ERROR(upng, UPNG_EMALFORMED);
-				break;
-			}
-
-			replength += read_bits(bp, in, 7);
-
-			/*repeat this value in the next lengths */
-			for (n = 0; n < replength; n++) {
-				/* i is larger than the amount of codes */
-				if (i >= hlit + hdist) {
-					SET_ERROR(upng, UPNG_EMALFORMED);
-					break;
-				}
-				if (i < hlit)
-					bitlen[i] = 0;
-				else
-					bitlenD[i - hlit] = 0;
-				i++;
-			}
+			replength = 11 + read_bits(br, 7);
+			value = 0;
 		} else {
 			/* somehow an unexisting code appeared. This can never happen. */
 			SET_ERROR(upng, UPNG_EMALFORMED);
 			break;
 		}
+
+		/* error: i would be larger than the amount of codes */
+		if (i + replength > hlit + hdist) {
+			SET_ERROR(upng, UPNG_EMALFORMED);
+			break;
+		}
+
+		/*repeat this value in the next lengths */
+		for (n = 0; n < replength; n++) {
+			if (i < hlit) {
+				bitlen[i] = value;
+			} else {
+				bitlenD[i - hlit] = value;
+			}
+			i++;
+		}
 	}
 
+	/*the length of the end code 256 must be larger than 0 */
 	if (upng->error == UPNG_EOK && bitlen[256] == 0) {
 		SET_ERROR(upng, UPNG_EMALFORMED);
 	}
 
-	/*the length of the end code 256 must be larger than 0 */
-	/*now we've finally got hlit and hdist, so generate the code trees, and the function is done */
+	/*now we've finally got hlit and hdist, so generate the code tables, and the function is done */
 	if (upng->error == UPNG_EOK) {
-		huffman_tree_create_lengths(upng, codetree, bitlen);
+		huffman_table_create_lengths(upng, codetable, bitlen, NUM_DEFLATE_CODE_SYMBOLS);
 	}
 	if (upng->error == UPNG_EOK) {
-		huffman_tree_create_lengths(upng, codetreeD, bitlenD);
+		huffman_table_create_lengths(upng, codetableD, bitlenD, NUM_DISTANCE_SYMBOLS);
 	}
 }
 
 /*inflate a block with dynamic of fixed Huffman tree*/
-static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outsize, const unsigned char *in, unsigned long *bp, unsigned long *pos, unsigned long inlength, unsigned btype)
+static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outsize, bit_reader* br, unsigned long *pos, unsigned btype)
 {
-	unsigned codetree_buffer[DEFLATE_CODE_BUFFER_SIZE];
-	unsigned codetreeD_buffer[DISTANCE_BUFFER_SIZE];
-	unsigned done = 0;
-
-	huffman_tree codetree;
-	huffman_tree codetreeD;
+	huffman_table dynamic_table;
+	huffman_table dynamic_tableD;
+	const huffman_table* codetable;
+	const huffman_table* codetableD;
 
 	if (btype == 1) {
-		/* fixed trees */
-		huffman_tree_init(&codetree, (unsigned*)FIXED_DEFLATE_CODE_TREE, NUM_DEFLATE_CODE_SYMBOLS, DEFLATE_CODE_BITLEN);
-		huffman_tree_init(&codetreeD, (unsigned*)FIXED_DISTANCE_TREE, NUM_DISTANCE_SYMBOLS, DISTANCE_BITLEN);
-	} else if (btype == 2) {
+		/* fixed trees, built once and shared by every fixed block */
+		if (!fixed_tables_ready) {
+			huffman_create_fixed_tables(upng);
+			if (upng->error != UPNG_EOK) {
+				return;
+			}
+		}
+
+		codetable = &fixed_code_table;
+		codetableD = &fixed_distance_table;
+	} else {
 		/* dynamic trees */
-		unsigned codelengthcodetree_buffer[CODE_LENGTH_BUFFER_SIZE];
-		huffman_tree codelengthcodetree;
+		get_tree_inflate_dynamic(upng, &dynamic_table, &dynamic_tableD, br);
+		if (upng->error != UPNG_EOK) {
+			return;
+		}
 
-		huffman_tree_init(&codetree, codetree_buffer, NUM_DEFLATE_CODE_SYMBOLS, DEFLATE_CODE_BITLEN);
-		huffman_tree_init(&codetreeD, codetreeD_buffer, NUM_DISTANCE_SYMBOLS, DISTANCE_BITLEN);
-		huffman_tree_init(&codelengthcodetree, codelengthcodetree_buffer, NUM_CODE_LENGTH_CODES, CODE_LENGTH_BITLEN);
-		get_tree_inflate_dynamic(upng, &codetree, &codetreeD, &codelengthcodetree, in, bp, inlength);
+		codetable = &dynamic_table;
+		codetableD = &dynamic_tableD;
 	}
 
-	while (done == 0) {
-		unsigned code = huffman_decode_symbol(upng, in, bp, &codetree, inlength);
+	for (;;) {
+		unsigned code = huffman_decode_symbol(upng, br, codetable);
 		if (upng->error != UPNG_EOK) {
 			return;
 		}
 
-		if (code == 256) {
-			/* end code */
-			done = 1;
-		} else if (code <= 255) {
+		if (code <= 255) {
 			/* literal symbol */
 			if ((*pos) >= outsize) {
 				SET_ERROR(upng, UPNG_EMALFORMED);
@@ -493,24 +484,18 @@ static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outs
 
 			/* store output */
 			out[(*pos)++] = (unsigned char)(code);
-		} else if (code >= FIRST_LENGTH_CODE_INDEX && code <= LAST_LENGTH_CODE_INDEX) {	/*length code */
-			/* part 1: get length base */
-			unsigned long length = LENGTH_BASE[code - FIRST_LENGTH_CODE_INDEX];
-			unsigned codeD, distance, numextrabitsD;
-			unsigned long start, forward, backward, numextrabits;
-
-			/* part 2: get extra bits and add the value of that to length */
-			numextrabits = LENGTH_EXTRA[code - FIRST_LENGTH_CODE_INDEX];
+		} else if (code == 256) {
+			/* end code */
+			return;
+		} else if (code <= LAST_LENGTH_CODE_INDEX) {	/*length code */
+			unsigned long length, distance, end;
+			unsigned codeD;
 
-			/* error, bit pointer will jump past memory */
-			if (((*bp) >> 3) >= inlength) {
-				SET_ERROR(upng, UPNG_EMALFORMED);
-				return;
-			}
-			length += read_bits(bp, in, numextrabits);
+			/* part 1 and 2: get length base and add the value of the extra bits */
+			length = LENGTH_BASE[code - FIRST_LENGTH_CODE_INDEX] + read_bits(br, LENGTH_EXTRA[code - FIRST_LENGTH_CODE_INDEX]);
 
 			/*part 3: get distance code */
-			codeD = huffman_decode_symbol(upng, in, bp, &codetreeD, inlength);
+			codeD = huffman_decode_symbol(upng, br, codetableD);
 			if (upng->error != UPNG_EOK) {
 				return;
 			}
@@ -521,60 +506,45 @@ static void inflate_huffman(upng_t* upng, unsigned char* out, unsigned long outs
 				return;
 			}
 
-			distance = DISTANCE_BASE[codeD];
-
 			/*part 4: get extra bits from distance */
-			numextrabitsD = DISTANCE_EXTRA[codeD];
-
-			/* error, bit pointer will jump past memory */
-			if (((*bp) >> 3) >= inlength) {
-				SET_ERROR(upng, UPNG_EMALFORMED);
-				return;
-			}
+			distance = DISTANCE_BASE[codeD] + read_bits(br, DISTANCE_EXTRA[codeD]);
 
-			distance += read_bits(bp, in, numextrabitsD);
-
-			/*part 5: fill in all the out[n] values based on the length and dist */
-			start = (*pos);
-			backward = start - distance;
-
-			if ((*pos) + length >= outsize) {
+			/* error: distance reaches before the start of the output, or the copy runs past the end of it */
+			if (distance > (*pos) || (*pos) + length > outsize) {
 				SET_ERROR(upng, UPNG_EMALFORMED);
 				return;
 			}
 
-			for (forward = 0; forward < length; forward++) {
-				out[(*pos)++] = out[backward];
-				backward++;
-
-				if (backward >= start) {
-					backward = start - distance;
-				}
+			/*part 5: copy forward a byte at a time so overlapping matches repeat themselves */
+			for (end = (*pos) + length; (*pos) < end; (*pos)++) {
+				out[*pos] = out[(*pos) - distance];
 			}
+		} else {
+			/* codes 286 and 287 are never used */
+			SET_ERROR(upng, UPNG_EMALFORMED);
+			return;
 		}
 	}
 }
 
-static void inflate_uncompressed(upng_t* upng, unsigned char* out, unsigned long outsize, const unsigned char *in, unsigned long *bp, unsigned long *pos, unsigned long inlength)
+static void inflate_uncompressed(upng_t* upng, unsigned char* out, unsigned long outsize, bit_reader* br, unsigned long *pos)
 {
 	unsigned long p;
-	unsigned len, nlen, n;
+	unsigned len, nlen;
 
-	/* go to first boundary of byte */
-	while (((*bp) & 0x7) != 0) {
-		(*bp)++;
-	}
-	p = (*bp) / 8;		/*byte position */
+	/* go to first boundary of byte, then hand any whole bytes still in the buffer back to the input */
+	read_bits(br, br->count & 0x7);
+	p = br->pos - br->count / 8;	/*byte position */
 
 	/* read len (2 bytes) and nlen (2 bytes) */
-	if (p >= inlength - 4) {
+	if (p + 4 > br->size) {
 		SET_ERROR(upng, UPNG_EMALFORMED);
 		return;
 	}
 
-	len = in[p] + 256 * in[p + 1];
+	len = br->in[p] + 256 * br->in[p + 1];
 	p += 2;
-	nlen = in[p] + 256 * in[p + 1];
+	nlen = br->in[p] + 256 * br->in[p + 1];
 	p += 2;
 
 	/* check if 16-bit nlen is really the one's complement of len */
@@ -583,53 +553,56 @@ static void inflate_uncompressed(upng_t* upng, unsigned char* out, unsigned long
 		return;
 	}
 
-	if ((*pos) + len >= outsize) {
+	if ((*pos) + len > outsize) {
 		SET_ERROR(upng, UPNG_EMALFORMED);
 		return;
 	}
 
 	/* read the literal data: len bytes are now stored in the out buffer */
-	if (p + len > inlength) {
+	if (p + len > br->size) {
 		SET_ERROR(upng, UPNG_EMALFORMED);
 		return;
 	}
 
-	for (n = 0; n < len; n++) {
-		out[(*pos)++] = in[p++];
-	}
+	memcpy(out + (*pos), br->in + p, len);
+	(*pos) += len;
 
-	(*bp) = p * 8;
+	/* restart the reader after the stored bytes */
+	br->pos = p + len;
+	br->buffer = 0;
+	br->count = 0;
 }
 
 /*inflate the deflated data (cfr. deflate spec); return value is the error*/
 static upng_error uz_inflate_data(upng_t* upng, unsigned char* out, unsigned long outsize, const unsigned char *in, unsigned long insize, unsigned long inpos)
 {
-	unsigned long bp = 0;	/*bit pointer in the "in" data, current byte is bp >> 3, current bit is bp & 0x7 (from lsb to msb of the byte) */
+	bit_reader br;
 	unsigned long pos = 0;	/*byte position in the out buffer */
-
 	unsigned done = 0;
 
+	bit_reader_init(&br, &in[inpos], insize - inpos);
+
 	while (done == 0) {
 		unsigned btype;
 
-		/* ensure next bit doesn't point past the end of the buffer */
-		if ((bp >> 3) >= insize) {
+		/* read block control bits */
+		done = read_bits(&br, 1);
+		btype = read_bits(&br, 2);
+
+		/* ensure the block header didn't come from past the end of the buffer */
+		if (bit_reader_overrun(&br)) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
 			return upng->error;
 		}
 
-		/* read block control bits */
-		done = read_bit(&bp, &in[inpos]);
-		btype = read_bit(&bp, &in[inpos]) | (read_bit(&bp, &in[inpos]) << 1);
-
 		/* process control type appropriateyly */
 		if (btype == 3) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
 			return upng->error;
 		} else if (btype == 0) {
-			inflate_uncompressed(upng, out, outsize, &in[inpos], &bp, &pos, insize);	/*no compression */
+			inflate_uncompressed(upng, out, outsize, &br, &pos);	/*no compression */
 		} else {
-			inflate_huffman(upng, out, outsize, &in[inpos], &bp, &pos, insize, btype);	/*compression, btype 01 or 10 */
+			inflate_huffman(upng, out, outsize, &br, &pos, btype);	/*compression, btype 01 or 10 */
 		}
 
 		/* stop if an error has occured */
@@ -638,6 +611,10 @@ static upng_error uz_inflate_data(upng_t* upng, unsigned char* out, unsigned lon
 		}
 	}
 
+	if (bit_reader_overrun(&br)) {
+		SET_ERROR(upng, UPNG_EMALFORMED);
+	}
+
 	return upng->error;
 }
 
@@ -961,30 +938,23 @@ upng_error upng_header(upng_t* upng)
 	return upng->error;
 }
 
-/*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-upng_error upng_decode(upng_t* upng)
+/*parse the header if needed and release any earlier result. return value is 1 if the image is ready to be decoded*/
+static int upng_begin_decode(upng_t* upng)
 {
-	const unsigned char *chunk;
-	unsigned char* compressed;
-	unsigned char* inflated;
-	unsigned long compressed_size = 0, compressed_index = 0;
-	unsigned long inflated_size;
-	upng_error error;
-
 	/* if we have an error state, bail now */
 	if (upng->error != UPNG_EOK) {
-		return upng->error;
+		return 0;
 	}
 
 	/* parse the main header, if necessary */
 	upng_header(upng);
 	if (upng->error != UPNG_EOK) {
-		return upng->error;
+		return 0;
 	}
 
 	/* if the state is not HEADER (meaning we are ready to decode the image), stop now */
 	if (upng->state != UPNG_HEADER) {
-		return upng->error;
+		return 0;
 	}
 
 	/* release old result, if any */
@@ -994,6 +964,18 @@ upng_error upng_decode(upng_t* upng)
 		upng->size = 0;
 	}
 
+	return 1;
+}
+
+/*gather the IDAT chunks and inflate them. return value is the inflated (but still filtered) scanlines, or NULL on error*/
+static unsigned char* upng_inflate_image(upng_t* upng)
+{
+	const unsigned char *chunk;
+	unsigned char* compressed;
+	unsigned char* inflated;
+	unsigned long compressed_size = 0, compressed_index = 0;
+	unsigned long inflated_size;
+
 	/* first byte of the first chunk after the header */
 	chunk = upng->source.buffer + 33;
 
@@ -1006,20 +988,20 @@ upng_error upng_decode(upng_t* upng)
 		/* make sure chunk header is not larger than the total compressed */
 		if ((unsigned long)(chunk - upng->source.buffer + 12) > upng->source.size) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
-			return upng->error;
+			return NULL;
 		}
 
 		/* get length; sanity check it */
 		length = upng_chunk_length(chunk);
 		if (length > INT_MAX) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
-			return upng->error;
+			return NULL;
 		}
 
 		/* make sure chunk header+paylaod is not larger than the total compressed */
 		if ((unsigned long)(chunk - upng->source.buffer + length + 12) > upng->source.size) {
 			SET_ERROR(upng, UPNG_EMALFORMED);
-			return upng->error;
+			return NULL;
 		}
 
 		/* get pointer to payload */
@@ -1032,7 +1014,7 @@ upng_error upng_decode(upng_t* upng)
 			break;
 		} else if (upng_chunk_critical(chunk)) {
 			SET_ERROR(upng, UPNG_EUNSUPPORTED);
-			return upng->error;
+			return NULL;
 		}
 
 		chunk += upng_chunk_length(chunk) + 12;
@@ -1042,7 +1024,7 @@ upng_error upng_decode(upng_t* upng)
 	compressed = (unsigned char*)malloc(compressed_size);
 	if (compressed == NULL) {
 		SET_ERROR(upng, UPNG_ENOMEM);
-		return upng->error;
+		return NULL;
 	}
 
 	/* scan through the chunks again, this time copying the values into
@@ -1072,20 +1054,36 @@ upng_error upng_decode(upng_t* upng)
 	if (inflated == NULL) {
 		free(compressed);
 		SET_ERROR(upng, UPNG_ENOMEM);
-		return upng->error;
+		return NULL;
 	}
 
 	/* decompress image data */
-	error = uz_inflate(upng, inflated, inflated_size, compressed, compressed_size);
-	if (error != UPNG_EOK) {
+	if (uz_inflate(upng, inflated, inflated_size, compressed, compressed_size) != UPNG_EOK) {
 		free(compressed);
 		free(inflated);
-		return upng->error;
+		return NULL;
 	}
 
 	/* free the compressed compressed data */
 	free(compressed);
 
+	return inflated;
+}
+
+/*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
+upng_error upng_decode(upng_t* upng)
+{
+	unsigned char* inflated;
+
+	if (!upng_begin_decode(upng)) {
+		return upng->error;
+	}
+
+	inflated = upng_inflate_image(upng);
+	if (inflated == NULL) {
+		return upng->error;
+	}
+
 	/* allocate final image buffer */
 	upng->size = (upng->height * upng->width * upng_get_bpp(upng) + 7) / 8;
 	upng->buffer = (unsigned char*)malloc(upng->size);
@@ -1114,6 +1112,62 @@ upng_error upng_decode(upng_t* upng)
 	return upng->error;
 }
 
+/*read an 8 bit RGB or RGBA PNG straight into out as RGBA5551, out must hold width * height pixels.
+  each scanline is unfiltered in place inside the inflated data and converted, so no full color copy of the image is ever made*/
+upng_error upng_decode_rgba5551(upng_t* upng, unsigned short* out)
+{
+	unsigned char* inflated;
+	unsigned char* prevline = NULL;
+	unsigned long bytewidth, linebytes;
+	unsigned x, y;
+
+	if (out == NULL) {
+		SET_ERROR(upng, UPNG_EPARAM);
+		return upng->error;
+	}
+
+	if (!upng_begin_decode(upng)) {
+		return upng->error;
+	}
+
+	if (upng->format != UPNG_RGB8 && upng->format != UPNG_RGBA8) {
+		SET_ERROR(upng, UPNG_EUNFORMAT);
+		return upng->error;
+	}
+
+	inflated = upng_inflate_image(upng);
+	if (inflated == NULL) {
+		return upng->error;
+	}
+
+	bytewidth = upng_get_components(upng);
+	linebytes = upng->width * bytewidth;
+
+	for (y = 0; y < upng->height && upng->error == UPNG_EOK; y++) {
+		unsigned char* line = &inflated[(1 + linebytes) * y];	/*the filter type byte is followed by the scanline */
+		const unsigned char* pixel = line + 1;
+
+		unfilter_scanline(upng, line + 1, line + 1, prevline, bytewidth, line[0], linebytes);
+
+		for (x = 0; x < upng->width; x++, pixel += bytewidth) {
+			unsigned short alpha = bytewidth == 4 ? (pixel[3] >> 7) : 1;
+			*out++ = (unsigned short)(((pixel[0] >> 3) << 11) | ((pixel[1] >> 3) << 6) | ((pixel[2] >> 3) << 1) | alpha);
+		}
+
+		prevline = line + 1;
+	}
+	free(inflated);
+
+	if (upng->error == UPNG_EOK) {
+		upng->state = UPNG_DECODED;
+	}
+
+	/* we are done with our input buffer; free it if we own it */
+	upng_free_source(upng);
+
+	return upng->error;
+}
+
 static upng_t* upng_new(void)
 {
 	upng_t* upng;
@@ -1,6 +1,5 @@
 #include "utilities.h"
-
-#include <malloc.h>
+#include "arena.h"
 
 void rom_2_ram(void *from_addr, void *to_addr, s32 seq_size)
 {
@@ -11,7 +10,7 @@ void rom_2_ram(void *from_addr, void *to_addr, s32 seq_size)
 
 unsigned short *image_24_to_16(const unsigned char *data, int size_x, int size_y)
 {
-    unsigned short *temp = (unsigned short *)malloc(size_x * size_y * 2);
+    unsigned short *temp = (unsigned short *)level_alloc(size_x * size_y * 2, MemoryTexture);
 
     for (int y = 0; y < size_y; y++)
     {
@@ -69,11 +68,12 @@ vector3 vec3_mul(vector3 vector, float scalar)
 vector3 vec3_mul_mat3x3(vector3 vector, Mtx mat)
 {
     float fMat[4][4];
+    vector3 result;
     guMtxL2F(fMat, &mat);
-    vector.x = (vector.x * fMat[0][0]) + (vector.y * fMat[1][0]) + (vector.z * fMat[2][0]);
-    vector.y = (vector.x * fMat[0][1]) + (vector.y * fMat[1][1]) + (vector.z * fMat[2][1]);
-    vector.z = (vector.x * fMat[0][2]) + (vector.y * fMat[1][2]) + (vector.z * fMat[2][2]);
-    return vector;
+    result.x = (vector.x * fMat[0][0]) + (vector.y * fMat[1][0]) + (vector.z * fMat[2][0]);
+    result.y = (vector.x * fMat[0][1]) + (vector.y * fMat[1][1]) + (vector.z * fMat[2][1]);
+    result.z = (vector.x * fMat[0][2]) + (vector.y * fMat[1][2]) + (vector.z * fMat[2][2]);
+    return result;
 }
 
 vector3 vec3_mul_mat4x4(vector3 vector, Mtx mat)
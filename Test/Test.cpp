@@ -1,5 +1,22 @@
+#include <cfloat>
+#include <chrono>
+#include <fstream>
+#include <iterator>
 #include "Unit.h"
 #include "../Editor/Util.h"
+#include "../Editor/MeshTree.h"
+
+extern "C"
+{
+#include "../Engine/arena.h"
+#include "../Engine/upng.h"
+#define PROFILE_HOST
+#include "../Engine/profile.h"
+
+    // The engine's tracked heap isn't linked into the tests so decoding buffers come from the host.
+    void *heap_alloc(int size, enum memoryCategory category) { return malloc(size); }
+    void heap_free(void *pointer) { free(pointer); }
+}
 
 using namespace UltraEd;
 
@@ -11,6 +28,156 @@ int main()
         assert.Equal(CUtil::NewResourceName(26), "UER_26");
     });
 
+    testRunner.It("rewrites self in scripts that pass it to Despawn", [](CAssert assert) {
+        const char *script = "void $update(float delta)\n{\n    self->position->y -= delta;\n"
+            "    if (self->position->y < 0) Despawn(self);\n    FindActorByName(\"self\");\n    int myself = 0;\n}";
+
+        // Prefabs run as whichever instance the build points their self variable at.
+        unique_ptr<char> prefab(Util::ReplaceString(script, "$", "UER_3"));
+        assert.Equal(Util::ReplaceToken(prefab.get(), "self", "UER_3self"),
+            "void UER_3update(float delta)\n{\n    UER_3self->position->y -= delta;\n"
+            "    if (UER_3self->position->y < 0) Despawn(UER_3self);\n    FindActorByName(\"self\");\n    int myself = 0;\n}");
+
+        // Placed actors refer to their slot in the actor table.
+        unique_ptr<char> placed(Util::ReplaceString(script, "$", "UER_0"));
+        assert.Equal(Util::ReplaceToken(placed.get(), "self", "_UER_Actors[0]"),
+            "void UER_0update(float delta)\n{\n    _UER_Actors[0]->position->y -= delta;\n"
+            "    if (_UER_Actors[0]->position->y < 0) Despawn(_UER_Actors[0]);\n    FindActorByName(\"self\");\n"
+            "    int myself = 0;\n}");
+    });
+
+    testRunner.It("picks the nearest of 100k triangles", [](CAssert assert) {
+        // Ten stacked grids with the lowest first in the mesh so the first hit isn't the nearest.
+        std::vector<Vertex> vertices;
+        auto corner = [&](float x, float y, float z) {
+            Vertex vertex = {};
+            vertex.position = D3DXVECTOR3(x, y, z);
+            vertices.push_back(vertex);
+        };
+
+        for (int layer = 0; layer < 10; layer++)
+        {
+            for (int x = 0; x < 50; x++)
+            {
+                for (int z = 0; z < 100; z++)
+                {
+                    corner(x, layer, z); corner(x, layer, z + 1.0f); corner(x + 1.0f, layer, z);
+                    corner(x + 1.0f, layer, z); corner(x, layer, z + 1.0f); corner(x + 1.0f, layer, z + 1.0f);
+                }
+            }
+        }
+
+        auto start = chrono::steady_clock::now();
+        MeshTree tree(vertices);
+        auto built = chrono::steady_clock::now();
+
+        int hits = 0;
+        for (int i = 0; i < 10000; i++)
+        {
+            float dist;
+            D3DXVECTOR3 orig(0.5f + (i % 49), 100, 0.5f + (i % 99));
+            if (tree.Intersect(orig, D3DXVECTOR3(0, -1, 0), false, &dist) && fabsf(dist - 91) < 0.001f) hits++;
+        }
+
+        auto picked = chrono::steady_clock::now();
+        cout << "\nBuilt " << tree.GetTriangleCount() << " triangles in "
+            << chrono::duration_cast<chrono::milliseconds>(built - start).count() << " ms, "
+            << chrono::duration<double, micro>(picked - built).count() / 10000 << " us per pick\n";
+
+        assert.Equal(to_string(hits), "10000");
+    });
+
+    testRunner.It("tests bounds with rays parallel to an axis", [](CAssert assert) {
+        // The origin sits on the box's faces along the axes the ray doesn't move on.
+        D3DXVECTOR3 min(0, 0, 0), max(1, 1, 1), orig(-1, 0, 1);
+        D3DXVECTOR3 invDir = MeshTree::InverseDirection(D3DXVECTOR3(1, 0, 0));
+        float entry = -1;
+
+        bool hit = MeshTree::IntersectBounds(min, max, orig, invDir, FLT_MAX, &entry);
+        assert.Equal(string(hit ? "hit " : "miss ") + to_string(entry), "hit 1.000000");
+    });
+
+    testRunner.It("decodes png textures straight to RGBA5551", [](CAssert assert) {
+        // Fixed Huffman blocks are what the editor writes. The dynamic one is what image editors write.
+        const char *paths[] = { "../Editor/Presets/pumpkin.png", "Textures/fixed128.png", "Textures/dynamic128.png" };
+        const int iterations = 200;
+
+        for (const char *path : paths)
+        {
+            ifstream file(path, ios::binary);
+            vector<unsigned char> png((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+            assert.Equal("loaded", png.empty() ? path : "loaded");
+
+            // The generic path is how textures were decoded before, through a 24 or 32 bit copy.
+            vector<unsigned short> generic, direct;
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                upng_t *image = upng_new_from_bytes(png.data(), static_cast<unsigned long>(png.size()));
+                upng_decode(image);
+                assert.Equal("0", to_string(upng_get_error(image)));
+
+                const unsigned char *pixels = upng_get_buffer(image);
+                const unsigned components = upng_get_components(image);
+                generic.resize(upng_get_width(image) * upng_get_height(image));
+                for (size_t p = 0; p < generic.size(); p++)
+                {
+                    const unsigned char *pixel = &pixels[p * components];
+                    generic[p] = ((pixel[0] >> 3) << 11) | ((pixel[1] >> 3) << 6) | ((pixel[2] >> 3) << 1)
+                        | (components == 4 ? pixel[3] >> 7 : 1);
+                }
+                upng_free(image);
+            }
+
+            auto decoded = chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                upng_t *image = upng_new_from_bytes(png.data(), static_cast<unsigned long>(png.size()));
+                upng_header(image);
+                direct.resize(upng_get_width(image) * upng_get_height(image));
+                upng_decode_rgba5551(image, direct.data());
+                assert.Equal("0", to_string(upng_get_error(image)));
+                upng_free(image);
+            }
+
+            auto converted = chrono::steady_clock::now();
+            cout << "\n" << path << ": " << chrono::duration<double, micro>(decoded - start).count() / iterations
+                << " us through 24 bit, " << chrono::duration<double, micro>(converted - decoded).count() / iterations
+                << " us direct";
+
+            assert.Equal(to_string(generic == direct), "1");
+        }
+
+        cout << "\n";
+    });
+
+    testRunner.It("writes profiled frames as csv", [](CAssert assert) {
+        // Frames go through the same calls main.c makes, with the task ending straight away.
+        for (int frame = 0; frame < 3; frame++)
+        {
+            profile_begin(ProfileUpdate);
+            profile_end(ProfileUpdate);
+            profile_tick();
+            profile_tick();
+            profile_task_start();
+            profile_frame_end();
+            profile_task_end();
+        }
+
+        FILE *file = tmpfile();
+        profile_write_csv(file);
+        rewind(file);
+
+        char line[PROFILE_CSV_LINE];
+        vector<string> lines;
+        while (fgets(line, sizeof(line), file)) lines.push_back(line);
+        fclose(file);
+
+        assert.Equal(to_string(lines.size()), "4");
+        assert.Equal(lines[0], "ticks,input,update,collide,display_list,submit,task,rdp\n");
+        assert.Equal(lines[3].substr(0, 2), "2,");
+    });
+
     testRunner.Run();
 
     return 0;